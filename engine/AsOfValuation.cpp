@@ -0,0 +1,136 @@
+#include "AsOfValuation.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::int64_t kDayMs = 24LL * 60 * 60 * 1000;
+
+struct Holding {
+    PriceHistory::SeriesId series;
+    long long quantity;
+    CurrencyId currency;
+};
+
+// Количества складываются по символу: один ряд проходится один раз, даже если строк несколько.
+// Валюта символа — валюта первой его строки
+std::vector<Holding> collectHoldings(const Portfolio& portfolio, const PriceHistory& history, size_t& unknown) {
+    const auto& assets = portfolio.getAssets();
+    std::vector<long long> bySymbol(portfolio.getSymbols().size(), 0);
+    std::vector<CurrencyId> currencyBySymbol(bySymbol.size(), kInvalidCurrency);
+    for (const auto& asset : assets) {
+        bySymbol[asset.symbol] += asset.quantity;
+        if (currencyBySymbol[asset.symbol] == kInvalidCurrency) currencyBySymbol[asset.symbol] = asset.currency;
+    }
+    std::vector<Holding> holdings;
+    unknown = 0;
+    for (SymbolId symbol = 0; symbol < bySymbol.size(); ++symbol) {
+        if (currencyBySymbol[symbol] == kInvalidCurrency) continue;
+        PriceHistory::SeriesId series = history.findSeries(portfolio.getSymbols().name(symbol));
+        if (series == kInvalidSymbol) ++unknown;
+        else holdings.push_back({ series, bySymbol[symbol], currencyBySymbol[symbol] });
+    }
+    return holdings;
+}
+
+// Ряд курса валюты в истории — котировки её пары, если они записывались
+PriceHistory::SeriesId fxSeries(const Portfolio& portfolio, const PriceHistory& history, CurrencyId currency) {
+    return history.findSeries(portfolio.getSymbols().name(portfolio.getFxSymbol(currency)));
+}
+
+// Курсы всех валют на отсортированных моментах: rates[currency * times.size() + d]
+std::vector<double> ratesAsOf(const Portfolio& portfolio, const PriceHistory& history,
+    const std::vector<std::int64_t>& times) {
+    const FxTable& fx = portfolio.getFx();
+    const size_t dates = times.size();
+    std::vector<double> rates(fx.size() * dates, 1.0);
+    for (CurrencyId currency = 1; currency < fx.size(); ++currency) {
+        double* row = rates.data() + currency * dates;
+        std::fill(row, row + dates, fx.rate(currency));
+        PriceHistory::SeriesId series = fxSeries(portfolio, history, currency);
+        if (series == kInvalidSymbol) continue;
+        PriceHistory::Cursor cursor(history, series);
+        float rate;
+        for (size_t d = 0; d < dates; ++d) {
+            if (cursor.advanceAsOf(times[d], rate)) row[d] = rate;
+        }
+    }
+    return rates;
+}
+
+} // namespace
+
+NavPoint valueAsOf(const Portfolio& portfolio, const PriceHistory& history, std::int64_t time) {
+    size_t unknown = 0;
+    std::vector<Holding> holdings = collectHoldings(portfolio, history, unknown);
+    std::vector<double> rates = ratesAsOf(portfolio, history, { time });
+    NavPoint nav{ time, 0.0, 0, unknown };
+    for (const auto& holding : holdings) {
+        float price;
+        if (history.priceAsOf(holding.series, time, price)) {
+            nav.value += static_cast<double>(holding.quantity) * price * rates[holding.currency];
+            ++nav.priced;
+        }
+        else {
+            ++nav.missing;
+        }
+    }
+    return nav;
+}
+
+std::vector<NavPoint> valueSeriesAsOf(const Portfolio& portfolio, const PriceHistory& history,
+    std::vector<std::int64_t> times, ThreadPool& pool) {
+    std::sort(times.begin(), times.end());
+    size_t unknown = 0;
+    std::vector<Holding> holdings = collectHoldings(portfolio, history, unknown);
+
+    // Слот потока: суммы по валюте и дате (в валюте) и число оценённых символов по дате.
+    // В базовую валюту суммы переводятся в конце, по курсу на каждую дату — один раз на валюту
+    const size_t dates = times.size();
+    const size_t currencies = portfolio.getFx().size();
+    std::vector<std::vector<double>> values(pool.size(), std::vector<double>(currencies * dates, 0.0));
+    std::vector<std::vector<size_t>> priced(pool.size(), std::vector<size_t>(dates, 0));
+    pool.parallelFor(holdings.size(), 0, [&](size_t begin, size_t end, size_t slot) {
+        std::vector<double>& slotValues = values[slot];
+        std::vector<size_t>& slotPriced = priced[slot];
+        for (size_t h = begin; h < end; ++h) {
+            PriceHistory::Cursor cursor(history, holdings[h].series);
+            const double quantity = static_cast<double>(holdings[h].quantity);
+            double* currencyValues = slotValues.data() + holdings[h].currency * dates;
+            std::int64_t first = 0, last = 0;
+            history.timeRange(holdings[h].series, first, last);
+            // Даты до начала ряда пропускаются сразу
+            size_t d = static_cast<size_t>(std::lower_bound(times.begin(), times.end(), first) - times.begin());
+            float price;
+            for (; d < dates; ++d) {
+                if (!cursor.advanceAsOf(times[d], price)) continue;
+                currencyValues[d] += quantity * price;
+                ++slotPriced[d];
+            }
+        }
+    });
+
+    std::vector<double> rates = ratesAsOf(portfolio, history, times);
+    std::vector<NavPoint> series(dates);
+    for (size_t d = 0; d < dates; ++d) {
+        NavPoint& nav = series[d];
+        nav = { times[d], 0.0, 0, 0 };
+        for (size_t slot = 0; slot < values.size(); ++slot) {
+            for (size_t currency = 0; currency < currencies; ++currency) {
+                nav.value += values[slot][currency * dates + d] * rates[currency * dates + d];
+            }
+            nav.priced += priced[slot][d];
+        }
+        nav.missing = unknown + holdings.size() - nav.priced;
+    }
+    return series;
+}
+
+std::vector<std::int64_t> dailyCloseTimes(std::int64_t from, std::int64_t to, std::int64_t closeOffsetMs) {
+    std::vector<std::int64_t> times;
+    std::int64_t day = from - ((from % kDayMs) + kDayMs) % kDayMs;
+    for (; day + closeOffsetMs <= to; day += kDayMs) {
+        if (day + closeOffsetMs >= from) times.push_back(day + closeOffsetMs);
+    }
+    return times;
+}
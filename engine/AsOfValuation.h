@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Portfolio.h"
+#include "PriceHistory.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+// Стоимость портфеля на момент времени по текущим количествам и историческим ценам
+struct NavPoint {
+    std::int64_t time;
+    double value;
+    size_t priced;  // символов с ценой не позже time
+    size_t missing; // символов без истории на этот момент; в стоимость не входят
+};
+
+// Цена каждого символа — последняя точка его ряда не позже time. Стоимость в базовой валюте:
+// курс — последняя точка ряда валютной пары не позже time, а если пары нет в истории — текущий
+NavPoint valueAsOf(const Portfolio& portfolio, const PriceHistory& history, std::int64_t time);
+
+// Стоимость на множестве моментов (возвращается по возрастанию времени). Каждый ряд проходится
+// одним курсором слиянием с отсортированными датами, а не двоичным поиском на каждую дату;
+// ряды делятся между потоками пула, суммы по датам копятся в слотах потоков.
+std::vector<NavPoint> valueSeriesAsOf(const Portfolio& portfolio, const PriceHistory& history,
+    std::vector<std::int64_t> times, ThreadPool& pool);
+
+// Моменты закрытия каждого дня в [from, to]: полночь UTC плюс closeOffsetMs
+std::vector<std::int64_t> dailyCloseTimes(std::int64_t from, std::int64_t to, std::int64_t closeOffsetMs);
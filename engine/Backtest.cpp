@@ -0,0 +1,166 @@
+#include "Backtest.h"
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Состояние одной стратегии; буферы создаются до цикла по барам
+class StrategyRun {
+public:
+    StrategyRun(const BacktestInput& input, const BacktestStrategy& strategy, BacktestResult& result)
+        : input(input), strategy(strategy), result(result), quantity(input.assets, 0), values(input.assets, 0.0f),
+          orders(input.assets, 0) {
+        result.nav.assign(input.bars, 0.0f);
+    }
+
+    void run() {
+        const size_t n = input.assets;
+        double cash = input.initialCash;
+        double peak = 0.0;
+        double traded = 0.0;
+        double navSum = 0.0;
+        for (size_t bar = 0; bar < input.bars; ++bar) {
+            const float* price = &input.prices[bar * n];
+            bool flow = false;
+            if (bar > 0 && input.contribution != 0.0 && input.contributionBars > 0 && bar % input.contributionBars == 0) {
+                cash += input.contribution;
+                result.contributed += input.contribution;
+                flow = true;
+            }
+            double total = cash;
+            for (size_t i = 0; i < n; ++i) {
+                values[i] = static_cast<float>(quantity[i]) * price[i];
+                total += values[i];
+            }
+
+            if (total > 0.0 && shouldRebalance(bar, flow, price, total)) {
+                ++result.rebalances;
+                if (strategy.policy == RebalancePolicy::CashFlow) {
+                    buyUnderweights(price, total, cash, traded);
+                } else {
+                    rebalanceToTargets(price, total, cash, traded);
+                }
+            }
+
+            double nav = cash;
+            for (size_t i = 0; i < n; ++i) nav += static_cast<double>(quantity[i]) * price[i];
+            result.nav[bar] = static_cast<float>(nav);
+            navSum += nav;
+            peak = std::max(peak, nav);
+            if (peak > 0.0) result.maxDrawdown = std::max(result.maxDrawdown, (peak - nav) / peak);
+        }
+        if (navSum > 0.0) result.turnover = traded / (navSum / static_cast<double>(input.bars));
+    }
+
+private:
+    bool shouldRebalance(size_t bar, bool flow, const float* price, double total) const {
+        if (bar == 0) return true;
+        switch (strategy.policy) {
+        case RebalancePolicy::Calendar:
+            return strategy.periodBars > 0 && bar % strategy.periodBars == 0;
+        case RebalancePolicy::Threshold:
+            for (size_t i = 0; i < input.assets; ++i) {
+                if (price[i] <= 0.0f) continue;
+                const double share = values[i] / total * 100.0;
+                if (std::abs(share - input.targetPercent[i]) > strategy.thresholdPercent) return true;
+            }
+            return false;
+        case RebalancePolicy::CashFlow:
+            return flow;
+        }
+        return false;
+    }
+
+    // Свободные деньги делятся между недовесными активами пропорционально недобору до цели
+    void buyUnderweights(const float* price, double total, double& cash, double& traded) {
+        double deficit = 0.0;
+        for (size_t i = 0; i < input.assets; ++i) {
+            if (price[i] > 0.0f) deficit += std::max(0.0, total * input.targetPercent[i] / 100.0 - values[i]);
+        }
+        const double budget = std::max(0.0, cash) / (1.0 + strategy.costBps / 10000.0);
+        if (deficit <= 0.0 || budget <= 0.0) return;
+        const double scale = std::min(1.0, budget / deficit);
+        for (size_t i = 0; i < input.assets; ++i) {
+            if (price[i] <= 0.0f) continue;
+            const double want = std::max(0.0, total * input.targetPercent[i] / 100.0 - values[i]) * scale;
+            trade(i, static_cast<int>(want / price[i]), price[i], cash, traded);
+        }
+    }
+
+    // Сначала продажи, затем покупки на вырученные и свободные деньги: покупка урезается до того,
+    // что позволяет остаток с издержками, поэтому деньги не уходят в минус
+    void rebalanceToTargets(const float* price, double total, double& cash, double& traded) {
+        for (size_t i = 0; i < input.assets; ++i) {
+            float target;
+            orders[i] = std::max(rebalanceUnits(values[i], static_cast<float>(total), input.targetPercent[i],
+                input.tolerancePercent[i], price[i], target), -quantity[i]);
+            if (orders[i] < 0) trade(i, orders[i], price[i], cash, traded);
+        }
+        const double rate = 1.0 + strategy.costBps / 10000.0;
+        for (size_t i = 0; i < input.assets; ++i) {
+            if (orders[i] <= 0 || price[i] <= 0.0f) continue;
+            const double budget = cash - strategy.fixedCost;
+            if (budget <= 0.0) break;
+            const double affordable = std::floor(budget / (static_cast<double>(price[i]) * rate));
+            trade(i, static_cast<int>(std::min<double>(orders[i], affordable)), price[i], cash, traded);
+        }
+    }
+
+    void trade(size_t asset, int units, float price, double& cash, double& traded) {
+        if (units == 0 || price <= 0.0f) return;
+        const double amount = static_cast<double>(units) * price;
+        const double cost = std::abs(amount) * strategy.costBps / 10000.0 + strategy.fixedCost;
+        cash -= amount + cost;
+        quantity[asset] += units;
+        traded += std::abs(amount);
+        result.costs += cost;
+        ++result.trades;
+    }
+
+    const BacktestInput& input;
+    const BacktestStrategy& strategy;
+    BacktestResult& result;
+    std::vector<int> quantity;
+    std::vector<float> values;
+    std::vector<int> orders; // единицы к сделке по активам в текущей ребалансировке
+};
+
+} // namespace
+
+void prepareBacktest(const Portfolio& portfolio, const PriceHistory& history,
+    const std::vector<PriceHistory::SeriesId>& series, std::int64_t from, std::int64_t barMs, size_t bars,
+    BacktestInput& input) {
+    const auto& assets = portfolio.getAssets();
+    const auto& targets = portfolio.getTargets();
+    const FxTable& fx = portfolio.getFx();
+    const size_t n = assets.size();
+    input.assets = n;
+    input.bars = bars;
+    input.prices.assign(bars * n, 0.0f);
+    input.targetPercent.resize(n);
+    input.tolerancePercent.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        input.targetPercent[i] = targets[i].targetPercent;
+        input.tolerancePercent[i] = targets[i].tolerancePercent;
+        if (i >= series.size() || series[i] == kInvalidSymbol) continue;
+        const float rate = static_cast<float>(fx.rate(assets[i].currency));
+        PriceHistory::Cursor cursor(history, series[i]);
+        for (size_t k = 0; k < bars; ++k) {
+            float price;
+            if (cursor.advanceAsOf(from + static_cast<std::int64_t>(k) * barMs, price)) input.prices[k * n + i] = price * rate;
+        }
+    }
+    input.initialCash = portfolio.getTotalValue();
+}
+
+std::vector<BacktestResult> runBacktests(const BacktestInput& input, const std::vector<BacktestStrategy>& strategies,
+    ThreadPool& pool) {
+    std::vector<BacktestResult> results(strategies.size());
+    pool.parallelFor(strategies.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t s = begin; s < end; ++s) StrategyRun(input, strategies[s], results[s]).run();
+    });
+    return results;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "PriceHistory.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+class Portfolio;
+
+enum class RebalancePolicy : std::uint8_t {
+    Calendar,  // полная ребалансировка раз в periodBars баров
+    Threshold, // как только доля любого актива ушла от цели дальше thresholdPercent
+    CashFlow,  // без продаж: пополнения докупают недовесные активы
+};
+
+struct BacktestStrategy {
+    RebalancePolicy policy = RebalancePolicy::Calendar;
+    std::uint32_t periodBars = 21;
+    float thresholdPercent = 5.0f;
+    double costBps = 10.0;  // от оборота сделки
+    double fixedCost = 0.0; // за каждую сделку
+};
+
+// Общие для всех стратегий данные: цены на сетке баров и цели
+struct BacktestInput {
+    size_t assets = 0;
+    size_t bars = 0;
+    std::vector<float> prices; // bars × assets в базовой валюте; 0 — у актива ещё нет цены
+    std::vector<float> targetPercent;
+    std::vector<float> tolerancePercent;
+    double initialCash = 0.0;       // в баре 0 вкладывается по целям
+    double contribution = 0.0;      // пополнение, каждые contributionBars баров
+    std::uint32_t contributionBars = 21;
+};
+
+struct BacktestResult {
+    std::vector<float> nav; // на конец каждого бара, после сделок и издержек
+    double turnover = 0.0;  // оборот сделок к средней стоимости
+    double costs = 0.0;
+    double contributed = 0.0; // пополнения после бара 0
+    double maxDrawdown = 0.0; // доля от пика
+    std::uint32_t rebalances = 0;
+    std::uint64_t trades = 0;
+};
+
+// Цены рядов на конце каждого бара начиная с from, с переносом последней цены вперёд; курсы
+// валют портфеля берутся текущие. Цели и коридоры — из портфеля, начальный капитал — его итог
+void prepareBacktest(const Portfolio& portfolio, const PriceHistory& history,
+    const std::vector<PriceHistory::SeriesId>& series, std::int64_t from, std::int64_t barMs, size_t bars,
+    BacktestInput& input);
+
+// Каждая стратегия — отдельная задача пула; её буферы выделяются один раз до цикла по барам,
+// а сам цикл ничего не выделяет. Решение о сделках по активу — rebalanceUnits, как в портфеле
+std::vector<BacktestResult> runBacktests(const BacktestInput& input, const std::vector<BacktestStrategy>& strategies,
+    ThreadPool& pool);
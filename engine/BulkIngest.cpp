@@ -0,0 +1,212 @@
+#include "BulkIngest.h"
+#include "PortfolioIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <filesystem>
+#include <functional>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Разобранный счёт: строки упорядочены по секциям хеш-соединения
+struct ParsedAccount {
+    Portfolio portfolio;
+    std::vector<std::uint32_t> rowOrder;
+    std::vector<std::uint32_t> partitionOffsets; // partitions + 1
+    std::vector<SymbolId> currencyOf;            // CurrencyId счёта -> валюта сводной книги
+};
+
+struct PartitionSymbol {
+    long long quantity = 0;
+    double value = 0.0;
+    float lastPrice = 0.0f;
+    std::uint32_t accountCount = 0;
+    std::uint32_t lastAccount = ~0u;
+    std::uint32_t entries = 0;
+};
+
+struct PartitionEntry {
+    SymbolId localSymbol;
+    AccountPosition position;
+};
+
+// Секция сводится независимо: свой словарь имён, свои суммы, свои строки разбивки
+struct Partition {
+    SymbolTable symbols;
+    std::vector<PartitionSymbol> totals;
+    std::vector<PartitionEntry> entries;
+    size_t firstPosition = 0; // место секции в общем массиве позиций
+    size_t firstEntry = 0;
+};
+
+size_t partitionOf(std::string_view name, size_t partitions) {
+    return std::hash<std::string_view>()(name) % partitions;
+}
+
+} // namespace
+
+void ConsolidatedBook::toPortfolio(Portfolio& portfolio) const {
+    portfolio.clear();
+    portfolio.reserve(positions.size());
+    for (const auto& position : positions) {
+        int quantity = static_cast<int>(std::min<long long>(position.quantity, INT_MAX));
+        size_t index = portfolio.addAsset(position.name, quantity, position.price, 0);
+        if (quantity > 0) portfolio.addLot(portfolio.getAssets()[index].symbol, quantity, position.price, 0);
+    }
+}
+
+std::vector<std::string> listPortfolioFiles(const std::string& directory) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".json") {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+ConsolidatedBook ingestPortfolioFiles(const std::vector<std::string>& paths, ThreadPool& pool, IngestStats* stats) {
+    ConsolidatedBook book;
+    const size_t partitionCount = pool.size();
+    std::vector<ParsedAccount> parsed(paths.size());
+    book.accounts.resize(paths.size());
+
+    // 1. Разбор файлов; каждая строка сразу раскладывается по секциям (сортировка подсчётом)
+    auto parseStart = Clock::now();
+    pool.parallelFor(paths.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t f = begin; f < end; ++f) {
+            AccountSummary& account = book.accounts[f];
+            ParsedAccount& target = parsed[f];
+            account.path = paths[f];
+            account.name = std::filesystem::path(paths[f]).stem().string();
+            account.loaded = loadPortfolioFile(paths[f], target.portfolio, &account.error);
+            if (!account.loaded) continue;
+
+            const auto& assets = target.portfolio.getAssets();
+            account.positions = assets.size();
+            account.value = target.portfolio.getTotalValue();
+            std::vector<std::uint32_t> rowPartition(assets.size());
+            target.partitionOffsets.assign(partitionCount + 1, 0);
+            for (size_t row = 0; row < assets.size(); ++row) {
+                rowPartition[row] = static_cast<std::uint32_t>(partitionOf(assets[row].name, partitionCount));
+                ++target.partitionOffsets[rowPartition[row] + 1];
+            }
+            for (size_t p = 0; p < partitionCount; ++p) {
+                target.partitionOffsets[p + 1] += target.partitionOffsets[p];
+            }
+            std::vector<std::uint32_t> cursor(target.partitionOffsets.begin(), target.partitionOffsets.end() - 1);
+            target.rowOrder.resize(assets.size());
+            for (size_t row = 0; row < assets.size(); ++row) {
+                target.rowOrder[cursor[rowPartition[row]]++] = static_cast<std::uint32_t>(row);
+            }
+        }
+    });
+    auto mergeStart = Clock::now();
+
+    // Валют у счёта единицы, поэтому общая таблица валют собирается последовательно
+    for (size_t f = 0; f < parsed.size(); ++f) {
+        if (!book.accounts[f].loaded) continue;
+        const FxTable& fx = parsed[f].portfolio.getFx();
+        parsed[f].currencyOf.resize(fx.size());
+        for (CurrencyId c = 0; c < fx.size(); ++c) parsed[f].currencyOf[c] = book.currencies.intern(fx.code(c));
+    }
+
+    // 2. Хеш-соединение по секциям: поток секции читает только свои строки каждого счёта
+    std::vector<Partition> partitions(partitionCount);
+    pool.parallelFor(partitionCount, 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t p = begin; p < end; ++p) {
+            Partition& partition = partitions[p];
+            for (std::uint32_t account = 0; account < parsed.size(); ++account) {
+                const ParsedAccount& source = parsed[account];
+                if (!book.accounts[account].loaded) continue;
+                const auto& assets = source.portfolio.getAssets();
+                for (size_t k = source.partitionOffsets[p]; k < source.partitionOffsets[p + 1]; ++k) {
+                    const Asset& asset = assets[source.rowOrder[k]];
+                    SymbolId local = partition.symbols.intern(asset.name);
+                    if (local == partition.totals.size()) partition.totals.emplace_back();
+                    PartitionSymbol& total = partition.totals[local];
+                    // Сводная книга ведётся в базовой валюте счетов
+                    const float price = static_cast<float>(asset.price * source.portfolio.getFx().rate(asset.currency));
+                    total.quantity += asset.quantity;
+                    total.value += static_cast<double>(asset.quantity) * price;
+                    total.lastPrice = price;
+                    if (total.lastAccount != account) {
+                        total.lastAccount = account;
+                        ++total.accountCount;
+                    }
+                    ++total.entries;
+                    partition.entries.push_back({ local, { account, asset.quantity, price, source.currencyOf[asset.currency] } });
+                }
+            }
+        }
+    });
+
+    // 3. Секции не пересекаются по именам, поэтому сводные позиции просто идут подряд
+    size_t positionCount = 0, entryCount = 0, nameBytes = 0;
+    for (auto& partition : partitions) {
+        partition.firstPosition = positionCount;
+        partition.firstEntry = entryCount;
+        positionCount += partition.totals.size();
+        entryCount += partition.entries.size();
+        for (SymbolId id = 0; id < partition.symbols.size(); ++id) nameBytes += partition.symbols.name(id).size() + 1;
+    }
+    book.symbols.reserve(positionCount, nameBytes);
+    book.positions.resize(positionCount);
+    book.breakdownOffsets.resize(positionCount + 1);
+    book.breakdown.resize(entryCount);
+    for (const auto& partition : partitions) {
+        for (SymbolId local = 0; local < partition.totals.size(); ++local) {
+            const PartitionSymbol& total = partition.totals[local];
+            SymbolId symbol = book.symbols.intern(partition.symbols.name(local));
+            float price = total.quantity > 0 ? static_cast<float>(total.value / total.quantity) : total.lastPrice;
+            book.positions[partition.firstPosition + local] =
+                { book.symbols.name(symbol), symbol, total.quantity, total.value, price, total.accountCount };
+            book.totalValue += total.value;
+        }
+    }
+
+    // Разбивка по счетам раскладывается каждой секцией в свой непрерывный диапазон
+    pool.parallelFor(partitionCount, 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t p = begin; p < end; ++p) {
+            const Partition& partition = partitions[p];
+            size_t offset = partition.firstEntry;
+            for (SymbolId local = 0; local < partition.totals.size(); ++local) {
+                book.breakdownOffsets[partition.firstPosition + local] = offset;
+                offset += partition.totals[local].entries;
+            }
+            std::vector<size_t> cursor(partition.totals.size());
+            for (SymbolId local = 0; local < partition.totals.size(); ++local) {
+                cursor[local] = book.breakdownOffsets[partition.firstPosition + local];
+            }
+            for (const auto& entry : partition.entries) {
+                book.breakdown[cursor[entry.localSymbol]++] = entry.position;
+            }
+        }
+    });
+    book.breakdownOffsets[positionCount] = entryCount;
+    auto mergeEnd = Clock::now();
+
+    if (stats) {
+        *stats = IngestStats();
+        stats->files = paths.size();
+        stats->threads = pool.size();
+        for (const auto& account : book.accounts) {
+            if (!account.loaded) ++stats->failed;
+            stats->rows += account.positions;
+        }
+        stats->symbols = positionCount;
+        stats->parseMs = elapsedMs(parseStart, mergeStart);
+        stats->mergeMs = elapsedMs(mergeStart, mergeEnd);
+    }
+    return book;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Portfolio.h"
+#include "SymbolTable.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Сводная позиция по символу среди всех счетов
+struct ConsolidatedPosition {
+    std::string_view name;
+    SymbolId symbol;     // в SymbolTable сводной книги
+    long long quantity;  // сумма по счетам может не поместиться в int
+    double value;
+    float price;         // средневзвешенная по стоимости
+    std::uint32_t accountCount;
+};
+
+// Строка разбивки: сколько символа лежит на конкретном счёте
+struct AccountPosition {
+    std::uint32_t account;
+    int quantity;
+    float price;       // в базовой валюте счетов
+    SymbolId currency; // валюта цены в файле счёта, в getCurrencies() сводной книги
+};
+
+struct AccountSummary {
+    std::string path;
+    std::string name; // имя файла без расширения
+    size_t positions = 0;
+    double value = 0.0;
+    bool loaded = false;
+    std::string error;
+};
+
+struct IngestStats {
+    size_t files = 0;
+    size_t failed = 0;
+    size_t rows = 0;
+    size_t symbols = 0;
+    size_t threads = 0;
+    double parseMs = 0.0;
+    double mergeMs = 0.0;
+};
+
+// Сводная книга: позиции по символам плюс разбивка по счетам в формате CSR
+class ConsolidatedBook {
+public:
+    const std::vector<ConsolidatedPosition>& getPositions() const { return positions; }
+    const std::vector<AccountSummary>& getAccounts() const { return accounts; }
+    const SymbolTable& getSymbols() const { return symbols; }
+    const SymbolTable& getCurrencies() const { return currencies; }
+    double getTotalValue() const { return totalValue; }
+
+    // Счета, на которых лежит позиция с индексом index
+    const AccountPosition* breakdownBegin(size_t index) const { return breakdown.data() + breakdownOffsets[index]; }
+    const AccountPosition* breakdownEnd(size_t index) const { return breakdown.data() + breakdownOffsets[index + 1]; }
+
+    // Переносит сводные позиции в обычный портфель для ребалансировки
+    void toPortfolio(Portfolio& portfolio) const;
+
+private:
+    friend ConsolidatedBook ingestPortfolioFiles(const std::vector<std::string>&, ThreadPool&, IngestStats*);
+
+    SymbolTable symbols;
+    SymbolTable currencies;
+    std::vector<ConsolidatedPosition> positions;
+    std::vector<AccountSummary> accounts;
+    std::vector<size_t> breakdownOffsets;
+    std::vector<AccountPosition> breakdown;
+    double totalValue = 0.0;
+};
+
+// Все *.json каталога в алфавитном порядке
+std::vector<std::string> listPortfolioFiles(const std::string& directory);
+
+// Файлы разбираются параллельно, затем объединяются секционированным хеш-соединением:
+// каждая строка сразу попадает в секцию по хешу имени, и каждая секция сводится
+// своим потоком независимо от остальных.
+ConsolidatedBook ingestPortfolioFiles(const std::vector<std::string>& paths, ThreadPool& pool,
+    IngestStats* stats = nullptr);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Григорианский календарь без часовых поясов: дни от 1970-01-01 UTC
+constexpr std::int64_t kSecondsPerDay = 24 * 60 * 60;
+
+// Алгоритмы Хиннанта, верны для любых дат
+inline std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<std::int64_t>(dayOfEra) - 719468;
+}
+
+inline void civilFromDays(std::int64_t days, std::int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<std::int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// Дни, содержащие момент в секундах (для отрицательных — вниз)
+inline std::int64_t daysFromSeconds(std::int64_t seconds) {
+    return (seconds >= 0 ? seconds : seconds - kSecondsPerDay + 1) / kSecondsPerDay;
+}
+
+// Строго "YYYY-MM-DD"
+inline bool parseIsoDate(std::string_view text, std::int64_t& days) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    unsigned parts[3] = { 0, 0, 0 };
+    const size_t starts[3] = { 0, 5, 8 };
+    const size_t lengths[3] = { 4, 2, 2 };
+    for (int p = 0; p < 3; ++p) {
+        for (size_t k = starts[p]; k < starts[p] + lengths[p]; ++k) {
+            if (text[k] < '0' || text[k] > '9') return false;
+            parts[p] = parts[p] * 10 + static_cast<unsigned>(text[k] - '0');
+        }
+    }
+    if (parts[1] < 1 || parts[1] > 12 || parts[2] < 1 || parts[2] > 31) return false;
+    days = daysFromCivil(parts[0], parts[1], parts[2]);
+    return true;
+}
@@ -0,0 +1,614 @@
+#include "CommandLine.h"
+#include "PortfolioIO.h"
+#include "BulkIngest.h"
+#include "ReplaySimulator.h"
+#include "AsOfValuation.h"
+#include "CorporateActions.h"
+#include "Frontier.h"
+#include "Performance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+void printUsage() {
+    std::fprintf(stderr,
+        "usage: PortfolioManager --batch <portfolio.json|dir>... [--targets <targets.json>] [--out orders.csv]\n"
+        "                        [--consolidate] [--threads N]\n"
+        "       without --targets the targets saved in each portfolio file are used\n"
+        "       --consolidate merges all files by symbol and rebalances the combined book (needs --targets)\n"
+        "       PortfolioManager --replay <portfolio.json> (--ticks <ticks.csv> | --synthetic N [--seed S] [--rate R])\n"
+        "                        [--speed X|max] [--frame-ms F] [--save-ticks <out.csv>] [--history]\n"
+        "       replays prices into the portfolio and reports throughput and tick-to-revaluation latency;\n"
+        "       --speed 1 plays at recorded pace, N is N times faster, max (default) does not wait;\n"
+        "       --history records applied prices into the compressed history store, reports its size\n"
+        "       and values the portfolio as of 250 evenly spaced moments of the replay\n"
+        "       PortfolioManager --actions <events.csv> <portfolio.json|dir>... [--threads N]\n"
+        "       applies splits, dividends and ticker changes (date,type,symbol,value) to every file in place;\n"
+        "       type is split | stock_dividend | cash_dividend | rename, apply each batch once\n"
+        "       PortfolioManager --frontier-benchmark N [--seed S]\n"
+        "       solves the long-only efficient frontier for N assets with a random 5-factor covariance\n"
+        "       and reports time, corner portfolios and the worst optimality-condition residual\n"
+        "       PortfolioManager --mwr-benchmark N [--seed S] [--threads N]\n"
+        "       solves the money-weighted return of N synthetic accounts with ten years of monthly flows\n"
+        "       and reports time, fallback count and the worst error against the generating rate\n");
+}
+
+struct BatchOptions {
+    std::vector<std::string> inputs;
+    std::string actionsPath;
+    std::string targetsPath;
+    std::string outPath;
+    bool consolidate = false;
+    size_t threads = 0;
+};
+
+struct ReplayCliOptions {
+    std::string portfolioPath;
+    std::string ticksPath;
+    std::string saveTicksPath;
+    size_t synthetic = 0;
+    std::uint64_t seed = 1;
+    double rate = 100000.0; // тиков в секунду времени записи
+    bool history = false;
+    ReplayOptions replay;
+};
+
+// Буферизованный вывод CSV: одна запись в файл на мегабайт строк
+class CsvWriter {
+public:
+    explicit CsvWriter(std::FILE* out) : out(out) { buffer.reserve(kFlushSize + 512); }
+    ~CsvWriter() { flush(); }
+
+    void header() {
+        buffer += "file,name,current_value,target_value,diff_value,units,action\n";
+    }
+
+    void row(const std::string& file, const RebalanceAction& action) {
+        char line[256];
+        const char* side = action.unitsToBuyOrSell > 0 ? "BUY" : (action.unitsToBuyOrSell < 0 ? "SELL" : "HOLD");
+        field(file);
+        buffer += ',';
+        field(action.name);
+        int n = std::snprintf(line, sizeof(line), ",%.2f,%.2f,%.2f,%d,%s\n",
+            action.currentValue, action.targetValue, action.diffValue, std::abs(action.unitsToBuyOrSell), side);
+        buffer.append(line, static_cast<size_t>(n));
+        if (buffer.size() >= kFlushSize) flush();
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+
+private:
+    // По RFC 4180: поле с запятой, кавычкой или переводом строки берётся в кавычки, кавычки внутри удваиваются
+    void field(std::string_view value) {
+        if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+            buffer.append(value.data(), value.size());
+            return;
+        }
+        buffer += '"';
+        for (char c : value) {
+            if (c == '"') buffer += '"';
+            buffer += c;
+        }
+        buffer += '"';
+    }
+
+    static constexpr size_t kFlushSize = 1 << 20;
+    std::FILE* out;
+    std::string buffer;
+};
+
+// Разворачивает каталоги в отсортированный список *.json
+void collectInputs(const std::string& arg, std::vector<std::string>& inputs) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(arg, ec)) {
+        std::vector<std::string> found = listPortfolioFiles(arg);
+        inputs.insert(inputs.end(), found.begin(), found.end());
+    }
+    else {
+        inputs.push_back(arg);
+    }
+}
+
+// Все файлы сводятся в одну книгу по символу и ребалансируются как единый портфель
+int runConsolidated(const BatchOptions& options, const std::vector<TargetAllocation>& targets, std::FILE* out) {
+    ThreadPool pool(options.threads);
+    IngestStats stats;
+    auto start = Clock::now();
+    ConsolidatedBook book = ingestPortfolioFiles(options.inputs, pool, &stats);
+    for (const auto& account : book.getAccounts()) {
+        if (!account.loaded) std::fprintf(stderr, "skip: %s\n", account.error.c_str());
+    }
+
+    auto t0 = Clock::now();
+    Portfolio portfolio;
+    book.toPortfolio(portfolio);
+    portfolio.applyTargets(targets);
+    std::vector<RebalanceAction> actions;
+    float extraCapital = 0.0f;
+    bool balanced = portfolio.calculateRebalance(actions, extraCapital);
+    auto t1 = Clock::now();
+    if (!balanced) {
+        std::fprintf(stderr, "error: targets sum to %.2f%% of the consolidated book, not 100%%\n",
+            portfolio.getTotalTargetPercent());
+        return 2;
+    }
+    {
+        CsvWriter writer(out);
+        writer.header();
+        for (const auto& action : actions) {
+            writer.row("consolidated", action);
+        }
+    }
+    auto t2 = Clock::now();
+
+    double totalMs = elapsedMs(start, t2);
+    double parseSeconds = stats.parseMs / 1000.0;
+    std::fprintf(stderr,
+        "consolidate: %zu files (%zu failed), %zu rows, %zu symbols, %zu threads\n"
+        "time: total %.2f ms, parse %.2f ms, merge %.2f ms, rebalance %.2f ms, write %.2f ms\n"
+        "throughput: %.1f files/s, %.0f rows/s\n",
+        stats.files, stats.failed, stats.rows, stats.symbols, stats.threads,
+        totalMs, stats.parseMs, stats.mergeMs, elapsedMs(t0, t1), elapsedMs(t1, t2),
+        parseSeconds > 0 ? stats.files / parseSeconds : 0.0, parseSeconds > 0 ? stats.rows / parseSeconds : 0.0);
+    return stats.failed == 0 ? 0 : 2;
+}
+
+int runBatch(const BatchOptions& options) {
+    const auto& inputs = options.inputs;
+    const auto& targetsPath = options.targetsPath;
+    std::string error;
+    SymbolTable targetNames;
+    std::vector<TargetAllocation> targets;
+    if (!targetsPath.empty() && !loadTargetsFile(targetsPath, targetNames, targets, &error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::FILE* out = options.outPath.empty() ? stdout : std::fopen(options.outPath.c_str(), "wb");
+    if (!out) {
+        std::fprintf(stderr, "error: cannot open %s for writing\n", options.outPath.c_str());
+        return 1;
+    }
+    if (options.consolidate) {
+        int code = runConsolidated(options, targets, out);
+        if (out != stdout) std::fclose(out);
+        return code;
+    }
+
+    Portfolio portfolio;
+    std::vector<RebalanceAction> actions;
+    size_t processed = 0, skipped = 0, positions = 0, rows = 0;
+    double loadMs = 0.0, rebalanceMs = 0.0, writeMs = 0.0;
+    auto start = Clock::now();
+    {
+        CsvWriter writer(out);
+        writer.header();
+        for (const auto& input : inputs) {
+            auto t0 = Clock::now();
+            bool loaded = loadPortfolioFile(input, portfolio, &error);
+            auto t1 = Clock::now();
+            loadMs += elapsedMs(t0, t1);
+            if (!loaded) {
+                std::fprintf(stderr, "skip: %s\n", error.c_str());
+                ++skipped;
+                continue;
+            }
+
+            float extraCapital = 0.0f;
+            if (!targetsPath.empty()) portfolio.applyTargets(targets);
+            bool balanced = portfolio.calculateRebalance(actions, extraCapital);
+            auto t2 = Clock::now();
+            rebalanceMs += elapsedMs(t1, t2);
+            if (!balanced) {
+                std::fprintf(stderr, "skip: %s: targets sum to %.2f%%, not 100%%\n",
+                    input.c_str(), portfolio.getTotalTargetPercent());
+                ++skipped;
+                continue;
+            }
+
+            for (const auto& action : actions) {
+                writer.row(input, action);
+            }
+            writeMs += elapsedMs(t2, Clock::now());
+            positions += portfolio.getAssets().size();
+            rows += actions.size();
+            ++processed;
+        }
+    }
+    double totalMs = elapsedMs(start, Clock::now());
+    if (out != stdout) std::fclose(out);
+
+    double seconds = totalMs / 1000.0;
+    std::fprintf(stderr,
+        "batch: %zu files (%zu skipped), %zu positions, %zu orders\n"
+        "time: total %.2f ms, load %.2f ms, rebalance %.2f ms, write %.2f ms\n"
+        "throughput: %.1f files/s, %.0f positions/s\n",
+        processed, skipped, positions, rows,
+        totalMs, loadMs, rebalanceMs, writeMs,
+        seconds > 0 ? processed / seconds : 0.0, seconds > 0 ? positions / seconds : 0.0);
+    return skipped == 0 ? 0 : 2;
+}
+
+// Пакет применяется к каждому файлу и записывается на место через временный файл;
+// файлы делятся между потоками пула, у каждого потока свой портфель
+int runCorporateActions(const BatchOptions& options) {
+    std::string error;
+    CorporateActionBatch batch;
+    if (!batch.loadFile(options.actionsPath, &error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    ThreadPool pool(options.threads);
+    const auto& inputs = options.inputs;
+    std::vector<std::string> errors(inputs.size());
+    std::vector<CorporateActionReport> reports(pool.size());
+    std::vector<size_t> rewritten(pool.size(), 0);
+    auto start = Clock::now();
+    pool.parallelFor(inputs.size(), 1, [&](size_t begin, size_t end, size_t slot) {
+        Portfolio portfolio;
+        CorporateActionReport& total = reports[slot];
+        for (size_t f = begin; f < end; ++f) {
+            if (!loadPortfolioFile(inputs[f], portfolio, &errors[f])) continue;
+            CorporateActionReport report = portfolio.applyCorporateActions(batch);
+            if (report.splits + report.dividends + report.renames == 0) continue;
+            std::string temporary = inputs[f] + ".tmp";
+            std::error_code ec;
+            if (!savePortfolioFile(temporary, portfolio)) {
+                errors[f] = "cannot write " + temporary;
+                continue;
+            }
+            std::filesystem::rename(temporary, inputs[f], ec);
+            if (ec) {
+                errors[f] = "cannot replace " + inputs[f] + ": " + ec.message();
+                continue;
+            }
+            total.splits += report.splits;
+            total.dividends += report.dividends;
+            total.renames += report.renames;
+            total.cashPaid += report.cashPaid;
+            ++rewritten[slot];
+        }
+    });
+    double totalMs = elapsedMs(start, Clock::now());
+
+    CorporateActionReport total;
+    size_t files = 0, failed = 0;
+    for (size_t slot = 0; slot < reports.size(); ++slot) {
+        total.splits += reports[slot].splits;
+        total.dividends += reports[slot].dividends;
+        total.renames += reports[slot].renames;
+        total.cashPaid += reports[slot].cashPaid;
+        files += rewritten[slot];
+    }
+    for (const auto& message : errors) {
+        if (message.empty()) continue;
+        std::fprintf(stderr, "skip: %s\n", message.c_str());
+        ++failed;
+    }
+    double seconds = totalMs / 1000.0;
+    std::fprintf(stderr,
+        "actions: %zu events, %zu files (%zu rewritten, %zu failed), %zu threads\n"
+        "rows: %zu split, %zu paid dividends, %zu renamed; cash credited %.2f (base currency)\n"
+        "time: %.2f ms, %.1f files/s\n",
+        batch.size(), inputs.size(), files, failed, pool.size(),
+        total.splits, total.dividends, total.renames, total.cashPaid,
+        totalMs, seconds > 0 ? inputs.size() / seconds : 0.0);
+    return failed == 0 ? 0 : 2;
+}
+
+double microseconds(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1000.0;
+}
+
+int runReplay(const ReplayCliOptions& options) {
+    std::string error;
+    Portfolio portfolio;
+    if (!loadPortfolioFile(options.portfolioPath, portfolio, &error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    PriceFeed feed;
+    if (options.synthetic > 0) {
+        feed.generateSynthetic(portfolio, options.synthetic, options.rate, options.seed);
+    }
+    else if (!feed.loadReplayFile(options.ticksPath, &error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    if (!options.saveTicksPath.empty() && !feed.saveReplayFile(options.saveTicksPath, &error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    feed.bind(portfolio.getSymbols());
+    if (feed.getUnboundSymbols() > 0) {
+        std::fprintf(stderr, "note: %zu feed symbols are not in the portfolio and are skipped\n",
+            feed.getUnboundSymbols());
+    }
+
+    PriceHistory history;
+    ReplayOptions replayOptions = options.replay;
+    if (options.history) replayOptions.history = &history;
+    double valueBefore = portfolio.getTotalValue();
+    ReplayReport report = replayIntoPortfolio(feed, portfolio, replayOptions);
+    const LatencyHistogram& latency = report.latency;
+    std::fprintf(stderr,
+        "replay: %zu ticks, %zu revaluations, %zu frames, %zu assets\n"
+        "time: %.2f ms, throughput %.0f ticks/s, %.0f revaluations/s\n"
+        "latency tick->revaluation (us): mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n"
+        "value: %.2f -> %.2f\n",
+        report.ticks, report.revaluations, report.frames, portfolio.getAssets().size(),
+        report.seconds * 1000.0,
+        report.seconds > 0 ? report.ticks / report.seconds : 0.0,
+        report.seconds > 0 ? report.revaluations / report.seconds : 0.0,
+        latency.getMean() / 1000.0, microseconds(latency.percentile(50)), microseconds(latency.percentile(90)),
+        microseconds(latency.percentile(99)), microseconds(latency.percentile(99.9)), microseconds(latency.getMax()),
+        valueBefore, portfolio.getTotalValue());
+    if (options.history) {
+        std::fprintf(stderr, "history: %zu series, %zu points (%zu out of order), %.2f MB, %.2f bytes/point\n",
+            history.seriesCount(), history.totalPoints(), report.historyRejected,
+            history.memoryUsage() / (1024.0 * 1024.0),
+            history.totalPoints() ? static_cast<double>(history.memoryUsage()) / history.totalPoints() : 0.0);
+
+        // Стоимость на сетке моментов записи: проверка as-of соединения по только что записанной истории
+        std::int64_t first = 0, last = 0;
+        bool any = false;
+        for (PriceHistory::SeriesId id = 0; id < history.seriesCount(); ++id) {
+            std::int64_t seriesFirst, seriesLast;
+            if (!history.timeRange(id, seriesFirst, seriesLast)) continue;
+            first = any ? std::min(first, seriesFirst) : seriesFirst;
+            last = any ? std::max(last, seriesLast) : seriesLast;
+            any = true;
+        }
+        if (any) {
+            const size_t count = 250;
+            std::vector<std::int64_t> times(count);
+            for (size_t i = 0; i < count; ++i) times[i] = first + (last - first) * static_cast<std::int64_t>(i) / (count - 1);
+            auto t0 = Clock::now();
+            std::vector<NavPoint> nav = valueSeriesAsOf(portfolio, history, times, ThreadPool::shared());
+            std::fprintf(stderr, "as-of: %zu moments in %.2f ms, first %.2f (%zu priced), last %.2f\n",
+                nav.size(), elapsedMs(t0, Clock::now()), nav.front().value, nav.front().priced, nav.back().value);
+        }
+    }
+    return 0;
+}
+
+// Ковариация факторной модели: 5 факторов плюс собственный риск, у которого положительная дисперсия
+int runFrontierBenchmark(size_t assets, std::uint64_t seed) {
+    const size_t factors = 5;
+    std::mt19937_64 random(seed);
+    std::normal_distribution<double> normal;
+    std::vector<double> loadings(assets * factors), covariance(assets * assets), expected(assets);
+    for (double& loading : loadings) loading = 0.01 * normal(random);
+    for (size_t i = 0; i < assets; ++i) {
+        expected[i] = 0.0003 + 0.0005 * normal(random);
+        for (size_t j = 0; j <= i; ++j) {
+            double sum = 0.0;
+            for (size_t f = 0; f < factors; ++f) sum += loadings[i * factors + f] * loadings[j * factors + f];
+            covariance[i * assets + j] = sum;
+            covariance[j * assets + i] = sum;
+        }
+        covariance[i * assets + i] += 1e-4 * (1.0 + std::abs(normal(random)));
+    }
+
+    EfficientFrontier frontier;
+    std::string error;
+    if (!solveEfficientFrontier(covariance, expected, frontier, &error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    auto t0 = Clock::now();
+    const size_t points = 50;
+    for (size_t k = 0; k < points; ++k) frontier.at(static_cast<double>(k) / (points - 1), covariance);
+    const double pointsMs = elapsedMs(t0, Clock::now());
+
+    // Условия оптимальности в каждом углу: градиент Σw - tμ равен -ν на активах портфеля и не меньше вне его
+    double worst = 0.0;
+    std::vector<double> gradient(assets);
+    for (const FrontierPoint& corner : frontier.corners) {
+        double scale = 0.0, level = 0.0;
+        bool any = false;
+        for (size_t i = 0; i < assets; ++i) {
+            double sum = 0.0;
+            for (size_t j = 0; j < assets; ++j) sum += covariance[i * assets + j] * corner.weights[j];
+            gradient[i] = sum - corner.riskAversion * expected[i];
+            scale = std::max(scale, std::abs(gradient[i]));
+            if (corner.weights[i] > 0.0 && (!any || gradient[i] > level)) level = gradient[i];
+            any = any || corner.weights[i] > 0.0;
+        }
+        for (size_t i = 0; i < assets; ++i) {
+            double residual = corner.weights[i] > 0.0 ? std::abs(gradient[i] - level) : std::max(0.0, level - gradient[i]);
+            if (scale > 0.0) worst = std::max(worst, residual / scale);
+        }
+    }
+    std::fprintf(stderr,
+        "frontier: %zu assets, %zu corners, %zu active-set steps, %zu excluded\n"
+        "time: %.2f ms solve, %.2f ms for %zu frontier points\n"
+        "return/volatility: %.6f/%.6f (max return) .. %.6f/%.6f (min risk)\n"
+        "worst relative KKT residual: %.3g\n",
+        assets, frontier.corners.size(), frontier.steps, frontier.excluded.size(),
+        frontier.elapsedMs, pointsMs, points,
+        frontier.corners.front().expectedReturn, frontier.corners.front().volatility,
+        frontier.corners.back().expectedReturn, frontier.corners.back().volatility, worst);
+    return 0;
+}
+
+// Счета с ежемесячными пополнениями и изредка небольшими выводами за десять лет: вложенное
+// не уходит в минус, и ставка единственная. Конечная стоимость — потоки, выросшие по известной
+// ставке, так что найденная ставка проверяется точно
+int runMoneyWeightedBenchmark(size_t accounts, std::uint64_t seed, size_t threads) {
+    constexpr std::int64_t kMonth = 30 * 24 * 60 * 60;
+    constexpr size_t kMonths = 120;
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<MoneyWeightedInput> inputs(accounts);
+    std::vector<double> truth(accounts);
+    const std::int64_t end = static_cast<std::int64_t>(kMonths) * kMonth;
+    for (size_t a = 0; a < accounts; ++a) {
+        MoneyWeightedInput& input = inputs[a];
+        truth[a] = -0.3 + 0.6 * uniform(random);
+        input.end = end;
+        input.flows.reserve(kMonths);
+        for (size_t m = 0; m < kMonths; ++m) {
+            double amount = 1000.0 * (0.5 + uniform(random));
+            if (m > 0 && uniform(random) < 0.1) amount *= -0.5;
+            const std::int64_t time = static_cast<std::int64_t>(m) * kMonth;
+            input.flows.push_back({ time, amount });
+            input.endValue += amount * std::pow(1.0 + truth[a], static_cast<double>(end - time) / (365.25 * 86400.0));
+        }
+    }
+
+    ThreadPool pool(threads);
+    auto t0 = Clock::now();
+    std::vector<MoneyWeightedReturn> results = moneyWeightedReturns(inputs, pool);
+    const double solveMs = elapsedMs(t0, Clock::now());
+    size_t unsolved = 0, bracketed = 0;
+    std::uint64_t iterations = 0;
+    double worst = 0.0;
+    for (size_t a = 0; a < accounts; ++a) {
+        iterations += results[a].iterations;
+        if (results[a].bracketed) ++bracketed;
+        if (!results[a].solved) ++unsolved;
+        else worst = std::max(worst, std::abs(results[a].rate - truth[a]));
+    }
+    std::fprintf(stderr,
+        "mwr: %zu accounts x %zu flows, %zu threads\n"
+        "time: %.2f ms (%.2f us per account), %.1f iterations per account\n"
+        "bisection fallback: %zu, unsolved: %zu, worst rate error: %.3g\n",
+        accounts, kMonths, pool.size(), solveMs, accounts ? solveMs * 1000.0 / accounts : 0.0,
+        accounts ? static_cast<double>(iterations) / accounts : 0.0, bracketed, unsolved, worst);
+    return unsolved == 0 ? 0 : 1;
+}
+
+} // namespace
+
+bool isCommandLineMode(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0 || std::strcmp(argv[i], "--replay") == 0 ||
+            std::strcmp(argv[i], "--actions") == 0 || std::strcmp(argv[i], "--frontier-benchmark") == 0 ||
+            std::strcmp(argv[i], "--mwr-benchmark") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int runCommandLine(int argc, char** argv) {
+    BatchOptions options;
+    ReplayCliOptions replay;
+    bool batch = false;
+    bool replayMode = false;
+    size_t frontierAssets = 0;
+    size_t moneyWeightedAccounts = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--batch") {
+            batch = true;
+        }
+        else if (arg == "--actions" && i + 1 < argc) {
+            options.actionsPath = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            replayMode = true;
+            replay.portfolioPath = argv[++i];
+        }
+        else if (arg == "--frontier-benchmark" && i + 1 < argc) {
+            frontierAssets = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--mwr-benchmark" && i + 1 < argc) {
+            moneyWeightedAccounts = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--ticks" && i + 1 < argc) {
+            replay.ticksPath = argv[++i];
+        }
+        else if (arg == "--synthetic" && i + 1 < argc) {
+            replay.synthetic = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            replay.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--rate" && i + 1 < argc) {
+            replay.rate = std::strtod(argv[++i], nullptr);
+        }
+        else if (arg == "--speed" && i + 1 < argc) {
+            ++i;
+            replay.replay.speed = std::strcmp(argv[i], "max") == 0 ? 0.0 : std::strtod(argv[i], nullptr);
+        }
+        else if (arg == "--frame-ms" && i + 1 < argc) {
+            replay.replay.frameMs = std::strtod(argv[++i], nullptr);
+        }
+        else if (arg == "--history") {
+            replay.history = true;
+        }
+        else if (arg == "--save-ticks" && i + 1 < argc) {
+            replay.saveTicksPath = argv[++i];
+        }
+        else if (arg == "--targets" && i + 1 < argc) {
+            options.targetsPath = argv[++i];
+        }
+        else if (arg == "--out" && i + 1 < argc) {
+            options.outPath = argv[++i];
+        }
+        else if (arg == "--consolidate") {
+            options.consolidate = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if ((batch || !options.actionsPath.empty()) && arg.rfind("--", 0) != 0) {
+            collectInputs(arg, options.inputs);
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (frontierAssets > 0 && !batch && !replayMode) return runFrontierBenchmark(frontierAssets, replay.seed);
+    if (moneyWeightedAccounts > 0 && !batch && !replayMode) {
+        return runMoneyWeightedBenchmark(moneyWeightedAccounts, replay.seed, options.threads);
+    }
+    if (!options.actionsPath.empty() && !batch && !replayMode) {
+        if (options.inputs.empty()) {
+            printUsage();
+            return 1;
+        }
+        return runCorporateActions(options);
+    }
+    if (replayMode && !batch) {
+        if (replay.ticksPath.empty() == (replay.synthetic == 0)) {
+            printUsage();
+            return 1;
+        }
+        return runReplay(replay);
+    }
+    if (!batch || options.inputs.empty() || (options.consolidate && options.targetsPath.empty())) {
+        printUsage();
+        return 1;
+    }
+    return runBatch(options);
+}
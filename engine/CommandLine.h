@@ -0,0 +1,20 @@
+#pragma once
+
+// Режимы без окна. Пример:
+//   PortfolioManager --batch in.json [more.json | dir/ ...] [--targets t.json] --out orders.csv
+// Без --targets используются цели, сохранённые в самих файлах портфелей.
+// Строки RebalanceAction пишутся в CSV (или stdout), статистика времени — в stderr.
+//   PortfolioManager --replay p.json (--ticks t.csv | --synthetic N [--seed S]) [--speed X|max]
+// Проигрывает котировки в портфель без окна и печатает пропускную способность и задержки.
+//   PortfolioManager --actions events.csv in.json [more.json | dir/ ...] [--threads N]
+// Применяет корпоративные действия к каждому файлу и перезаписывает его.
+//   PortfolioManager --frontier-benchmark N [--seed S]
+// Строит эффективную границу для N активов со случайной факторной ковариацией и печатает время.
+//   PortfolioManager --mwr-benchmark N [--seed S] [--threads N]
+// Считает MWR пакета из N синтетических счетов и печатает время и точность.
+
+// true, если аргументы требуют запуска без графического интерфейса
+bool isCommandLineMode(int argc, char** argv);
+
+// Возвращает код завершения процесса
+int runCommandLine(int argc, char** argv);
@@ -0,0 +1,124 @@
+#include "CorporateActions.h"
+#include "Calendar.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+// YYYY-MM-DD (полночь UTC) или миллисекунды Unix
+bool parseTime(const std::string& field, std::int64_t& time) {
+    std::int64_t days = 0;
+    if (parseIsoDate(field, days)) {
+        time = days * kSecondsPerDay * 1000;
+        return true;
+    }
+    char* end = nullptr;
+    long long value = std::strtoll(field.c_str(), &end, 10);
+    if (end == field.c_str() || *end != '\0') return false;
+    time = value;
+    return true;
+}
+
+bool parseType(std::string_view text, CorporateActionType& type) {
+    if (text == "split") type = CorporateActionType::Split;
+    else if (text == "stock_dividend") type = CorporateActionType::StockDividend;
+    else if (text == "cash_dividend") type = CorporateActionType::CashDividend;
+    else if (text == "rename") type = CorporateActionType::SymbolChange;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+bool CorporateActionBatch::loadFile(const std::string& path, std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Разбор идёт во временный пакет: при ошибке текущий остаётся нетронутым
+    CorporateActionBatch loaded;
+    size_t lineNumber = 0;
+    for (size_t begin = 0; begin < text.size();) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) end = text.size();
+        std::string_view line = trim(std::string_view(text).substr(begin, end - begin));
+        begin = end + 1;
+        ++lineNumber;
+        if (line.empty() || line.front() == '#') continue;
+
+        std::string_view fields[4];
+        size_t count = 0;
+        for (size_t from = 0; count < 4;) {
+            size_t comma = count < 3 ? line.find(',', from) : std::string_view::npos;
+            fields[count++] = trim(line.substr(from, comma == std::string_view::npos ? std::string_view::npos : comma - from));
+            if (comma == std::string_view::npos) break;
+            from = comma + 1;
+        }
+        std::int64_t time = 0;
+        CorporateActionType type;
+        bool timeOk = parseTime(std::string(fields[0]), time);
+        if (!timeOk && loaded.actions.empty()) continue; // заголовок
+        if (count < 4 || !timeOk || !parseType(fields[1], type) || fields[2].empty()) {
+            if (error) *error = path + ":" + std::to_string(lineNumber) + ": expected date,type,symbol,value";
+            return false;
+        }
+        if (type == CorporateActionType::SymbolChange) {
+            if (fields[3].empty()) {
+                if (error) *error = path + ":" + std::to_string(lineNumber) + ": rename needs a new symbol";
+                return false;
+            }
+            loaded.add(time, type, fields[2], 0.0, fields[3]);
+            continue;
+        }
+        std::string valueField(fields[3]);
+        char* valueEnd = nullptr;
+        double value = std::strtod(valueField.c_str(), &valueEnd);
+        bool positive = type == CorporateActionType::CashDividend ? value >= 0.0 : value > 0.0;
+        if (valueEnd == valueField.c_str() || !positive) {
+            if (error) *error = path + ":" + std::to_string(lineNumber) + ": bad value " + valueField;
+            return false;
+        }
+        loaded.add(time, type, fields[2], value);
+    }
+    loaded.build();
+    *this = std::move(loaded);
+    return true;
+}
+
+void CorporateActionBatch::add(std::int64_t time, CorporateActionType type, std::string_view symbol, double value,
+    std::string_view newSymbol) {
+    SymbolId id = symbols.intern(symbol);
+    SymbolId renamed = type == CorporateActionType::SymbolChange ? symbols.intern(newSymbol) : kInvalidSymbol;
+    actions.push_back({ time, type, id, renamed, value });
+}
+
+void CorporateActionBatch::build() {
+    // Устойчивая сортировка: события одного дня применяются в порядке файла
+    std::stable_sort(actions.begin(), actions.end(),
+        [](const CorporateAction& a, const CorporateAction& b) { return a.time < b.time; });
+    offsets.assign(symbols.size() + 1, 0);
+    for (const auto& action : actions) ++offsets[action.symbol + 1];
+    for (size_t s = 0; s < symbols.size(); ++s) offsets[s + 1] += offsets[s];
+    bySymbol.resize(actions.size());
+    std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (const auto& action : actions) bySymbol[cursor[action.symbol]++] = action;
+}
+
+void CorporateActionBatch::clear() {
+    symbols.clear();
+    actions.clear();
+    bySymbol.clear();
+    offsets.assign(1, 0);
+}
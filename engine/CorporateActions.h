@@ -0,0 +1,55 @@
+#pragma once
+
+#include "SymbolTable.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class CorporateActionType : std::uint8_t {
+    Split,         // value — новых бумаг за одну старую (2 — сплит 2:1, 0.1 — консолидация 10:1)
+    StockDividend, // value — дополнительных бумаг на одну бумагу (0.05 — 5%)
+    CashDividend,  // value — выплата на одну бумагу в валюте актива
+    SymbolChange,  // newSymbol — новый тикер
+};
+
+// Символы — id в таблице пакета, а не портфеля
+struct CorporateAction {
+    std::int64_t time; // дата отсечки, миллисекунды Unix
+    CorporateActionType type;
+    SymbolId symbol;
+    SymbolId newSymbol; // только для SymbolChange
+    double value;
+};
+
+// Пакет корпоративных действий, индексированный по символу: для каждого символа
+// его события лежат подряд по времени, так что применение к портфелю не просматривает весь пакет.
+// Заполняется loadFile или add с последующим build.
+class CorporateActionBatch {
+public:
+    // CSV "дата,тип,символ,значение": дата — YYYY-MM-DD (полночь UTC) или миллисекунды Unix,
+    // тип — split | stock_dividend | cash_dividend | rename; для rename значение — новый тикер.
+    // Строки, начинающиеся с '#', и строка заголовка пропускаются
+    bool loadFile(const std::string& path, std::string* error = nullptr);
+
+    void add(std::int64_t time, CorporateActionType type, std::string_view symbol, double value,
+        std::string_view newSymbol = {});
+    // Сортирует события по времени и строит индекс по символу
+    void build();
+    void clear();
+
+    const SymbolTable& getSymbols() const { return symbols; }
+    // Все события по времени
+    const std::vector<CorporateAction>& getActions() const { return actions; }
+    size_t size() const { return actions.size(); }
+    // События символа пакета по времени
+    const CorporateAction* begin(SymbolId symbol) const { return bySymbol.data() + offsets[symbol]; }
+    const CorporateAction* end(SymbolId symbol) const { return bySymbol.data() + offsets[symbol + 1]; }
+
+private:
+    SymbolTable symbols;
+    std::vector<CorporateAction> actions;
+    std::vector<CorporateAction> bySymbol;
+    std::vector<size_t> offsets{ 0 };
+};
@@ -0,0 +1,82 @@
+#include "FactorExposure.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr size_t kPortfolioBlock = 16;
+constexpr size_t kAssetTile = 128;
+
+// Блок портфелей [first, last): плитка активов проходит по всем портфелям блока, пока её строки в кэше
+void exposureBlock(const FactorLoadings& loadings, const double* weights, size_t first, size_t last, double* exposures) {
+    const size_t assets = loadings.assetCount();
+    const size_t factors = loadings.factorCount();
+    std::fill(exposures + first * factors, exposures + last * factors, 0.0);
+    for (size_t tile = 0; tile < assets; tile += kAssetTile) {
+        const size_t tileEnd = std::min(assets, tile + kAssetTile);
+        for (size_t p = first; p < last; ++p) {
+            const double* w = weights + p * assets;
+            double* out = exposures + p * factors;
+            for (size_t a = tile; a < tileEnd; ++a) {
+                const double weight = w[a];
+                if (weight == 0.0) continue;
+                const double* row = loadings.row(a);
+                for (size_t f = 0; f < factors; ++f) out[f] += weight * row[f];
+            }
+        }
+    }
+}
+
+} // namespace
+
+void FactorLoadings::assign(const FactorRegistry& registry, const std::vector<std::string_view>& symbols) {
+    resize(symbols.size(), registry.size());
+    for (size_t a = 0; a < symbols.size(); ++a) {
+        double* values = row(a);
+        for (size_t f = 0; f < factors; ++f) values[f] = registry.defaultLoading(static_cast<SymbolId>(f));
+        for (const FactorRegistry::Loading& loading : registry.loadings(symbols[a])) values[loading.factor] = loading.value;
+    }
+}
+
+void FactorLoadings::resize(size_t assetCount, size_t factorCount) {
+    assets = assetCount;
+    factors = factorCount;
+    values.assign(assets * factors, 0.0);
+}
+
+void computeExposures(const FactorLoadings& loadings, const double* weights, size_t portfolios, double* exposures,
+    ThreadPool& pool) {
+    const size_t blocks = (portfolios + kPortfolioBlock - 1) / kPortfolioBlock;
+    pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, size_t) {
+        exposureBlock(loadings, weights, begin * kPortfolioBlock, std::min(portfolios, end * kPortfolioBlock), exposures);
+    });
+}
+
+void ExposureTracker::reset(const FactorLoadings& loadings, std::vector<double> startWeights) {
+    weights = std::move(startWeights);
+    weights.resize(loadings.assetCount(), 0.0);
+    recompute(loadings);
+}
+
+void ExposureTracker::setWeight(const FactorLoadings& loadings, size_t asset, double weight) {
+    const double delta = weight - weights[asset];
+    if (delta == 0.0) return;
+    weights[asset] = weight;
+    if (++updates >= kRefresh) {
+        recompute(loadings);
+        return;
+    }
+    const double* row = loadings.row(asset);
+    for (size_t f = 0; f < exposures.size(); ++f) exposures[f] += delta * row[f];
+}
+
+void ExposureTracker::recompute(const FactorLoadings& loadings) {
+    updates = 0;
+    exposures.resize(loadings.factorCount());
+    if (weights.empty()) {
+        std::fill(exposures.begin(), exposures.end(), 0.0);
+        return;
+    }
+    exposureBlock(loadings, weights.data(), 0, 1, exposures.data());
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "StressTest.h"
+#include "ThreadPool.h"
+
+#include <string_view>
+#include <vector>
+
+// Нагрузки активов на факторы: плотная матрица активы × факторы, по строкам актива
+class FactorLoadings {
+public:
+    // Строка символа — нагрузки по умолчанию реестра с поправками из его явных нагрузок
+    void assign(const FactorRegistry& registry, const std::vector<std::string_view>& symbols);
+    // Нулевая матрица
+    void resize(size_t assets, size_t factors);
+
+    size_t assetCount() const { return assets; }
+    size_t factorCount() const { return factors; }
+    double* row(size_t asset) { return &values[asset * factors]; }
+    const double* row(size_t asset) const { return &values[asset * factors]; }
+
+private:
+    size_t assets = 0;
+    size_t factors = 0;
+    std::vector<double> values;
+};
+
+// E = W·L для пакета портфелей: weights — портфели × активы, exposures — портфели × факторы, по строкам.
+// Портфели делятся на блоки по потокам пула, активы — на плитки, строки которых остаются в кэше на весь
+// блок портфелей; внутренний цикл — E_p += w·L_a по факторам, нулевые доли пропускаются
+void computeExposures(const FactorLoadings& loadings, const double* weights, size_t portfolios, double* exposures,
+    ThreadPool& pool);
+
+// Экспозиции одного портфеля: смена одной доли обновляет их за O(факторов) вместо O(активов × факторов).
+// Раз в kRefresh обновлений экспозиции пересчитываются целиком, чтобы не копилась ошибка округления
+class ExposureTracker {
+public:
+    static constexpr size_t kRefresh = 4096;
+
+    void reset(const FactorLoadings& loadings, std::vector<double> weights);
+    void setWeight(const FactorLoadings& loadings, size_t asset, double weight);
+
+    const std::vector<double>& getWeights() const { return weights; }
+    const std::vector<double>& getExposures() const { return exposures; }
+
+private:
+    void recompute(const FactorLoadings& loadings);
+
+    std::vector<double> weights;
+    std::vector<double> exposures;
+    size_t updates = 0;
+};
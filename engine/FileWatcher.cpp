@@ -0,0 +1,94 @@
+#include "FileWatcher.h"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+bool FileWatcher::start(const std::string& watchedPath) {
+    stop();
+    path = watchedPath;
+    std::error_code ec;
+    lastWrite = fs::last_write_time(path, ec);
+    lastSize = fs::file_size(path, ec);
+    fs::path directory = fs::path(path).parent_path();
+    if (directory.empty()) directory = ".";
+
+#if defined(__linux__)
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) return false;
+    fileName = fs::path(path).filename().string();
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+#elif defined(_WIN32)
+    HANDLE handle = FindFirstChangeNotificationW(directory.wstring().c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    changeHandle = handle;
+#endif
+    active = true;
+    return true;
+}
+
+void FileWatcher::stop() {
+#if defined(__linux__)
+    if (inotifyFd >= 0) close(inotifyFd);
+    inotifyFd = -1;
+#elif defined(_WIN32)
+    if (changeHandle) FindCloseChangeNotification(static_cast<HANDLE>(changeHandle));
+    changeHandle = nullptr;
+#endif
+    active = false;
+}
+
+bool FileWatcher::fileChanged() {
+    std::error_code ec;
+    auto write = fs::last_write_time(path, ec);
+    if (ec) return false; // файл заменяется прямо сейчас — дождёмся следующего события
+    auto size = fs::file_size(path, ec);
+    if (ec || (write == lastWrite && size == lastSize)) return false;
+    lastWrite = write;
+    lastSize = size;
+    return true;
+}
+
+bool FileWatcher::poll() {
+    if (!active) return false;
+
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[4096];
+    bool touched = false;
+    for (;;) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) break; // EAGAIN: очередь событий пуста
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            if (event->len > 0 && fileName == event->name) touched = true;
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    // Событие inotify надёжнее сравнения времени: перезапись в ту же секунду тоже видна
+    if (touched) fileChanged();
+    return touched;
+#elif defined(_WIN32)
+    HANDLE handle = static_cast<HANDLE>(changeHandle);
+    if (WaitForSingleObject(handle, 0) != WAIT_OBJECT_0) return false;
+    FindNextChangeNotification(handle);
+    return fileChanged();
+#else
+    return fileChanged();
+#endif
+}
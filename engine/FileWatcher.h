@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Неблокирующее слежение за одним файлом: poll() вызывается раз в кадр.
+// Linux — inotify на каталог файла (ловит и перезапись, и атомарную замену через rename),
+// Windows — уведомления об изменениях каталога, остальные платформы — сравнение времени изменения.
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool start(const std::string& path);
+    void stop();
+    bool isActive() const { return active; }
+    const std::string& getPath() const { return path; }
+
+    // true, если файл изменился с прошлого вызова
+    bool poll();
+
+private:
+    // Отсекает ложные срабатывания от соседних файлов каталога
+    bool fileChanged();
+
+    std::string path;
+    bool active = false;
+    std::filesystem::file_time_type lastWrite{};
+    std::uintmax_t lastSize = 0;
+#if defined(__linux__)
+    int inotifyFd = -1;
+    std::string fileName;
+#elif defined(_WIN32)
+    void* changeHandle = nullptr;
+#endif
+};
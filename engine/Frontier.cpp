@@ -0,0 +1,246 @@
+#include "Frontier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Актив, чья остаточная дисперсия после проекции на свободные меньше этой доли собственной,
+// считается линейно зависимым
+constexpr double kPivotTolerance = 1e-12;
+
+// Разложение Холецкого Σ_FF свободных активов в порядке их входа; строки — по n элементов
+class FreeSet {
+public:
+    FreeSet(const double* covariance, size_t n) : covariance(covariance), n(n), factor(n * n, 0.0) {}
+
+    const std::vector<size_t>& getMembers() const { return members; }
+
+    // Новая строка L: решение L·l = Σ_F,asset и диагональ из остатка дисперсии
+    bool add(size_t asset) {
+        const size_t k = members.size();
+        double* row = &factor[k * n];
+        double squares = 0.0;
+        for (size_t j = 0; j < k; ++j) {
+            double sum = covariance[members[j] * n + asset];
+            const double* other = &factor[j * n];
+            for (size_t q = 0; q < j; ++q) sum -= other[q] * row[q];
+            row[j] = sum / other[j];
+            squares += row[j] * row[j];
+        }
+        const double variance = covariance[asset * n + asset];
+        const double rest = variance - squares;
+        if (!(rest > kPivotTolerance * variance)) return false;
+        row[k] = std::sqrt(rest);
+        members.push_back(asset);
+        return true;
+    }
+
+    // Строка position удаляется, а выступ над диагональю в следующих строках снимается
+    // вращениями соседних столбцов: L·G·(L·G)^T = L·L^T
+    void remove(size_t position) {
+        const size_t k = members.size();
+        for (size_t r = position; r + 1 < k; ++r) {
+            std::copy(&factor[(r + 1) * n], &factor[(r + 1) * n] + r + 2, &factor[r * n]);
+        }
+        for (size_t r = position; r + 1 < k; ++r) {
+            const double a = factor[r * n + r];
+            const double b = factor[r * n + r + 1];
+            const double length = std::hypot(a, b);
+            const double c = a / length, s = b / length;
+            for (size_t q = r; q + 1 < k; ++q) {
+                double* row = &factor[q * n];
+                const double x = row[r], y = row[r + 1];
+                row[r] = c * x + s * y;
+                row[r + 1] = c * y - s * x;
+            }
+        }
+        for (size_t r = 0; r + 1 < k; ++r) factor[r * n + k - 1] = 0.0;
+        members.erase(members.begin() + static_cast<std::ptrdiff_t>(position));
+    }
+
+    // Σ_FF·x = rhs прямой и обратной подстановкой; rhs и x — по members
+    void solve(const std::vector<double>& rhs, std::vector<double>& x) const {
+        const size_t k = members.size();
+        x.resize(k);
+        for (size_t j = 0; j < k; ++j) {
+            const double* row = &factor[j * n];
+            double sum = rhs[j];
+            for (size_t q = 0; q < j; ++q) sum -= row[q] * x[q];
+            x[j] = sum / row[j];
+        }
+        for (size_t j = k; j-- > 0;) {
+            double sum = x[j];
+            for (size_t q = j + 1; q < k; ++q) sum -= factor[q * n + j] * x[q];
+            x[j] = sum / factor[j * n + j];
+        }
+    }
+
+private:
+    const double* covariance;
+    size_t n;
+    std::vector<double> factor;
+    std::vector<size_t> members;
+};
+
+double portfolioVolatility(const std::vector<double>& weights, const std::vector<double>& covariance) {
+    const size_t n = weights.size();
+    double variance = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        if (weights[i] == 0.0) continue;
+        const double* row = &covariance[i * n];
+        for (size_t j = 0; j < n; ++j) {
+            if (weights[j] != 0.0) variance += weights[i] * weights[j] * row[j];
+        }
+    }
+    return std::sqrt(std::max(variance, 0.0));
+}
+
+void finishPoint(FrontierPoint& point, const std::vector<double>& covariance, const std::vector<double>& expected) {
+    point.expectedReturn = 0.0;
+    for (size_t i = 0; i < expected.size(); ++i) point.expectedReturn += point.weights[i] * expected[i];
+    point.volatility = portfolioVolatility(point.weights, covariance);
+}
+
+} // namespace
+
+bool solveEfficientFrontier(const std::vector<double>& covariance, const std::vector<double>& expected,
+    EfficientFrontier& frontier, std::string* error) {
+    const auto started = std::chrono::steady_clock::now();
+    frontier = EfficientFrontier();
+    const size_t n = expected.size();
+    if (n == 0 || covariance.size() != n * n) {
+        if (error) *error = "covariance and expected returns do not match";
+        return false;
+    }
+
+    // Угол максимальной доходности; из равных по доходности — наименьшая дисперсия
+    size_t top = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (expected[i] > expected[top] ||
+            (expected[i] == expected[top] && covariance[i * n + i] < covariance[top * n + top])) {
+            top = i;
+        }
+    }
+    FreeSet free(covariance.data(), n);
+    if (!free.add(top)) {
+        if (error) *error = "asset variance must be positive";
+        return false;
+    }
+    std::vector<char> state(n, 0); // 0 — на границе w = 0, 1 — свободен, 2 — исключён
+    state[top] = 1;
+    // Первый угол — момент входа второго актива; выше него веса те же
+    FrontierPoint corner;
+
+    // На отрезке с неизменным множеством F: w_F(t) = α + t·β, где α = Σ⁻¹1 / b, β = Σ⁻¹μ - (a / b)·Σ⁻¹1,
+    // a = 1ᵀΣ⁻¹μ, b = 1ᵀΣ⁻¹1; множитель ограничения w_i ≥ 0 для i вне F — z_i(t) = z0_i + t·z1_i
+    std::vector<double> ones, means, inverseOnes, inverseMeans, alpha, beta;
+    double t = std::numeric_limits<double>::infinity();
+    size_t lastMoved = top;
+    const size_t maxSteps = 20 * n + 100;
+    for (; frontier.steps < maxSteps; ++frontier.steps) {
+        const std::vector<size_t>& members = free.getMembers();
+        const size_t k = members.size();
+        ones.assign(k, 1.0);
+        means.resize(k);
+        for (size_t j = 0; j < k; ++j) means[j] = expected[members[j]];
+        free.solve(ones, inverseOnes);
+        free.solve(means, inverseMeans);
+        double a = 0.0, b = 0.0;
+        for (size_t j = 0; j < k; ++j) {
+            a += inverseMeans[j];
+            b += inverseOnes[j];
+        }
+        alpha.resize(k);
+        beta.resize(k);
+        for (size_t j = 0; j < k; ++j) {
+            alpha[j] = inverseOnes[j] / b;
+            beta[j] = inverseMeans[j] - a / b * inverseOnes[j];
+        }
+
+        // Следующее событие при уменьшении t — наибольшее t_e ≤ t; пропущенное из-за округления
+        // событие (t_e > t) срабатывает сразу
+        double next = -1.0;
+        size_t moved = n;
+        size_t leavingPosition = k;
+        for (size_t j = 0; j < k; ++j) {
+            if (members[j] == lastMoved || beta[j] <= 0.0) continue;
+            const double at = std::min(t, -alpha[j] / beta[j]);
+            if (at > next) {
+                next = at;
+                moved = members[j];
+                leavingPosition = j;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (state[i] != 0 || i == lastMoved) continue;
+            const double* row = &covariance[i * n];
+            double z0 = -1.0 / b, z1 = a / b - expected[i];
+            for (size_t j = 0; j < k; ++j) {
+                z0 += row[members[j]] * alpha[j];
+                z1 += row[members[j]] * beta[j];
+            }
+            if (z1 <= 0.0) continue;
+            const double at = std::min(t, -z0 / z1);
+            if (at > next) {
+                next = at;
+                moved = i;
+                leavingPosition = k;
+            }
+        }
+
+        if (next < 0.0 || moved == n) {
+            // До t = 0 событий нет: портфель минимального риска
+            corner.riskAversion = 0.0;
+            corner.weights.assign(n, 0.0);
+            for (size_t j = 0; j < k; ++j) corner.weights[members[j]] = std::max(0.0, alpha[j]);
+            finishPoint(corner, covariance, expected);
+            frontier.corners.push_back(corner);
+            break;
+        }
+        corner.riskAversion = next;
+        corner.weights.assign(n, 0.0);
+        for (size_t j = 0; j < k; ++j) corner.weights[members[j]] = std::max(0.0, alpha[j] + next * beta[j]);
+        finishPoint(corner, covariance, expected);
+        frontier.corners.push_back(corner);
+
+        if (leavingPosition < k) {
+            free.remove(leavingPosition);
+            state[moved] = 0;
+        } else if (free.add(moved)) {
+            state[moved] = 1;
+        } else {
+            state[moved] = 2;
+            frontier.excluded.push_back(moved);
+        }
+        t = next;
+        lastMoved = moved;
+    }
+    frontier.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+FrontierPoint EfficientFrontier::at(double fraction, const std::vector<double>& covariance) const {
+    FrontierPoint point;
+    if (corners.empty()) return point;
+    const double low = corners.back().expectedReturn;
+    const double high = corners.front().expectedReturn;
+    const double target = low + std::clamp(fraction, 0.0, 1.0) * (high - low);
+    // Доходность углов убывает с индексом
+    size_t segment = 0;
+    while (segment + 2 < corners.size() && corners[segment + 1].expectedReturn > target) ++segment;
+    const FrontierPoint& upper = corners[segment];
+    const FrontierPoint& lower = corners[std::min(segment + 1, corners.size() - 1)];
+    const double span = upper.expectedReturn - lower.expectedReturn;
+    const double share = span > 0.0 ? (target - lower.expectedReturn) / span : 1.0;
+    point.riskAversion = lower.riskAversion + share * (upper.riskAversion - lower.riskAversion);
+    point.weights.resize(upper.weights.size());
+    for (size_t i = 0; i < point.weights.size(); ++i) {
+        point.weights[i] = lower.weights[i] + share * (upper.weights[i] - lower.weights[i]);
+    }
+    point.expectedReturn = target;
+    point.volatility = portfolioVolatility(point.weights, covariance);
+    return point;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Портфель на эффективной границе: веса неотрицательны и в сумме дают 1
+struct FrontierPoint {
+    double riskAversion = 0.0; // t в min ½·wᵀΣw - t·μᵀw
+    double expectedReturn = 0.0;
+    double volatility = 0.0;
+    std::vector<double> weights;
+};
+
+struct EfficientFrontier {
+    std::vector<FrontierPoint> corners; // угловые портфели: от максимальной доходности к минимальному риску
+    size_t steps = 0;                   // смен активного множества
+    std::vector<size_t> excluded;       // активы, линейно зависимые от уже выбранных
+    double elapsedMs = 0.0;
+
+    // Точка на доле fraction пути по доходности от минимального риска (0) к максимальной доходности (1).
+    // Между соседними углами веса линейны по доходности, так что точка точная
+    FrontierPoint at(double fraction, const std::vector<double>& covariance) const;
+};
+
+// Граница long-only задачи для ковариации covariance (n × n по строкам) и ожидаемых доходностей expected.
+// Метод критической линии: от угла с одним активом максимальной доходности t уменьшается до нуля
+// (портфеля минимального риска), и на каждом шаге в активное множество входит или из него выходит
+// ровно один актив. Решение на новом отрезке начинается с множества предыдущего, а разложение
+// Холецкого свободных активов дописывается строкой или теряет строку вращениями Гивенса за O(k²)
+bool solveEfficientFrontier(const std::vector<double>& covariance, const std::vector<double>& expected,
+    EfficientFrontier& frontier, std::string* error = nullptr);
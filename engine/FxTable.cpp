@@ -0,0 +1,42 @@
+#include "FxTable.h"
+
+#include <cctype>
+
+namespace {
+
+std::string normalizeCode(std::string_view code) {
+    std::string normalized(code);
+    for (char& c : normalized) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return normalized;
+}
+
+} // namespace
+
+FxTable::FxTable(std::string_view baseCode) {
+    reset(baseCode);
+}
+
+CurrencyId FxTable::find(std::string_view code) const {
+    std::string normalized = normalizeCode(code);
+    for (size_t id = 0; id < codes.size(); ++id) {
+        if (codes[id] == normalized) return static_cast<CurrencyId>(id);
+    }
+    return kInvalidCurrency;
+}
+
+CurrencyId FxTable::intern(std::string_view code) {
+    CurrencyId id = find(code);
+    if (id != kInvalidCurrency) return id;
+    codes.push_back(normalizeCode(code));
+    rates.push_back(0.0);
+    return static_cast<CurrencyId>(codes.size() - 1);
+}
+
+void FxTable::setRate(CurrencyId id, double rate) {
+    if (id != kBaseCurrency && id < rates.size()) rates[id] = rate;
+}
+
+void FxTable::reset(std::string_view baseCode) {
+    codes.assign(1, normalizeCode(baseCode));
+    rates.assign(1, 1.0);
+}
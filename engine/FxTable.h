@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using CurrencyId = std::uint16_t;
+constexpr CurrencyId kBaseCurrency = 0;
+constexpr CurrencyId kInvalidCurrency = ~CurrencyId(0);
+
+// Валюты портфеля и их курсы к базовой валюте (всегда id 0 с курсом 1).
+// Валют единицы, поэтому поиск по коду линейный; курсы лежат сплошным массивом по id.
+class FxTable {
+public:
+    explicit FxTable(std::string_view baseCode = "RUB");
+
+    // Коды сравниваются без учёта регистра и хранятся заглавными (ISO 4217)
+    CurrencyId intern(std::string_view code);
+    CurrencyId find(std::string_view code) const;
+    const std::string& code(CurrencyId id) const { return codes[id]; }
+    const std::string& baseCode() const { return codes[kBaseCurrency]; }
+    size_t size() const { return codes.size(); }
+
+    // Единиц базовой валюты за единицу валюты; 0 — курс ещё неизвестен
+    double rate(CurrencyId id) const { return rates[id]; }
+    bool hasRate(CurrencyId id) const { return rates[id] > 0.0; }
+    const std::vector<double>& getRates() const { return rates; }
+    // Курс базовой валюты не меняется
+    void setRate(CurrencyId id, double rate);
+
+    // Оставляет только базовую валюту
+    void reset(std::string_view baseCode);
+
+private:
+    std::vector<std::string> codes;
+    std::vector<double> rates;
+};
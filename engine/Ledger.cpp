@@ -0,0 +1,536 @@
+#include "Ledger.h"
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+constexpr char kMagic[8] = { 'P', 'L', 'E', 'D', 'G', 'E', 'R', '1' };
+// 'E', время, тип, символ, новый символ, валюта, количество, значение
+constexpr size_t kEntryBytes = 1 + 8 + 1 + 4 + 4 + 2 + 8 + 8;
+
+template <class T>
+char* put(char* out, T value) {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+template <class T>
+const char* get(const char* in, T& value) {
+    std::memcpy(&value, in, sizeof(T));
+    return in + sizeof(T);
+}
+
+// Количество после сплита: дробная часть отбрасывается, знак сохраняется
+std::int64_t splitQuantity(std::int64_t quantity, double ratio) {
+    double exact = std::floor(std::fabs(static_cast<double>(quantity)) * ratio + 1e-9);
+    return quantity < 0 ? -static_cast<std::int64_t>(exact) : static_cast<std::int64_t>(exact);
+}
+
+// Сделка или корректировка позиции по цене price; стоимость покупки — по средней цене.
+// Пустая позиция получает price и как цену последней сделки
+void movePosition(LedgerPosition& position, std::int64_t quantity, double price) {
+    if (position.quantity == 0 || position.lastPrice == 0.0) position.lastPrice = price;
+    if (position.quantity == 0 || (position.quantity > 0) == (quantity > 0)) {
+        position.cost += static_cast<double>(quantity) * price;
+    } else if (std::llabs(quantity) <= std::llabs(position.quantity)) {
+        // Закрытие части позиции по средней цене
+        position.cost -= position.cost * static_cast<double>(quantity) / static_cast<double>(-position.quantity);
+    } else {
+        // Переворот позиции: остаток открывается по цене сделки
+        position.cost = static_cast<double>(position.quantity + quantity) * price;
+    }
+    position.quantity += quantity;
+    if (position.quantity == 0) position.cost = 0.0;
+}
+
+} // namespace
+
+bool Ledger::open(const std::string& filePath, std::string* error) {
+    close();
+    clear();
+    std::ifstream input(filePath, std::ios::binary);
+    std::string data;
+    if (input) data.assign((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+
+    size_t valid = 0;
+    if (!data.empty()) {
+        if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+            if (error) *error = filePath + ": not a ledger file";
+            return false;
+        }
+        // Разбор до первой неполной или противоречивой записи: это хвост, оборванный при сбое
+        const char* begin = data.data();
+        const char* end = begin + data.size();
+        const char* at = begin + sizeof(kMagic);
+        valid = sizeof(kMagic);
+        while (at < end) {
+            char kind = *at;
+            if (kind == 'S' || kind == 'C') {
+                std::uint32_t length = 0;
+                if (end - at < 5) break;
+                get(at + 1, length);
+                if (static_cast<size_t>(end - at - 5) < length) break;
+                std::string_view name(at + 5, length);
+                if (kind == 'S') symbols.intern(name);
+                else currencies.intern(name);
+                at += 5 + length;
+            } else if (kind == 'E') {
+                if (static_cast<size_t>(end - at) < kEntryBytes) break;
+                LedgerEntry entry;
+                std::uint8_t type = 0;
+                const char* field = get(at + 1, entry.time);
+                field = get(field, type);
+                field = get(field, entry.symbol);
+                field = get(field, entry.newSymbol);
+                field = get(field, entry.currency);
+                field = get(field, entry.quantity);
+                get(field, entry.value);
+                entry.type = static_cast<LedgerEntryType>(type);
+                const bool money = entry.type == LedgerEntryType::Trade || entry.type == LedgerEntryType::Cash
+                    || entry.type == LedgerEntryType::Adjustment;
+                bool known = type <= static_cast<std::uint8_t>(LedgerEntryType::Adjustment)
+                    && (entry.symbol < symbols.size()
+                        || ((entry.type == LedgerEntryType::Cash || entry.type == LedgerEntryType::Adjustment)
+                            && entry.symbol == kInvalidSymbol))
+                    && (entry.type != LedgerEntryType::Rename || entry.newSymbol < symbols.size())
+                    && (entry.type != LedgerEntryType::Split || entry.value > 0.0)
+                    && (!money || entry.currency < currencies.size());
+                if (!known || !append(entry)) break;
+                at += kEntryBytes;
+            } else {
+                break;
+            }
+            valid = static_cast<size_t>(at - begin);
+        }
+    }
+
+    std::error_code ec;
+    if (data.empty()) {
+        std::FILE* created = std::fopen(filePath.c_str(), "wb");
+        if (!created || std::fwrite(kMagic, 1, sizeof(kMagic), created) != sizeof(kMagic)) {
+            if (created) std::fclose(created);
+            if (error) *error = "cannot create " + filePath;
+            return false;
+        }
+        std::fclose(created);
+    } else if (valid < data.size()) {
+        std::filesystem::resize_file(filePath, valid, ec);
+        if (ec) {
+            if (error) *error = "cannot truncate " + filePath + ": " + ec.message();
+            return false;
+        }
+    }
+    file = std::fopen(filePath.c_str(), "ab");
+    if (!file) {
+        if (error) *error = "cannot open " + filePath;
+        return false;
+    }
+    path = filePath;
+    writtenSymbols = symbols.size();
+    writtenCurrencies = currencies.size();
+    return true;
+}
+
+bool Ledger::saveAs(const std::string& filePath, std::string* error) {
+    close();
+    std::string temporary = filePath + ".tmp";
+    file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        if (error) *error = "cannot create " + temporary;
+        return false;
+    }
+    std::fwrite(kMagic, 1, sizeof(kMagic), file);
+    writtenSymbols = 0;
+    writtenCurrencies = 0;
+    for (size_t i = 0; i < count; ++i) writeEntry(entry(i));
+    // Определения без записей тоже сохраняются, чтобы id совпали после загрузки
+    while (writtenSymbols < symbols.size()) writeName('S', symbols.name(static_cast<SymbolId>(writtenSymbols++)));
+    while (writtenCurrencies < currencies.size()) writeName('C', currencies.name(static_cast<SymbolId>(writtenCurrencies++)));
+    bool ok = std::fflush(file) == 0 && !std::ferror(file);
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    std::error_code ec;
+    if (ok) std::filesystem::rename(temporary, filePath, ec);
+    if (!ok || ec) {
+        std::filesystem::remove(temporary, ec);
+        if (error) *error = "cannot write " + filePath;
+        return false;
+    }
+    file = std::fopen(filePath.c_str(), "ab");
+    if (!file) {
+        if (error) *error = "cannot open " + filePath;
+        return false;
+    }
+    path = filePath;
+    return true;
+}
+
+void Ledger::flush() {
+    if (file) std::fflush(file);
+}
+
+void Ledger::close() {
+    if (file) std::fclose(file);
+    file = nullptr;
+    path.clear();
+}
+
+void Ledger::clear() {
+    close();
+    symbols.clear();
+    currencies.clear();
+    blocks.clear();
+    count = 0;
+    latest = 0;
+    state = LedgerState();
+    writtenSymbols = 0;
+    writtenCurrencies = 0;
+}
+
+bool Ledger::recordTrade(std::int64_t time, std::string_view symbol, std::int64_t quantity, double price,
+    std::string_view currency) {
+    if (quantity == 0 || time < lastTime()) return false;
+    return append({ time, LedgerEntryType::Trade, symbolId(symbol), kInvalidSymbol, currencyId(currency), quantity,
+        price });
+}
+
+bool Ledger::recordCash(std::int64_t time, std::string_view currency, double amount, std::string_view symbol) {
+    if (time < lastTime()) return false;
+    SymbolId source = symbol.empty() ? kInvalidSymbol : symbolId(symbol);
+    return append({ time, LedgerEntryType::Cash, source, kInvalidSymbol, currencyId(currency), 0, amount });
+}
+
+bool Ledger::recordSplit(std::int64_t time, std::string_view symbol, double ratio) {
+    if (!(ratio > 0.0) || time < lastTime()) return false;
+    return append({ time, LedgerEntryType::Split, symbolId(symbol), kInvalidSymbol, kBaseCurrency, 0, ratio });
+}
+
+bool Ledger::recordRename(std::int64_t time, std::string_view symbol, std::string_view newSymbol) {
+    if (time < lastTime() || symbol == newSymbol) return false;
+    SymbolId from = symbolId(symbol);
+    return append({ time, LedgerEntryType::Rename, from, symbolId(newSymbol), kBaseCurrency, 0, 0.0 });
+}
+
+bool Ledger::recordAdjustment(std::int64_t time, std::string_view symbol, std::int64_t quantity, double amount,
+    std::string_view currency) {
+    if (time < lastTime() || (symbol.empty() ? amount == 0.0 : quantity == 0)) return false;
+    if (symbol.empty()) {
+        return append({ time, LedgerEntryType::Adjustment, kInvalidSymbol, kInvalidSymbol, currencyId(currency), 0,
+            amount });
+    }
+    return append({ time, LedgerEntryType::Adjustment, symbolId(symbol), kInvalidSymbol, currencyId(currency),
+        quantity, amount });
+}
+
+LedgerEntry Ledger::entry(size_t index) const {
+    const Block& block = *blocks[index / kBlockEntries];
+    size_t i = index % kBlockEntries;
+    return { block.times[i], block.types[i], block.symbols[i], block.newSymbols[i], block.currencies[i],
+        block.quantities[i], block.values[i] };
+}
+
+void Ledger::positionsAsOf(std::int64_t time, LedgerState& out) const {
+    out.positions.assign(symbols.size(), LedgerPosition());
+    out.cash.assign(currencies.size(), 0.0);
+    // Последний блок, который начинается не позже time: все предыдущие целиком до него
+    auto after = std::upper_bound(blocks.begin(), blocks.end(), time,
+        [](std::int64_t value, const std::unique_ptr<Block>& block) { return value < block->times[0]; });
+    if (after == blocks.begin()) return;
+    const size_t index = static_cast<size_t>(after - blocks.begin()) - 1;
+    const Block& block = *blocks[index];
+    for (const auto& held : block.checkpoint.positions) out.positions[held.first] = held.second;
+    std::copy(block.checkpoint.cash.begin(), block.checkpoint.cash.end(), out.cash.begin());
+    const size_t used = std::min(kBlockEntries, count - index * kBlockEntries);
+    for (size_t i = 0; i < used && block.times[i] <= time; ++i) apply(entry(index * kBlockEntries + i), out);
+}
+
+size_t Ledger::recordLots(const Portfolio& portfolio) {
+    if (count != 0) return 0;
+    const SymbolTable& names = portfolio.getSymbols();
+    const FxTable& fx = portfolio.getFx();
+    std::vector<const Asset*> quote(names.size(), nullptr);
+    for (const auto& asset : portfolio.getAssets()) {
+        if (!quote[asset.symbol]) quote[asset.symbol] = &asset;
+    }
+    // Начальное пополнение на стоимость лотов, затем покупки в порядке открытия
+    std::vector<Lot> lots;
+    for (const auto& lot : portfolio.getLots()) {
+        if (lot.quantity > 0 && lot.symbol < quote.size() && quote[lot.symbol]) lots.push_back(lot);
+    }
+    if (lots.empty()) return 0;
+    std::stable_sort(lots.begin(), lots.end(),
+        [](const Lot& a, const Lot& b) { return a.openTime < b.openTime; });
+    std::vector<double> spent(fx.size(), 0.0);
+    for (const auto& lot : lots) {
+        spent[quote[lot.symbol]->currency] += static_cast<double>(lot.quantity) * lot.costPrice;
+    }
+    for (CurrencyId c = 0; c < spent.size(); ++c) {
+        if (spent[c] != 0.0) recordCash(lots.front().openTime, fx.code(c), spent[c]);
+    }
+    for (const auto& lot : lots) {
+        recordTrade(lot.openTime, names.name(lot.symbol), lot.quantity, lot.costPrice,
+            fx.code(quote[lot.symbol]->currency));
+    }
+    flush();
+    return count;
+}
+
+size_t Ledger::recordAdjustments(const Portfolio& portfolio, std::int64_t time) {
+    const size_t before = count;
+    const SymbolTable& names = portfolio.getSymbols();
+    const FxTable& fx = portfolio.getFx();
+    const std::int64_t at = std::max(time, lastTime());
+
+    // Количество и строка для цены по символу портфеля
+    std::vector<std::int64_t> held(names.size(), 0);
+    std::vector<const Asset*> quote(names.size(), nullptr);
+    for (const auto& asset : portfolio.getAssets()) {
+        held[asset.symbol] += asset.quantity;
+        if (!quote[asset.symbol]) quote[asset.symbol] = &asset;
+    }
+
+    // Символы портфеля: расхождение — корректировка по текущей цене
+    std::vector<bool> present(symbols.size(), false);
+    for (SymbolId symbol = 0; symbol < names.size(); ++symbol) {
+        if (!quote[symbol]) continue;
+        SymbolId local = symbols.find(names.name(symbol));
+        std::int64_t journaled = local == kInvalidSymbol ? 0 : state.positions[local].quantity;
+        if (local != kInvalidSymbol) present[local] = true;
+        if (held[symbol] != journaled) {
+            recordAdjustment(at, names.name(symbol), held[symbol] - journaled, quote[symbol]->price,
+                fx.code(quote[symbol]->currency));
+        }
+    }
+    // Позиции журнала, которых в портфеле нет, списываются по цене последней сделки
+    for (SymbolId local = 0; local < present.size(); ++local) {
+        const LedgerPosition& position = state.positions[local];
+        if (present[local] || position.quantity == 0) continue;
+        recordAdjustment(at, symbols.name(local), -position.quantity, position.lastPrice,
+            currencies.name(position.currency));
+    }
+
+    // Деньги: сначала валюты портфеля, затем оставшиеся только в журнале
+    std::vector<bool> settled(currencies.size(), false);
+    for (CurrencyId c = 0; c < fx.size(); ++c) {
+        SymbolId local = currencies.find(fx.code(c));
+        double journaled = local == kInvalidSymbol ? 0.0 : state.cash[local];
+        if (local != kInvalidSymbol) settled[local] = true;
+        double difference = portfolio.getCash(c) - journaled;
+        if (std::fabs(difference) > 1e-6) recordAdjustment(at, {}, 0, difference, fx.code(c));
+    }
+    for (size_t local = 0; local < settled.size(); ++local) {
+        if (settled[local] || std::fabs(state.cash[local]) <= 1e-6) continue;
+        recordAdjustment(at, {}, 0, -state.cash[local], currencies.name(static_cast<SymbolId>(local)));
+    }
+    flush();
+    return count - before;
+}
+
+void Ledger::applyTo(Portfolio& portfolio) const {
+    const SymbolTable& names = portfolio.getSymbols();
+    const size_t symbolCount = names.size();
+    // Расхождение символа достаётся первой строке с этим именем, как у сделок ребалансировки
+    std::vector<std::int64_t> held(symbolCount, 0);
+    std::vector<size_t> first(symbolCount, portfolio.getAssets().size());
+    for (size_t i = portfolio.getAssets().size(); i-- > 0;) {
+        const Asset& asset = portfolio.getAssets()[i];
+        held[asset.symbol] += asset.quantity;
+        first[asset.symbol] = i;
+    }
+    std::vector<bool> present(symbols.size(), false);
+    for (SymbolId symbol = 0; symbol < symbolCount; ++symbol) {
+        if (first[symbol] == portfolio.getAssets().size()) continue;
+        SymbolId local = symbols.find(names.name(symbol));
+        std::int64_t journaled = local == kInvalidSymbol ? 0 : state.positions[local].quantity;
+        if (local != kInvalidSymbol) present[local] = true;
+        if (journaled != held[symbol]) {
+            const Asset& asset = portfolio.getAssets()[first[symbol]];
+            portfolio.setQuantity(first[symbol], static_cast<int>(asset.quantity + journaled - held[symbol]));
+        }
+    }
+    for (SymbolId local = 0; local < present.size(); ++local) {
+        const LedgerPosition& position = state.positions[local];
+        if (present[local] || position.quantity == 0) continue;
+        portfolio.addAsset(symbols.name(local), static_cast<int>(position.quantity),
+            static_cast<float>(position.lastPrice), 0, portfolio.currency(currencies.name(position.currency)));
+    }
+
+    const size_t currencyCount = portfolio.getFx().size();
+    std::vector<bool> settled(currencies.size(), false);
+    for (CurrencyId c = 0; c < currencyCount; ++c) {
+        SymbolId local = currencies.find(portfolio.getFx().code(c));
+        double journaled = local == kInvalidSymbol ? 0.0 : state.cash[local];
+        if (local != kInvalidSymbol) settled[local] = true;
+        if (journaled != portfolio.getCash(c)) portfolio.addCash(c, journaled - portfolio.getCash(c));
+    }
+    for (SymbolId local = 0; local < settled.size(); ++local) {
+        if (settled[local] || state.cash[local] == 0.0) continue;
+        portfolio.addCash(portfolio.currency(currencies.name(local)), state.cash[local]);
+    }
+}
+
+size_t Ledger::applyCorporateActions(const CorporateActionBatch& batch, const Portfolio& portfolio) {
+    const size_t before = count;
+    const SymbolTable& names = batch.getSymbols();
+    // Цена для выплаты за дробные бумаги: у первой строки портфеля, иначе последней сделки;
+    // сплиты делят её так же, как цену актива в портфеле
+    std::vector<double> quotes;
+    auto quote = [&](SymbolId local) -> double& {
+        if (quotes.size() <= local) quotes.resize(symbols.size(), -1.0);
+        if (quotes[local] < 0.0) {
+            quotes[local] = state.positions[local].lastPrice;
+            SymbolId held = portfolio.getSymbols().find(symbols.name(local));
+            for (const auto& asset : portfolio.getAssets()) {
+                if (asset.symbol != held) continue;
+                quotes[local] = asset.price;
+                break;
+            }
+        }
+        return quotes[local];
+    };
+    for (const auto& action : batch.getActions()) {
+        std::string_view name = names.name(action.symbol);
+        SymbolId local = symbols.find(name);
+        if (local == kInvalidSymbol || state.positions[local].quantity == 0) continue;
+        const double quantity = static_cast<double>(state.positions[local].quantity);
+        const std::string_view currency = currencies.name(state.positions[local].currency);
+        const std::int64_t at = std::max(action.time / 1000, lastTime());
+        switch (action.type) {
+        case CorporateActionType::Split:
+        case CorporateActionType::StockDividend: {
+            const double ratio = action.type == CorporateActionType::Split ? action.value : 1.0 + action.value;
+            double& price = quote(local);
+            if (!recordSplit(at, name, ratio)) break;
+            const double exact = quantity * ratio;
+            price /= ratio;
+            const double received = std::max(0.0, exact - std::floor(exact + 1e-9)) * price;
+            if (received > 0.0) recordCash(at, currency, received, name);
+            break;
+        }
+        case CorporateActionType::CashDividend:
+            recordCash(at, currency, quantity * action.value, name);
+            break;
+        case CorporateActionType::SymbolChange: {
+            const double price = quote(local);
+            if (!recordRename(at, name, names.name(action.newSymbol))) break;
+            quote(symbols.find(names.name(action.newSymbol))) = price;
+            break;
+        }
+        }
+    }
+    flush();
+    return count - before;
+}
+
+SymbolId Ledger::symbolId(std::string_view name) {
+    SymbolId id = symbols.intern(name);
+    if (state.positions.size() < symbols.size()) state.positions.resize(symbols.size());
+    return id;
+}
+
+CurrencyId Ledger::currencyId(std::string_view code) {
+    CurrencyId id = static_cast<CurrencyId>(currencies.intern(code));
+    if (state.cash.size() < currencies.size()) state.cash.resize(currencies.size(), 0.0);
+    return id;
+}
+
+bool Ledger::append(const LedgerEntry& entry) {
+    if (count && entry.time < latest) return false;
+    if (state.positions.size() < symbols.size()) state.positions.resize(symbols.size());
+    if (state.cash.size() < currencies.size()) state.cash.resize(currencies.size(), 0.0);
+    if (count % kBlockEntries == 0) {
+        // Новый блок начинается с контрольной точки текущего состояния
+        blocks.push_back(std::make_unique<Block>());
+        Checkpoint& checkpoint = blocks.back()->checkpoint;
+        for (SymbolId symbol = 0; symbol < state.positions.size(); ++symbol) {
+            if (state.positions[symbol].quantity != 0) checkpoint.positions.emplace_back(symbol, state.positions[symbol]);
+        }
+        checkpoint.cash = state.cash;
+    }
+    Block& block = *blocks.back();
+    const size_t i = count % kBlockEntries;
+    block.times[i] = entry.time;
+    block.types[i] = entry.type;
+    block.symbols[i] = entry.symbol;
+    block.newSymbols[i] = entry.newSymbol;
+    block.currencies[i] = entry.currency;
+    block.quantities[i] = entry.quantity;
+    block.values[i] = entry.value;
+    ++count;
+    latest = entry.time;
+    apply(entry, state);
+    if (file) writeEntry(entry);
+    return true;
+}
+
+void Ledger::apply(const LedgerEntry& entry, LedgerState& target) {
+    switch (entry.type) {
+    case LedgerEntryType::Trade: {
+        LedgerPosition& position = target.positions[entry.symbol];
+        movePosition(position, entry.quantity, entry.value);
+        position.lastPrice = entry.value;
+        position.currency = entry.currency;
+        target.cash[entry.currency] -= static_cast<double>(entry.quantity) * entry.value;
+        break;
+    }
+    case LedgerEntryType::Cash:
+        target.cash[entry.currency] += entry.value;
+        break;
+    case LedgerEntryType::Split: {
+        LedgerPosition& position = target.positions[entry.symbol];
+        position.quantity = splitQuantity(position.quantity, entry.value);
+        position.lastPrice /= entry.value;
+        if (position.quantity == 0) position.cost = 0.0;
+        break;
+    }
+    case LedgerEntryType::Rename: {
+        LedgerPosition moved = target.positions[entry.symbol];
+        target.positions[entry.symbol] = LedgerPosition();
+        LedgerPosition& position = target.positions[entry.newSymbol];
+        position.quantity += moved.quantity;
+        position.cost += moved.cost;
+        position.lastPrice = moved.lastPrice;
+        position.currency = moved.currency;
+        break;
+    }
+    case LedgerEntryType::Adjustment:
+        if (entry.symbol == kInvalidSymbol) {
+            target.cash[entry.currency] += entry.value;
+        } else {
+            // Цена последней сделки остаётся: корректировка — не сделка
+            LedgerPosition& position = target.positions[entry.symbol];
+            movePosition(position, entry.quantity, entry.value);
+            position.currency = entry.currency;
+        }
+        break;
+    }
+}
+
+void Ledger::writeEntry(const LedgerEntry& entry) {
+    while (writtenSymbols < symbols.size()) writeName('S', symbols.name(static_cast<SymbolId>(writtenSymbols++)));
+    while (writtenCurrencies < currencies.size()) writeName('C', currencies.name(static_cast<SymbolId>(writtenCurrencies++)));
+    char record[kEntryBytes];
+    char* out = put(record, 'E');
+    out = put(out, entry.time);
+    out = put(out, static_cast<std::uint8_t>(entry.type));
+    out = put(out, entry.symbol);
+    out = put(out, entry.newSymbol);
+    out = put(out, entry.currency);
+    out = put(out, entry.quantity);
+    put(out, entry.value);
+    std::fwrite(record, 1, sizeof(record), file);
+}
+
+void Ledger::writeName(char kind, std::string_view name) {
+    char header[5];
+    put(put(header, kind), static_cast<std::uint32_t>(name.size()));
+    std::fwrite(header, 1, sizeof(header), file);
+    std::fwrite(name.data(), 1, name.size(), file);
+}
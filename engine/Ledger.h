@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CorporateActions.h"
+#include "FxTable.h"
+#include "SymbolTable.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Portfolio;
+
+enum class LedgerEntryType : std::uint8_t {
+    Trade,      // quantity — купленные (+) или проданные (-) бумаги, value — цена в валюте currency;
+                // деньги этой валюты меняются на -quantity * value
+    Cash,       // value — пополнение (+) или вывод (-) денег в валюте currency; symbol — источник
+                // выплаты (денежный дивиденд) или kInvalidSymbol
+    Split,      // value — новых бумаг за одну старую; стоимость покупки позиции не меняется
+    Rename,     // позиция symbol переходит к newSymbol
+    Adjustment, // правка учёта, а не сделка: quantity бумаг symbol по цене value без движения денег
+                // или, при symbol = kInvalidSymbol, value денег валюты currency; не прибыль и не поток
+};
+
+// Символы и валюты — id в таблицах журнала, а не портфеля
+struct LedgerEntry {
+    std::int64_t time; // секунды Unix
+    LedgerEntryType type;
+    SymbolId symbol;
+    SymbolId newSymbol;
+    CurrencyId currency;
+    std::int64_t quantity;
+    double value;
+};
+
+struct LedgerPosition {
+    std::int64_t quantity = 0;
+    double cost = 0.0;      // стоимость покупки всей позиции по средней цене, в валюте позиции
+    double lastPrice = 0.0; // цена последней сделки; у открытой корректировкой — её цена
+    CurrencyId currency = kBaseCurrency;
+};
+
+// Позиции по символу журнала (пустые — с нулевым количеством) и деньги по валюте журнала
+struct LedgerState {
+    std::vector<LedgerPosition> positions;
+    std::vector<double> cash;
+};
+
+// Журнал сделок и движений денег — источник истины для позиций.
+// Записи только дописываются, в неубывающем порядке времени, и лежат колонками в блоках
+// по kBlockEntries; блоки не перемещаются. В начале каждого блока хранится контрольная точка —
+// позиции и деньги на момент перед его первой записью, поэтому состояние на любую дату
+// восстанавливается копией точки и проигрыванием не больше одного блока.
+// Файл журнала — тоже только дописываемый: определения символов и валют идут перед первой
+// записью, которая на них ссылается; оборванный хвост при открытии отбрасывается.
+class Ledger {
+public:
+    static constexpr size_t kBlockEntries = 4096;
+
+    Ledger() = default;
+    Ledger(const Ledger&) = delete;
+    Ledger& operator=(const Ledger&) = delete;
+    ~Ledger() { close(); }
+
+    // Загружает журнал и дальше дописывает в тот же файл; несуществующий файл создаётся
+    bool open(const std::string& path, std::string* error = nullptr);
+    // Записывает журнал целиком в новый файл и переключает дописывание на него
+    bool saveAs(const std::string& path, std::string* error = nullptr);
+    // Дописанное доходит до диска
+    void flush();
+    void close();
+    // Очищает журнал в памяти и отсоединяет файл
+    void clear();
+    const std::string& getPath() const { return path; }
+
+    // false, если запись раньше последней
+    bool recordTrade(std::int64_t time, std::string_view symbol, std::int64_t quantity, double price,
+        std::string_view currency);
+    bool recordCash(std::int64_t time, std::string_view currency, double amount, std::string_view symbol = {});
+    bool recordSplit(std::int64_t time, std::string_view symbol, double ratio);
+    bool recordRename(std::int64_t time, std::string_view symbol, std::string_view newSymbol);
+    // Пустой symbol — корректировка денег на amount валюты currency, иначе бумаг на quantity по цене amount
+    bool recordAdjustment(std::int64_t time, std::string_view symbol, std::int64_t quantity, double amount,
+        std::string_view currency);
+
+    size_t size() const { return count; }
+    LedgerEntry entry(size_t index) const;
+    std::int64_t lastTime() const { return count ? latest : 0; }
+    const SymbolTable& getSymbols() const { return symbols; }
+    const SymbolTable& getCurrencies() const { return currencies; }
+
+    // Текущее состояние после всех записей
+    const LedgerState& current() const { return state; }
+    // Состояние после всех записей со временем не позже time
+    void positionsAsOf(std::int64_t time, LedgerState& out) const;
+
+    // Заполняет пустой журнал лотами портфеля: пополнение на их стоимость и покупки по цене и
+    // времени открытия. Возвращает число новых записей
+    size_t recordLots(const Portfolio& portfolio);
+    // Правки портфеля вне сделок (первая загрузка, изменение файла на диске): расхождения
+    // в количестве записываются корректировками по текущей цене актива (символы, которых нет
+    // в портфеле, — по цене последней сделки), в деньгах — корректировками денег.
+    // Записи получают время не раньше последней. Возвращает число новых записей
+    size_t recordAdjustments(const Portfolio& portfolio, std::int64_t time);
+    // Количества и деньги портфеля берутся из журнала; позиции журнала, которых в портфеле нет,
+    // добавляются строками по цене последней сделки (без цвета)
+    void applyTo(Portfolio& portfolio) const;
+
+    // Сплиты, дивиденды акциями, денежные дивиденды и смены тикера пакета для позиций журнала,
+    // в порядке времени; записи получают время не раньше последней. Дробные бумаги после сплита
+    // выплачиваются деньгами по цене актива в портфеле (без строки — по цене последней сделки),
+    // как это делает Portfolio::applyCorporateActions; поэтому вызывать до него.
+    // Возвращает число новых записей
+    size_t applyCorporateActions(const CorporateActionBatch& batch, const Portfolio& portfolio);
+
+private:
+    struct Checkpoint {
+        std::vector<std::pair<SymbolId, LedgerPosition>> positions; // только непустые
+        std::vector<double> cash;
+    };
+
+    // Колонки блока
+    struct Block {
+        std::int64_t times[kBlockEntries];
+        LedgerEntryType types[kBlockEntries];
+        SymbolId symbols[kBlockEntries];
+        SymbolId newSymbols[kBlockEntries];
+        CurrencyId currencies[kBlockEntries];
+        std::int64_t quantities[kBlockEntries];
+        double values[kBlockEntries];
+        Checkpoint checkpoint;
+    };
+
+    SymbolId symbolId(std::string_view name);
+    CurrencyId currencyId(std::string_view code);
+    bool append(const LedgerEntry& entry);
+    static void apply(const LedgerEntry& entry, LedgerState& target);
+    void writeEntry(const LedgerEntry& entry);
+    void writeName(char kind, std::string_view name);
+
+    SymbolTable symbols;
+    SymbolTable currencies;
+    std::vector<std::unique_ptr<Block>> blocks;
+    size_t count = 0;
+    std::int64_t latest = 0;
+    LedgerState state;
+
+    std::string path;
+    std::FILE* file = nullptr;
+    size_t writtenSymbols = 0; // определения, уже лежащие в файле
+    size_t writtenCurrencies = 0;
+};
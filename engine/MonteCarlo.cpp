@@ -0,0 +1,326 @@
+#include "MonteCarlo.h"
+#include "Philox.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kLanes = 16;
+constexpr int kBins = 2048;
+constexpr float kLogRange = 5.0f; // гистограмма покрывает прирост от e^-5 до e^5
+
+// Ветвления и вызовы libm не дают компилятору векторизовать цикл по путям, поэтому логарифм,
+// корень, синус с косинусом для Бокса — Мюллера и экспонента считаются здесь многочленами
+// без ветвлений; относительная погрешность около 1e-6
+
+// ln(u) для u в (0, 1): показатель из битов, мантисса m в [1, 2) — ряд atanh по (m - 1) / (m + 1)
+inline float polyLog(float u) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &u, sizeof(bits));
+    const float exponent = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+    bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    const float y = (m - 1.0f) / (m + 1.0f);
+    const float y2 = y * y;
+    const float series = y * (2.0f + y2 * (2.0f / 3 + y2 * (2.0f / 5 + y2 * (2.0f / 7 + y2 * (2.0f / 9)))));
+    return exponent * 0.693147180560f + series;
+}
+
+// sqrt(x) для x > 0: начальное приближение из битов и три итерации Ньютона
+inline float polySqrt(float x) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5F375A86u - (bits >> 1);
+    float inverse;
+    std::memcpy(&inverse, &bits, sizeof(inverse));
+    for (int i = 0; i < 3; ++i) inverse *= 1.5f - 0.5f * x * inverse * inverse;
+    return x * inverse;
+}
+
+// cos и sin угла 2π·t для t в [0, 1): четверть оборота по t, внутри неё — ряды Тейлора
+inline void polySinCos(float t, float& c, float& s) {
+    const float turns = t * 4.0f;
+    const int quadrant = static_cast<int>(turns);
+    const float x = (turns - static_cast<float>(quadrant)) * 1.57079632679f;
+    const float x2 = x * x;
+    const float sine = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880
+        + x2 * (-1.0f / 39916800))))));
+    const float cosine = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320
+        + x2 * (-1.0f / 3628800)))));
+    // Поворот на quadrant четвертей: (c, s) → (-s, c)
+    const float swapC = (quadrant & 1) ? -sine : cosine;
+    const float swapS = (quadrant & 1) ? cosine : sine;
+    c = (quadrant & 2) ? -swapC : swapC;
+    s = (quadrant & 2) ? -swapS : swapS;
+}
+
+// e^x, x ограничен ±80: 2^n из битов показателя, 2^f при f в [0, 1] — ряд Тейлора восьмого порядка.
+// min и max выражены через модуль: сравнения с плавающей точкой компилятор не векторизует
+inline float polyExp(float x) {
+    x = 0.5f * (x + 80.0f - std::fabs(x - 80.0f));
+    x = 0.5f * (x - 80.0f + std::fabs(x + 80.0f));
+    const float t = x * 1.44269504089f;
+    const int n = static_cast<int>(t) - (t < 0.0f ? 1 : 0);
+    const float f = (t - static_cast<float>(n)) * 0.69314718056f;
+    const float power = 1.0f + f * (1.0f + f * (0.5f + f * (1.0f / 6 + f * (1.0f / 24 + f * (1.0f / 120
+        + f * (1.0f / 720 + f * (1.0f / 5040 + f * (1.0f / 40320))))))));
+    const std::uint32_t bits = static_cast<std::uint32_t>(n + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return scale * power;
+}
+
+void addPositionValue(float* wealth, const float* logs, float value) {
+    for (size_t lane = 0; lane < kLanes; ++lane) wealth[lane] += value * polyExp(logs[lane]);
+}
+
+int wealthBin(double wealth, double initial) {
+    if (wealth <= 0.0) return 0;
+    const double position = (std::log(wealth / initial) + kLogRange) / (2.0 * kLogRange) * kBins;
+    return static_cast<int>(std::clamp(position, 0.0, static_cast<double>(kBins - 1)));
+}
+
+float levelFromHistogram(const std::uint64_t* histogram, std::uint64_t total, float percentile, double initial) {
+    const double target = percentile / 100.0 * static_cast<double>(total);
+    double cumulative = 0.0;
+    for (int bin = 0; bin < kBins; ++bin) {
+        const double count = static_cast<double>(histogram[bin]);
+        if (count > 0.0 && cumulative + count >= target) {
+            const double fraction = (target - cumulative) / count;
+            const double x = -kLogRange + (bin + fraction) * (2.0 * kLogRange / kBins);
+            return static_cast<float>(initial * std::exp(x));
+        }
+        cumulative += count;
+    }
+    return static_cast<float>(initial * std::exp(kLogRange));
+}
+
+} // namespace
+
+void MonteCarloInput::estimateGbm(float fallbackDrift, float fallbackVolatility) {
+    const size_t assets = values.size();
+    drift.assign(assets, fallbackDrift);
+    volatility.assign(assets, fallbackVolatility);
+    cholesky.clear();
+    if (history.columns != assets) return;
+    std::vector<size_t> first(assets, history.bars);
+    std::vector<bool> estimated(assets, false);
+    for (size_t a = 0; a < assets; ++a) {
+        // Бары до начала ряда не считаются
+        first[a] = 0;
+        while (first[a] < history.bars && history.at(first[a], a) == 0.0f) ++first[a];
+        size_t nonZero = 0;
+        double sum = 0.0;
+        for (size_t k = first[a]; k < history.bars; ++k) {
+            sum += history.at(k, a);
+            nonZero += history.at(k, a) != 0.0f;
+        }
+        const size_t count = history.bars - first[a];
+        if (nonZero < 2) continue;
+        const double mean = sum / static_cast<double>(count);
+        double squares = 0.0;
+        for (size_t k = first[a]; k < history.bars; ++k) {
+            const double deviation = history.at(k, a) - mean;
+            squares += deviation * deviation;
+        }
+        drift[a] = static_cast<float>(mean);
+        volatility[a] = static_cast<float>(std::sqrt(squares / static_cast<double>(count - 1)));
+        estimated[a] = true;
+    }
+
+    // Ковариация: на диагонали — квадраты volatility, вне её — по общим барам пары
+    std::vector<double> covariance(assets * assets, 0.0);
+    for (size_t a = 0; a < assets; ++a) {
+        covariance[a * assets + a] = static_cast<double>(volatility[a]) * volatility[a];
+        if (!estimated[a]) continue;
+        for (size_t b = 0; b < a; ++b) {
+            if (!estimated[b]) continue;
+            const size_t start = std::max(first[a], first[b]);
+            if (history.bars - start < 2) continue;
+            double meanA = 0.0, meanB = 0.0;
+            for (size_t k = start; k < history.bars; ++k) {
+                meanA += history.at(k, a);
+                meanB += history.at(k, b);
+            }
+            const double count = static_cast<double>(history.bars - start);
+            meanA /= count;
+            meanB /= count;
+            double product = 0.0;
+            for (size_t k = start; k < history.bars; ++k) product += (history.at(k, a) - meanA) * (history.at(k, b) - meanB);
+            covariance[a * assets + b] = covariance[b * assets + a] = product / (count - 1.0);
+        }
+    }
+
+    // Холецкий со столбцами, обнуляемыми при неположительном остатке диагонали
+    std::vector<double> factor(assets * assets, 0.0);
+    for (size_t j = 0; j < assets; ++j) {
+        double pivot = covariance[j * assets + j];
+        for (size_t k = 0; k < j; ++k) pivot -= factor[j * assets + k] * factor[j * assets + k];
+        if (!(pivot > 1e-12 * covariance[j * assets + j])) continue;
+        const double diagonal = std::sqrt(pivot);
+        factor[j * assets + j] = diagonal;
+        for (size_t i = j + 1; i < assets; ++i) {
+            double sum = covariance[i * assets + j];
+            for (size_t k = 0; k < j; ++k) sum -= factor[i * assets + k] * factor[j * assets + k];
+            factor[i * assets + j] = sum / diagonal;
+        }
+    }
+    cholesky.assign(factor.begin(), factor.end());
+}
+
+MonteCarloFan runMonteCarlo(const MonteCarloInput& input, const MonteCarloSettings& settings, ThreadPool& pool,
+    const std::atomic<bool>* cancel) {
+    const auto started = std::chrono::steady_clock::now();
+    MonteCarloFan fan;
+    const size_t assets = input.values.size();
+    double initial = input.cash;
+    for (float value : input.values) initial += value;
+    fan.initial = initial;
+    if (initial <= 0.0 || settings.paths == 0 || settings.steps == 0) return fan;
+    const bool bootstrap = settings.method == MonteCarloMethod::Bootstrap && input.history.bars > 0
+        && input.history.columns == assets;
+    const bool gbm = !bootstrap && input.drift.size() == assets && input.volatility.size() == assets;
+    const bool correlated = gbm && assets > 0 && input.cholesky.size() == assets * assets;
+
+    // Моменты веера равномерно до горизонта; последний — всегда конец
+    const std::uint32_t steps = settings.steps;
+    const std::uint32_t points = std::clamp<std::uint32_t>(settings.fanPoints, 1, steps);
+    fan.steps.push_back(0);
+    std::vector<int> fanAt(steps + 1, -1);
+    for (std::uint32_t k = 1; k <= points; ++k) {
+        const std::uint32_t step = static_cast<std::uint32_t>(std::uint64_t(k) * steps / points);
+        fanAt[step] = static_cast<int>(fan.steps.size()) - 1;
+        fan.steps.push_back(step);
+    }
+
+    // Активы дополняются до четвёрки нулевыми: одна четвёрка нормальных чисел — один вызов Philox
+    const size_t padded = (assets + 3) & ~size_t(3);
+    std::vector<float> values(padded, 0.0f), drift(padded, 0.0f), volatility(padded, 0.0f);
+    std::copy(input.values.begin(), input.values.end(), values.begin());
+    if (gbm) {
+        std::copy(input.drift.begin(), input.drift.end(), drift.begin());
+        std::copy(input.volatility.begin(), input.volatility.end(), volatility.begin());
+    }
+    const float cash = static_cast<float>(input.cash);
+
+    const size_t blocks = (settings.paths + kLanes - 1) / kLanes;
+    const size_t slots = pool.size();
+    std::vector<std::uint64_t> histograms(slots * points * kBins, 0);
+    std::vector<std::uint64_t> losses(slots, 0), simulated(slots, 0);
+    std::vector<double> blockSums(blocks, 0.0); // суммы по блокам складываются по порядку: итог не зависит от потоков
+
+    pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, size_t slot) {
+        std::vector<float> logs(padded * kLanes);
+        std::vector<const float*> rows(kLanes);
+        std::uint32_t words[4][kLanes];
+        float normals[4][kLanes];
+        std::vector<float> shocks(correlated ? padded * kLanes : 0); // [актив][путь] независимых z
+        float wealth[kLanes];
+        std::uint64_t* histogram = histograms.data() + slot * points * kBins;
+        for (size_t block = begin; block < end; ++block) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) return;
+            const std::uint32_t firstPath = static_cast<std::uint32_t>(block * kLanes);
+            const size_t lanes = std::min<size_t>(kLanes, settings.paths - firstPath);
+            std::fill(logs.begin(), logs.end(), 0.0f);
+            for (std::uint32_t step = 1; step <= steps; ++step) {
+                if (bootstrap) {
+                    for (size_t lane = 0; lane < kLanes; ++lane) {
+                        const std::uint32_t bits = Philox4x32::generate(firstPath + static_cast<std::uint32_t>(lane),
+                            step, 0, 1, settings.seed).v[0];
+                        rows[lane] = input.history.row((std::uint64_t(bits) * input.history.bars) >> 32);
+                    }
+                    for (size_t a = 0; a < assets; ++a) {
+                        float* row = logs.data() + a * kLanes;
+                        for (size_t lane = 0; lane < kLanes; ++lane) row[lane] += rows[lane][a];
+                    }
+                }
+                else if (gbm) {
+                    for (size_t quad = 0; quad < padded / 4; ++quad) {
+                        for (size_t lane = 0; lane < kLanes; ++lane) {
+                            const Philox4x32 r = Philox4x32::generate(firstPath + static_cast<std::uint32_t>(lane),
+                                step, static_cast<std::uint32_t>(quad), 0, settings.seed);
+                            for (int j = 0; j < 4; ++j) words[j][lane] = r.v[j];
+                        }
+                        for (int pair = 0; pair < 4; pair += 2) {
+                            for (size_t lane = 0; lane < kLanes; ++lane) {
+                                const float radius = polySqrt(-2.0f * polyLog(philoxUniform(words[pair][lane])));
+                                float c, s;
+                                polySinCos(philoxUniform(words[pair + 1][lane]), c, s);
+                                normals[pair][lane] = radius * c;
+                                normals[pair + 1][lane] = radius * s;
+                            }
+                        }
+                        for (size_t j = 0; j < 4; ++j) {
+                            const size_t a = quad * 4 + j;
+                            if (correlated) {
+                                std::copy(normals[j], normals[j] + kLanes, shocks.data() + a * kLanes);
+                                continue;
+                            }
+                            const float mean = drift[a];
+                            const float sigma = volatility[a];
+                            float* row = logs.data() + a * kLanes;
+                            for (size_t lane = 0; lane < kLanes; ++lane) row[lane] += mean + sigma * normals[j][lane];
+                        }
+                    }
+                    // Шок актива a — строка L на независимые z активов 0..a
+                    for (size_t a = 0; correlated && a < assets; ++a) {
+                        float* row = logs.data() + a * kLanes;
+                        const float mean = drift[a];
+                        for (size_t lane = 0; lane < kLanes; ++lane) row[lane] += mean;
+                        const float* factor = input.cholesky.data() + a * assets;
+                        for (size_t b = 0; b <= a; ++b) {
+                            const float weight = factor[b];
+                            if (weight == 0.0f) continue;
+                            const float* z = shocks.data() + b * kLanes;
+                            for (size_t lane = 0; lane < kLanes; ++lane) row[lane] += weight * z[lane];
+                        }
+                    }
+                }
+                if (fanAt[step] < 0) continue;
+
+                std::fill(wealth, wealth + kLanes, cash);
+                for (size_t a = 0; a < assets; ++a) {
+                    const float value = values[a];
+                    const float* row = logs.data() + a * kLanes;
+                    addPositionValue(wealth, row, value);
+                }
+                std::uint64_t* bins = histogram + static_cast<size_t>(fanAt[step]) * kBins;
+                for (size_t lane = 0; lane < lanes; ++lane) ++bins[wealthBin(wealth[lane], initial)];
+            }
+            double sum = 0.0;
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                sum += wealth[lane];
+                losses[slot] += wealth[lane] < initial;
+            }
+            blockSums[block] = sum;
+            simulated[slot] += lanes;
+        }
+    });
+
+    for (size_t slot = 0; slot < slots; ++slot) fan.paths += simulated[slot];
+    if (fan.paths == 0) return fan;
+    std::vector<std::uint64_t> merged(points * kBins, 0);
+    for (size_t slot = 0; slot < slots; ++slot) {
+        const std::uint64_t* histogram = histograms.data() + slot * points * kBins;
+        for (size_t i = 0; i < merged.size(); ++i) merged[i] += histogram[i];
+    }
+    fan.levels.assign(fan.steps.size() * MonteCarloFan::kLevels, static_cast<float>(initial));
+    for (std::uint32_t point = 0; point < points; ++point) {
+        for (int level = 0; level < MonteCarloFan::kLevels; ++level) {
+            fan.levels[(point + 1) * MonteCarloFan::kLevels + level] = levelFromHistogram(
+                merged.data() + point * kBins, fan.paths, MonteCarloFan::kPercentiles[level], initial);
+        }
+    }
+    double total = 0.0;
+    for (double sum : blockSums) total += sum;
+    std::uint64_t lost = 0;
+    for (std::uint64_t count : losses) lost += count;
+    fan.meanFinal = total / static_cast<double>(fan.paths);
+    fan.lossProbability = static_cast<double>(lost) / static_cast<double>(fan.paths);
+    fan.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return fan;
+}
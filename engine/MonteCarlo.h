@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Returns.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+enum class MonteCarloMethod : std::uint8_t {
+    Gbm,       // геометрическое броуновское движение с параметрами, оценёнными по истории
+    Bootstrap, // шаг — случайный бар истории целиком, со всеми активами сразу
+};
+
+struct MonteCarloSettings {
+    MonteCarloMethod method = MonteCarloMethod::Gbm;
+    std::uint32_t paths = 10000;
+    std::uint32_t steps = 250;
+    std::uint32_t fanPoints = 50; // моментов, в которые снимается распределение капитала
+    std::uint64_t seed = 1;
+};
+
+// Портфель для моделирования: стоимости позиций в базовой валюте и модель доходности за шаг
+struct MonteCarloInput {
+    std::vector<float> values;
+    std::vector<float> drift;      // средняя лог-доходность за шаг, GBM
+    std::vector<float> volatility; // её стандартное отклонение, GBM
+    // Нижний треугольный множитель L ковариации лог-доходностей (L·Lᵀ = Σ), assets × assets по строкам:
+    // шоки GBM — L·z, так что активы коррелируют как в истории. Пусто — активы независимы
+    std::vector<float> cholesky;
+    ReturnMatrix history;          // столбцы — активы в порядке values, бутстрэп
+    double cash = 0.0;             // не меняется
+
+    // drift, volatility и cholesky по столбцам history; активы с меньше чем двумя ненулевыми
+    // доходностями получают запасные значения и не коррелируют с остальными. Ковариация пары
+    // считается по барам, где начались оба ряда; направления, в которых такая оценка вырождена
+    // или не положительна, в разложении обнуляются
+    void estimateGbm(float fallbackDrift, float fallbackVolatility);
+};
+
+// Распределение капитала: уровни kPercentiles в каждом моменте steps (первый — шаг 0)
+struct MonteCarloFan {
+    static constexpr int kLevels = 5;
+    static constexpr float kPercentiles[kLevels] = { 5.0f, 25.0f, 50.0f, 75.0f, 95.0f };
+
+    std::vector<std::uint32_t> steps;
+    std::vector<float> levels; // steps.size() × kLevels
+    double initial = 0.0;
+    double meanFinal = 0.0;
+    double lossProbability = 0.0; // доля путей, закончившихся ниже начального капитала
+    std::uint64_t paths = 0;      // смоделировано (меньше заказанного при отмене)
+    double elapsedMs = 0.0;
+};
+
+// GBM с cholesky стоит O(активов²) на шаг пути вместо O(активов).
+// Пути моделируются блоками по kLanes; внутри блока состояние лежит как [актив][путь],
+// и шаг — сплошной цикл по путям, который компилятор векторизует. Нормальные числа — Philox
+// со счётчиком (путь, шаг, четвёрка активов), поэтому результат не зависит от числа потоков.
+// Капитал считается только в моменты веера; уровни берутся из гистограмм логарифма прироста
+// (счётчики потоков складываются без потери воспроизводимости), с шагом около 0.5%.
+// cancel прерывает расчёт между блоками
+MonteCarloFan runMonteCarlo(const MonteCarloInput& input, const MonteCarloSettings& settings, ThreadPool& pool,
+    const std::atomic<bool>* cancel = nullptr);
@@ -0,0 +1,233 @@
+#include "Performance.h"
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kSecondsPerYear = 365.25 * kSecondsPerDay;
+constexpr std::uint32_t kNewtonSteps = 50;
+constexpr std::uint32_t kBisectionSteps = 200;
+// Поиск ведётся там, где самый ранний поток вырастает или сокращается не больше чем в e^50 раз:
+// иначе экспоненты теряют точность. Отрезок делится на kGridSteps частей
+constexpr double kMaxGrowthLog = 50.0;
+constexpr int kGridSteps = 80;
+
+// g(x) = Σ F_k·e^(x·τ_k) - V и её производная
+struct FlowEquation {
+    const CashFlow* flows;
+    size_t count;
+    std::int64_t end;
+    double endValue;
+
+    double value(double x, double* derivative) const {
+        double sum = -endValue, slope = 0.0;
+        for (size_t k = 0; k < count; ++k) {
+            const double years = static_cast<double>(end - flows[k].time) / kSecondsPerYear;
+            const double grown = flows[k].amount * std::exp(x * years);
+            sum += grown;
+            slope += grown * years;
+        }
+        if (derivative) *derivative = slope;
+        return sum;
+    }
+};
+
+} // namespace
+
+void TimeWeightedReturn::advance(const Ledger& ledger, const Portfolio& portfolio, const PriceHistory& history,
+    std::int64_t now) {
+    if (ledger.size() < processed ||
+        (!days.empty() && processed < ledger.size() && ledger.entry(processed).time <= lastClose())) {
+        clear();
+    }
+    if (ledger.size() == 0) return;
+
+    std::int64_t day;
+    if (days.empty()) {
+        // Первый день — тот, на закрытие которого приходится первая запись
+        const std::int64_t first = ledger.entry(0).time;
+        day = daysFromSeconds(first - closeOffset);
+        if (closeTime(day) < first) ++day;
+    } else {
+        day = days.back().day + 1;
+    }
+
+    const FxTable& fx = portfolio.getFx();
+    const SymbolTable& currencies = ledger.getCurrencies();
+    const SymbolTable& symbols = ledger.getSymbols();
+    std::vector<LedgerEntry> deposits;
+    std::vector<LedgerEntry> adjustments;
+    for (; closeTime(day) <= now; ++day) {
+        const std::int64_t close = closeTime(day);
+        const std::int64_t closeMs = close * 1000;
+        const size_t before = processed;
+        deposits.clear();
+        adjustments.clear();
+        for (; processed < ledger.size(); ++processed) {
+            const LedgerEntry entry = ledger.entry(processed);
+            if (entry.time > close) break;
+            if (entry.type == LedgerEntryType::Cash && entry.symbol == kInvalidSymbol) deposits.push_back(entry);
+            else if (entry.type == LedgerEntryType::Adjustment) adjustments.push_back(entry);
+        }
+        // Позиции пересобираются только в дни с записями
+        if (processed > before || state.cash.size() != currencies.size()) ledger.positionsAsOf(close, state);
+
+        rates.assign(currencies.size(), 0.0);
+        for (SymbolId c = 0; c < currencies.size(); ++c) {
+            const CurrencyId currency = fx.find(currencies.name(c));
+            if (currency == kInvalidCurrency) continue;
+            rates[c] = fx.rate(currency);
+            if (currency == kBaseCurrency) continue;
+            float rate;
+            const PriceHistory::SeriesId series =
+                history.findSeries(portfolio.getSymbols().name(portfolio.getFxSymbol(currency)));
+            if (series != kInvalidSymbol && history.priceAsOf(series, closeMs, rate)) rates[c] = rate;
+        }
+
+        double value = 0.0;
+        for (size_t c = 0; c < state.cash.size(); ++c) value += state.cash[c] * rates[c];
+        for (SymbolId s = 0; s < state.positions.size(); ++s) {
+            const LedgerPosition& position = state.positions[s];
+            if (position.quantity == 0) continue;
+            double price = position.lastPrice;
+            float quote;
+            const PriceHistory::SeriesId series = history.findSeries(symbols.name(s));
+            if (series != kInvalidSymbol && history.priceAsOf(series, closeMs, quote)) price = quote;
+            value += static_cast<double>(position.quantity) * price * rates[position.currency];
+        }
+
+        double flow = 0.0;
+        for (const LedgerEntry& entry : deposits) {
+            const double amount = entry.value * rates[entry.currency];
+            flows.push_back({ entry.time, amount });
+            flow += amount;
+        }
+        // Корректировки не потоки, но и не доход: их стоимость на закрытии сдвигает базу дня
+        double adjusted = 0.0;
+        for (const LedgerEntry& entry : adjustments) {
+            if (entry.symbol == kInvalidSymbol) {
+                adjusted += entry.value * rates[entry.currency];
+                continue;
+            }
+            // По той же цене, что и позиция на закрытии
+            const double lastPrice = state.positions[entry.symbol].lastPrice;
+            double price = lastPrice != 0.0 ? lastPrice : entry.value;
+            float quote;
+            const PriceHistory::SeriesId series = history.findSeries(symbols.name(entry.symbol));
+            if (series != kInvalidSymbol && history.priceAsOf(series, closeMs, quote)) price = quote;
+            adjusted += static_cast<double>(entry.quantity) * price * rates[entry.currency];
+        }
+        // Без вложенных денег доходность дня не определена и в цепочку не входит
+        const double previous = days.empty() ? 0.0 : days.back().value;
+        const double invested = previous + flow + adjusted;
+        const double dailyReturn = invested > 0.0 ? value / invested - 1.0 : 0.0;
+        const double growth = (days.empty() ? 1.0 : days.back().growth) * (1.0 + dailyReturn);
+        days.push_back({ day, value, flow, dailyReturn, growth });
+    }
+}
+
+void TimeWeightedReturn::clear() {
+    days.clear();
+    flows.clear();
+    state = LedgerState();
+    processed = 0;
+}
+
+void TimeWeightedReturn::setCloseOffset(std::int64_t seconds) {
+    if (seconds == closeOffset) return;
+    closeOffset = seconds;
+    clear();
+}
+
+double TimeWeightedReturn::annualized() const {
+    if (days.size() < 2 || days.back().growth <= 0.0) return 0.0;
+    const double years = static_cast<double>(days.back().day - days.front().day) * kSecondsPerDay / kSecondsPerYear;
+    return std::pow(days.back().growth, 1.0 / years) - 1.0;
+}
+
+MoneyWeightedReturn moneyWeightedReturn(const CashFlow* flows, size_t count, std::int64_t end, double endValue) {
+    MoneyWeightedReturn result;
+    if (count == 0) return result;
+    const FlowEquation equation{ flows, count, end, endValue };
+    double scale = std::abs(endValue);
+    for (size_t k = 0; k < count; ++k) scale += std::abs(flows[k].amount);
+    const double tolerance = 1e-12 * scale;
+    std::int64_t earliest = end;
+    for (size_t k = 0; k < count; ++k) earliest = std::min(earliest, flows[k].time);
+    if (earliest >= end) return result;
+    const double limit = kMaxGrowthLog * kSecondsPerYear / static_cast<double>(end - earliest);
+    const double gridStep = 2.0 * limit / kGridSteps;
+
+    // Старт — простая доходность на средневзвешенный по времени капитал
+    double invested = 0.0, weighted = 0.0;
+    for (size_t k = 0; k < count; ++k) {
+        invested += flows[k].amount;
+        weighted += flows[k].amount * static_cast<double>(end - flows[k].time) / kSecondsPerYear;
+    }
+    double x = weighted > 0.0 ? std::log1p(std::max(-0.99, (endValue - invested) / weighted)) : 0.0;
+    x = std::clamp(x, -limit, limit);
+    for (; result.iterations < kNewtonSteps; ++result.iterations) {
+        double slope;
+        const double residual = equation.value(x, &slope);
+        if (std::abs(residual) <= tolerance) {
+            result.solved = true;
+            break;
+        }
+        const double step = residual / slope;
+        if (!std::isfinite(step) || std::abs(x - step) > limit) break;
+        x -= step;
+        if (std::abs(step) < 1e-14) {
+            result.solved = true;
+            break;
+        }
+    }
+
+    if (!result.solved) {
+        // Смена знака, ближайшая к нулевой доходности: при потоках обоих знаков корней может быть несколько
+        double low = 0.0, high = 0.0, lowValue = 0.0;
+        bool found = false;
+        for (int step = 0; !found && step < kGridSteps / 2; ++step) {
+            for (double start : { -(step + 1) * gridStep, step * gridStep }) {
+                const double a = equation.value(start, nullptr);
+                const double b = equation.value(start + gridStep, nullptr);
+                if ((a <= 0.0) != (b <= 0.0)) {
+                    low = start;
+                    high = start + gridStep;
+                    lowValue = a;
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) return result;
+        for (std::uint32_t k = 0; k < kBisectionSteps && high - low > 1e-15; ++k, ++result.iterations) {
+            const double middle = 0.5 * (low + high);
+            const double value = equation.value(middle, nullptr);
+            if ((value <= 0.0) == (lowValue <= 0.0)) {
+                low = middle;
+                lowValue = value;
+            } else {
+                high = middle;
+            }
+        }
+        x = 0.5 * (low + high);
+        result.solved = true;
+        result.bracketed = true;
+    }
+    result.rate = std::expm1(x);
+    return result;
+}
+
+std::vector<MoneyWeightedReturn> moneyWeightedReturns(const std::vector<MoneyWeightedInput>& accounts,
+    ThreadPool& pool) {
+    std::vector<MoneyWeightedReturn> results(accounts.size());
+    pool.parallelFor(accounts.size(), 64, [&](size_t begin, size_t end, size_t) {
+        for (size_t a = begin; a < end; ++a) {
+            const MoneyWeightedInput& account = accounts[a];
+            results[a] = moneyWeightedReturn(account.flows.data(), account.flows.size(), account.end, account.endValue);
+        }
+    });
+    return results;
+}
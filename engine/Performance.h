@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Calendar.h"
+#include "Ledger.h"
+#include "PriceHistory.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+class Portfolio;
+
+// Внешний поток денег счёта: пополнение (+) или вывод (-)
+struct CashFlow {
+    std::int64_t time; // секунды Unix
+    double amount;
+};
+
+// Закрытый день журнала; суммы в базовой валюте
+struct PerformanceDay {
+    std::int64_t day;   // дни от 1970-01-01
+    double value;       // позиции и деньги на закрытии
+    double flow;        // пополнения минус выводы за день
+    double dailyReturn; // V_d / (V_{d-1} + F_d + A_d) - 1: потоки и корректировки A_d дня — в его начале
+    double growth;      // ∏(1 + r) с первого дня журнала
+};
+
+// Доходность, взвешенная по времени, по дням журнала. Дни закрываются по одному и больше
+// не пересчитываются: новый день стоит оценки позиций на его закрытии и записей журнала за него.
+// Внешние потоки — движения денег без символа-источника; денежные дивиденды — доход, а не поток.
+// Корректировки журнала не входят ни в потоки, ни в доходность: их стоимость добавляется к базе дня.
+// Цена позиции — последняя точка её ряда в истории не позже закрытия, без ряда — цена последней
+// сделки; курс — ряд валютной пары, без него — текущий курс портфеля
+class TimeWeightedReturn {
+public:
+    // Закрывает все дни, чьё закрытие (полночь UTC + closeOffset секунд) не позже now. Журнал,
+    // ставший короче или получивший запись внутрь уже закрытого дня, проходится заново
+    void advance(const Ledger& ledger, const Portfolio& portfolio, const PriceHistory& history, std::int64_t now);
+    void clear();
+
+    void setCloseOffset(std::int64_t seconds);
+    std::int64_t getCloseOffset() const { return closeOffset; }
+    const std::vector<PerformanceDay>& getDays() const { return days; }
+    // Внешние потоки в базовой валюте по курсу закрытия их дня — вход для MWR
+    const std::vector<CashFlow>& getFlows() const { return flows; }
+    // Момент закрытия последнего закрытого дня
+    std::int64_t lastClose() const { return days.empty() ? 0 : closeTime(days.back().day); }
+    double cumulative() const { return days.empty() ? 0.0 : days.back().growth - 1.0; }
+    // Сложная годовая доходность; для истории короче дня — 0
+    double annualized() const;
+
+private:
+    std::int64_t closeTime(std::int64_t day) const { return day * kSecondsPerDay + closeOffset; }
+
+    std::int64_t closeOffset = kSecondsPerDay - 1; // конец дня UTC
+    std::vector<PerformanceDay> days;
+    std::vector<CashFlow> flows;
+    LedgerState state;
+    std::vector<double> rates;
+    size_t processed = 0;         // записей журнала, вошедших в закрытые дни
+};
+
+struct MoneyWeightedReturn {
+    double rate = 0.0;            // годовая внутренняя норма доходности
+    std::uint32_t iterations = 0; // Ньютона, плюс деления пополам, если понадобились
+    bool solved = false;
+    bool bracketed = false;       // Ньютон не сошёлся, корень найден делением отрезка
+};
+
+struct MoneyWeightedInput {
+    std::vector<CashFlow> flows;
+    std::int64_t end = 0; // момент оценки
+    double endValue = 0.0;
+};
+
+// IRR: Σ F_k·(1 + r)^((end - t_k) / год) = endValue. Ньютон идёт по x = ln(1 + r), где r > -1
+// выполняется само; если он расходится или не сходится за отведённые шаги, корень ищется
+// по смене знака на сетке x и делением отрезка пополам. Без смены знака — solved = false
+MoneyWeightedReturn moneyWeightedReturn(const CashFlow* flows, size_t count, std::int64_t end, double endValue);
+
+// Пакет счетов на пуле потоков: счета независимы, каждый решается отдельно
+std::vector<MoneyWeightedReturn> moneyWeightedReturns(const std::vector<MoneyWeightedInput>& accounts,
+    ThreadPool& pool);
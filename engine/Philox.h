@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Счётчиковый генератор Philox4x32-10 (Salmon et al., 2011): четыре случайных слова — чистая
+// функция от 128-битного счётчика и 64-битного ключа. Поток не хранит состояния, поэтому
+// число с заданным счётчиком одинаково при любом разбиении работы между потоками
+struct Philox4x32 {
+    std::uint32_t v[4];
+
+    static Philox4x32 generate(std::uint32_t c0, std::uint32_t c1, std::uint32_t c2, std::uint32_t c3,
+        std::uint64_t key) {
+        std::uint32_t k0 = static_cast<std::uint32_t>(key);
+        std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = std::uint64_t(0xD2511F53u) * c0;
+            const std::uint64_t p1 = std::uint64_t(0xCD9E8D57u) * c2;
+            const std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            const std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<std::uint32_t>(p1);
+            c3 = static_cast<std::uint32_t>(p0);
+            c0 = n0;
+            c2 = n2;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        return { { c0, c1, c2, c3 } };
+    }
+};
+
+// Равномерное число в (0, 1) из 24 старших бит
+inline float philoxUniform(std::uint32_t bits) {
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f) + (0.5f / 16777216.0f);
+}
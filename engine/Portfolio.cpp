@@ -0,0 +1,523 @@
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+constexpr std::uint32_t kNoAsset = ~0u;
+
+double actionRatio(const CorporateAction& action) {
+    return action.type == CorporateActionType::Split ? action.value : 1.0 + action.value;
+}
+
+// Проходит события символа пакета по времени, вызывая apply для всех, кроме смены тикера.
+// Смена тикера переводит проход на события нового тикера с даты смены. Возвращает итоговый символ
+template <class Apply>
+SymbolId walkActions(const CorporateActionBatch& batch, SymbolId symbol, Apply&& apply) {
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    // Число переходов ограничено размером пакета: цепочка A→B→A не зацикливается
+    for (size_t hops = 0; hops <= batch.size(); ++hops) {
+        const CorporateAction* renamed = nullptr;
+        for (const CorporateAction* it = batch.begin(symbol); it != batch.end(symbol); ++it) {
+            if (it->time < from) continue;
+            if (it->type == CorporateActionType::SymbolChange) {
+                renamed = it;
+                break;
+            }
+            apply(*it);
+        }
+        if (!renamed) break;
+        symbol = renamed->newSymbol;
+        from = renamed->time;
+    }
+    return symbol;
+}
+
+} // namespace
+
+void Portfolio::reserve(size_t count, size_t nameBytes) {
+    symbols->reserve(count, nameBytes);
+    assets.reserve(count);
+    targets.reserve(count);
+    lots.reserve(count);
+}
+
+void Portfolio::clear() {
+    // Таблицу, которую держат снимки, не трогаем: их имена должны остаться на месте
+    if (!symbols || symbols.use_count() > 1) symbols = std::make_shared<SymbolTable>();
+    else symbols->clear();
+    assets.clear();
+    targets.clear();
+    lots.clear();
+    settings = PortfolioSettings();
+    fx = FxTable();
+    fxSymbols.assign(1, kInvalidSymbol);
+    currencyValues.assign(1, 0.0);
+    cash.assign(1, 0.0);
+    totalValue = 0.0;
+    symbolIndexValid = false;
+    currencyIndexValid = false;
+    ++revision;
+}
+
+size_t Portfolio::addAsset(std::string_view name, int quantity, float price, std::uint32_t color,
+    CurrencyId currency) {
+    SymbolId symbol = symbols->intern(name);
+    std::string_view stored = symbols->name(symbol);
+    assets.push_back({ stored, symbol, quantity, price, color, currency });
+    targets.push_back({ stored, 0.0f, settings.defaultTolerancePercent });
+    addValue(currency, assets.back().value());
+    ++revision;
+    currencyIndexValid = false;
+    if (symbolIndexValid) {
+        if (symbol >= firstBySymbol.size()) firstBySymbol.resize(symbol + 1, kNoAsset);
+        nextBySymbol.push_back(firstBySymbol[symbol]);
+        firstBySymbol[symbol] = static_cast<std::uint32_t>(assets.size() - 1);
+    }
+    return assets.size() - 1;
+}
+
+void Portfolio::removeAsset(size_t index) {
+    SymbolId symbol = assets[index].symbol;
+    addValue(assets[index].currency, -static_cast<double>(assets[index].value()));
+    ++revision;
+    symbolIndexValid = false;
+    currencyIndexValid = false;
+    assets.erase(assets.begin() + index);
+    targets.erase(targets.begin() + index);
+    // Лоты принадлежат символу: удаляем их, только если других активов с этим именем нет
+    bool stillHeld = std::any_of(assets.begin(), assets.end(), [&](const Asset& a) { return a.symbol == symbol; });
+    if (!stillHeld) {
+        lots.erase(std::remove_if(lots.begin(), lots.end(), [&](const Lot& lot) { return lot.symbol == symbol; }),
+            lots.end());
+    }
+}
+
+void Portfolio::setQuantity(size_t index, int quantity) {
+    Asset& asset = assets[index];
+    addValue(asset.currency, static_cast<double>(quantity - asset.quantity) * asset.price);
+    asset.quantity = quantity;
+    ++revision;
+}
+
+void Portfolio::setPrice(size_t index, float price) {
+    Asset& asset = assets[index];
+    addValue(asset.currency, static_cast<double>(asset.quantity) * (static_cast<double>(price) - asset.price));
+    asset.price = price;
+    ++revision;
+}
+
+size_t Portfolio::setSymbolPrice(SymbolId symbol, float price) {
+    if (!symbolIndexValid) rebuildSymbolIndex();
+    size_t updated = 0;
+    if (symbol >= firstBySymbol.size() || firstBySymbol[symbol] == kNoAsset) {
+        // Активов с таким символом нет — возможно, это валютная пара
+        for (CurrencyId currency = 1; currency < fxSymbols.size(); ++currency) {
+            if (fxSymbols[currency] != symbol) continue;
+            if (fx.rate(currency) == price) return 0;
+            setFxRate(currency, price);
+            return 1;
+        }
+        return 0;
+    }
+    for (std::uint32_t i = firstBySymbol[symbol]; i != kNoAsset; i = nextBySymbol[i]) {
+        if (assets[i].price == price) continue;
+        setPrice(i, price);
+        ++updated;
+    }
+    return updated;
+}
+
+void Portfolio::rebuildSymbolIndex() {
+    firstBySymbol.assign(symbols->size(), kNoAsset);
+    nextBySymbol.resize(assets.size());
+    for (size_t i = assets.size(); i-- > 0;) {
+        nextBySymbol[i] = firstBySymbol[assets[i].symbol];
+        firstBySymbol[assets[i].symbol] = static_cast<std::uint32_t>(i);
+    }
+    symbolIndexValid = true;
+}
+
+void Portfolio::setColor(size_t index, std::uint32_t color) {
+    assets[index].color = color;
+}
+
+void Portfolio::setCurrency(size_t index, CurrencyId currency) {
+    Asset& asset = assets[index];
+    if (asset.currency == currency) return;
+    addValue(asset.currency, -static_cast<double>(asset.value()));
+    asset.currency = currency;
+    addValue(currency, asset.value());
+    currencyIndexValid = false;
+    ++revision;
+}
+
+CurrencyId Portfolio::currency(std::string_view code) {
+    CurrencyId id = fx.find(code);
+    if (id != kInvalidCurrency) return id;
+    id = fx.intern(code);
+    fxSymbols.push_back(symbols->intern(fx.code(id) + "/" + fx.baseCode()));
+    currencyValues.push_back(0.0);
+    cash.push_back(0.0);
+    return id;
+}
+
+void Portfolio::addCash(CurrencyId currency, double amount) {
+    if (amount == 0.0) return;
+    cash[currency] += amount;
+    addValue(currency, amount);
+    ++revision;
+}
+
+bool Portfolio::setBaseCurrency(std::string_view code) {
+    if (fx.size() > 1) return fx.find(code) == kBaseCurrency;
+    fx.reset(code);
+    return true;
+}
+
+void Portfolio::setFxRate(CurrencyId currency, double rate) {
+    if (currency == kBaseCurrency || currency >= fx.size()) return;
+    double previous = fx.rate(currency);
+    if (previous == rate) return;
+    fx.setRate(currency, rate);
+    // Остальные корзины не меняются: итог сдвигается на корзину этой валюты
+    totalValue += currencyValues[currency] * (rate - previous);
+    ++revision;
+}
+
+void Portfolio::rebuildCurrencyIndex() const {
+    currencyOffsets.assign(fx.size() + 1, 0);
+    for (const auto& asset : assets) ++currencyOffsets[asset.currency + 1];
+    for (size_t c = 0; c < fx.size(); ++c) currencyOffsets[c + 1] += currencyOffsets[c];
+    currencyOrder.resize(assets.size());
+    std::vector<std::uint32_t> cursor(currencyOffsets.begin(), currencyOffsets.end() - 1);
+    for (size_t i = 0; i < assets.size(); ++i) {
+        currencyOrder[cursor[assets[i].currency]++] = static_cast<std::uint32_t>(i);
+    }
+    currencyIndexValid = true;
+}
+
+void Portfolio::convertValues(std::vector<float>& values) const {
+    values.resize(assets.size());
+    for (size_t i = 0; i < assets.size(); ++i) values[i] = assets[i].value();
+    if (fx.size() == 1) return;
+    if (!currencyIndexValid || currencyOffsets.size() != fx.size() + 1) rebuildCurrencyIndex();
+    // Базовая валюта уже в нужных единицах
+    for (CurrencyId currency = 1; currency < fx.size(); ++currency) {
+        const float rate = static_cast<float>(fx.rate(currency));
+        for (std::uint32_t k = currencyOffsets[currency]; k < currencyOffsets[currency + 1]; ++k) {
+            values[currencyOrder[k]] *= rate;
+        }
+    }
+}
+
+void Portfolio::setTarget(size_t index, float targetPercent, float tolerancePercent) {
+    targets[index].targetPercent = targetPercent;
+    targets[index].tolerancePercent = tolerancePercent;
+}
+
+void Portfolio::addLot(SymbolId symbol, int quantity, float costPrice, std::int64_t openTime) {
+    lots.push_back({ symbol, quantity, costPrice, openTime });
+}
+
+void Portfolio::restoreAssets(const std::vector<Asset>& saved, const std::vector<Lot>& savedLots) {
+    std::vector<TargetAllocation> previousTargets;
+    previousTargets.swap(targets);
+    assets = saved;
+    lots = savedLots;
+    symbolIndexValid = false;
+    targets.reserve(assets.size());
+    for (const auto& asset : assets) {
+        targets.push_back({ asset.name, 0.0f, settings.defaultTolerancePercent });
+    }
+    applyTargets(previousTargets);
+    recomputeTotals();
+}
+
+void Portfolio::applyTargets(const std::vector<TargetAllocation>& source) {
+    // Имена источника сопоставляются с таблицей портфеля один раз, дальше — индекс по SymbolId
+    std::vector<const TargetAllocation*> bySymbol(symbols->size(), nullptr);
+    for (const auto& target : source) {
+        SymbolId symbol = symbols->find(target.name);
+        if (symbol != kInvalidSymbol) bySymbol[symbol] = &target;
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const TargetAllocation* found = bySymbol[assets[i].symbol];
+        targets[i].targetPercent = found ? found->targetPercent : 0.0f;
+        targets[i].tolerancePercent = found ? found->tolerancePercent : settings.defaultTolerancePercent;
+    }
+}
+
+PortfolioDiff Portfolio::applyUpdate(const Portfolio& incoming, std::int64_t time) {
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    PortfolioDiff diff;
+
+    // Первое вхождение каждого символа; имена новой версии ищутся в нашей таблице
+    std::vector<size_t> indexBySymbol(symbols->size(), npos);
+    for (size_t i = 0; i < assets.size(); ++i) {
+        if (indexBySymbol[assets[i].symbol] == npos) indexBySymbol[assets[i].symbol] = i;
+    }
+    std::vector<char> seen(assets.size(), 0);
+    seen.reserve(assets.size() + incoming.assets.size());
+
+    // Валюты новой версии переводятся в наши id по коду, курсы берутся из неё
+    std::vector<CurrencyId> currencyMap(incoming.fx.size(), kBaseCurrency);
+    for (CurrencyId c = 1; c < incoming.fx.size(); ++c) {
+        currencyMap[c] = currency(incoming.fx.code(c));
+        if (incoming.fx.hasRate(c)) setFxRate(currencyMap[c], incoming.fx.rate(c));
+    }
+    // Деньги в файле — итоговый остаток: валюты, которых в нём нет, обнуляются
+    std::vector<double> incomingCash(fx.size(), 0.0);
+    for (CurrencyId c = 0; c < incoming.fx.size(); ++c) incomingCash[currencyMap[c]] += incoming.cash[c];
+    for (CurrencyId c = 0; c < fx.size(); ++c) addCash(c, incomingCash[c] - cash[c]);
+
+    for (const auto& row : incoming.assets) {
+        SymbolId symbol = symbols->find(row.name);
+        size_t index = symbol < indexBySymbol.size() ? indexBySymbol[symbol] : npos;
+        CurrencyId rowCurrency = currencyMap[row.currency];
+        if (index == npos || seen[index]) {
+            size_t added = addAsset(row.name, row.quantity, row.price, row.color, rowCurrency);
+            if (row.quantity > 0) addLot(assets[added].symbol, row.quantity, row.price, time);
+            seen.push_back(1);
+            ++diff.added;
+            continue;
+        }
+        seen[index] = 1;
+        Asset& asset = assets[index];
+        if (asset.quantity == row.quantity && asset.price == row.price && asset.currency == rowCurrency) {
+            ++diff.unchanged;
+            continue;
+        }
+        if (asset.currency != rowCurrency) setCurrency(index, rowCurrency);
+        if (asset.price != row.price) setPrice(index, row.price);
+        if (asset.quantity != row.quantity) changeQuantity(asset, row.quantity, time);
+        ++diff.changed;
+    }
+
+    // Исчезнувшие строки удаляются одним проходом уплотнения
+    size_t kept = 0;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        if (!seen[i]) {
+            addValue(assets[i].currency, -static_cast<double>(assets[i].value()));
+            ++diff.removed;
+            continue;
+        }
+        if (kept != i) {
+            assets[kept] = assets[i];
+            targets[kept] = targets[i];
+        }
+        ++kept;
+    }
+    if (diff.removed > 0) {
+        assets.resize(kept);
+        targets.resize(kept);
+        symbolIndexValid = false;
+        currencyIndexValid = false;
+        dropUnheldLots();
+        ++revision;
+    }
+    lots.erase(std::remove_if(lots.begin(), lots.end(), [](const Lot& lot) { return lot.quantity <= 0; }),
+        lots.end());
+    return diff;
+}
+
+void Portfolio::changeQuantity(Asset& asset, int quantity, std::int64_t time) {
+    int before = asset.quantity;
+    addValue(asset.currency, static_cast<double>(quantity - before) * asset.price);
+    asset.quantity = quantity;
+    ++revision;
+    if (quantity > before) {
+        addLot(asset.symbol, quantity - before, asset.price, time);
+    }
+    else if (quantity < before) {
+        sellLots(asset.symbol, before - quantity);
+    }
+}
+
+void Portfolio::dropUnheldLots() {
+    std::vector<char> held(symbols->size(), 0);
+    for (const auto& asset : assets) held[asset.symbol] = 1;
+    lots.erase(std::remove_if(lots.begin(), lots.end(), [&](const Lot& lot) { return !held[lot.symbol]; }),
+        lots.end());
+}
+
+// Суммы копятся в double: на миллионе позиций float теряет проценты
+void Portfolio::recomputeTotals() {
+    currencyValues.assign(cash.begin(), cash.end());
+    for (const auto& asset : assets) currencyValues[asset.currency] += asset.value();
+    totalValue = 0.0;
+    for (CurrencyId currency = 0; currency < fx.size(); ++currency) {
+        totalValue += currencyValues[currency] * fx.rate(currency);
+    }
+    currencyIndexValid = false;
+    ++revision;
+}
+
+void Portfolio::fillSnapshot(PortfolioSnapshot& snapshot) const {
+    snapshot.assets.assign(assets.begin(), assets.end());
+    snapshot.targets.assign(targets.begin(), targets.end());
+    snapshot.lots.assign(lots.begin(), lots.end());
+    snapshot.settings = settings;
+    snapshot.fx = fx;
+    snapshot.cash.assign(cash.begin(), cash.end());
+    snapshot.totalValue = totalValue;
+    snapshot.revision = revision;
+    snapshot.symbolCount = symbols->size();
+    snapshot.names = symbols;
+}
+
+float Portfolio::getTotalTargetPercent() const {
+    return static_cast<float>(std::accumulate(targets.begin(), targets.end(), 0.0,
+        [](double sum, const TargetAllocation& t) { return sum + t.targetPercent; }));
+}
+
+bool Portfolio::calculateRebalance(std::vector<RebalanceAction>& actions, float& extraCapital) const {
+    actions.clear();
+    if (std::abs(getTotalTargetPercent() - 100.0f) > 0.01f) {
+        return false;
+    }
+
+    // Цели идут в том же порядке, что и активы, поэтому поиск по имени не нужен
+    float total_value = getTotalValue();
+    extraCapital = 0.0f;
+    actions.reserve(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const Asset& asset = assets[i];
+        float current_value = baseValue(asset, fx);
+        // Штуки считаются по цене в базовой валюте
+        float unit_price = static_cast<float>(asset.price * fx.rate(asset.currency));
+        float target_value;
+        int units = rebalanceUnits(current_value, total_value, targets[i].targetPercent, targets[i].tolerancePercent,
+            unit_price, target_value);
+        float diff = target_value - current_value;
+
+        actions.push_back({ asset.name, asset.symbol, current_value, target_value, diff, units });
+        extraCapital += diff;
+    }
+    return true;
+}
+
+void Portfolio::applyRebalance(const std::vector<RebalanceAction>& actions, std::int64_t time) {
+    // Как и раньше, действие относится к первому активу с этим именем
+    std::vector<size_t> firstIndex(symbols->size(), assets.size());
+    for (size_t i = assets.size(); i-- > 0;) {
+        firstIndex[assets[i].symbol] = i;
+    }
+    for (const auto& action : actions) {
+        if (action.symbol >= firstIndex.size() || firstIndex[action.symbol] == assets.size()) continue;
+        Asset& asset = assets[firstIndex[action.symbol]];
+        int before = asset.quantity;
+        changeQuantity(asset, std::max(0, asset.quantity + action.unitsToBuyOrSell), time);
+        // Сделки идут за счёт свободных денег валюты актива: итог портфеля не меняется
+        double spent = static_cast<double>(asset.quantity - before) * asset.price;
+        cash[asset.currency] -= spent;
+        addValue(asset.currency, -spent);
+    }
+    lots.erase(std::remove_if(lots.begin(), lots.end(), [](const Lot& lot) { return lot.quantity <= 0; }),
+        lots.end());
+}
+
+CorporateActionReport Portfolio::applyCorporateActions(const CorporateActionBatch& batch) {
+    CorporateActionReport report;
+    const SymbolTable& names = batch.getSymbols();
+    // Символ пакета для каждого затронутого символа портфеля
+    std::vector<SymbolId> batchSymbol(symbols->size(), kInvalidSymbol);
+    bool touched = false;
+    for (SymbolId symbol = 0; symbol < names.size(); ++symbol) {
+        if (batch.begin(symbol) == batch.end(symbol)) continue;
+        SymbolId local = symbols->find(names.name(symbol));
+        if (local == kInvalidSymbol) continue;
+        batchSymbol[local] = symbol;
+        touched = true;
+    }
+    if (!touched) return report;
+
+    // Лоты сверяются с позицией после округления, если до событий они ей соответствовали
+    const size_t symbolCount = batchSymbol.size();
+    std::vector<long long> heldBefore(symbolCount, 0), heldAfter(symbolCount, 0);
+    std::vector<long long> lotsBefore(symbolCount, 0), lotsAfter(symbolCount, 0);
+
+    for (size_t i = 0; i < assets.size(); ++i) {
+        Asset& asset = assets[i];
+        const SymbolId local = asset.symbol;
+        if (batchSymbol[local] == kInvalidSymbol) continue;
+        double quantity = asset.quantity;
+        double price = asset.price;
+        double received = 0.0;
+        bool split = false, paid = false;
+        SymbolId last = walkActions(batch, batchSymbol[local], [&](const CorporateAction& action) {
+            if (action.type == CorporateActionType::CashDividend) {
+                received += quantity * action.value;
+                paid = true;
+                return;
+            }
+            double ratio = actionRatio(action);
+            double exact = quantity * ratio;
+            quantity = std::floor(exact + 1e-9);
+            price /= ratio;
+            received += std::max(0.0, exact - quantity) * price; // дробная бумага выплачивается деньгами
+            split = true;
+        });
+        heldBefore[local] += asset.quantity;
+        heldAfter[local] += static_cast<long long>(quantity);
+        asset.quantity = static_cast<int>(quantity);
+        asset.price = static_cast<float>(price);
+        if (received != 0.0) cash[asset.currency] += received;
+        report.cashPaid += received * fx.rate(asset.currency);
+        report.splits += split;
+        report.dividends += paid;
+        if (last != batchSymbol[local]) {
+            SymbolId renamed = symbols->intern(names.name(last));
+            asset.symbol = renamed;
+            asset.name = symbols->name(renamed);
+            targets[i].name = asset.name;
+            ++report.renames;
+        }
+    }
+
+    std::vector<size_t> oldestLot(symbolCount, lots.size());
+    for (size_t k = 0; k < lots.size(); ++k) {
+        Lot& lot = lots[k];
+        const SymbolId local = lot.symbol;
+        if (local >= symbolCount || batchSymbol[local] == kInvalidSymbol) continue;
+        double quantity = lot.quantity;
+        double costPrice = lot.costPrice;
+        SymbolId last = walkActions(batch, batchSymbol[local], [&](const CorporateAction& action) {
+            if (action.type == CorporateActionType::CashDividend) return;
+            double ratio = actionRatio(action);
+            quantity = std::floor(quantity * ratio + 1e-9);
+            costPrice /= ratio;
+        });
+        lotsBefore[local] += lot.quantity;
+        lotsAfter[local] += static_cast<long long>(quantity);
+        if (oldestLot[local] == lots.size()) oldestLot[local] = k;
+        lot.quantity = static_cast<int>(quantity);
+        lot.costPrice = static_cast<float>(costPrice);
+        if (last != batchSymbol[local]) lot.symbol = symbols->intern(names.name(last));
+    }
+    // Округление по лотам теряет не больше бумаги на лот; разница уходит в самый старый
+    for (SymbolId local = 0; local < symbolCount; ++local) {
+        if (oldestLot[local] == lots.size() || heldBefore[local] != lotsBefore[local]) continue;
+        lots[oldestLot[local]].quantity += static_cast<int>(heldAfter[local] - lotsAfter[local]);
+    }
+    lots.erase(std::remove_if(lots.begin(), lots.end(), [](const Lot& lot) { return lot.quantity <= 0; }),
+        lots.end());
+
+    symbolIndexValid = false;
+    recomputeTotals();
+    return report;
+}
+
+void Portfolio::sellLots(SymbolId symbol, int quantity) {
+    // Лоты лежат в порядке открытия, поэтому первый найденный — самый старый
+    for (auto& lot : lots) {
+        if (quantity <= 0) break;
+        if (lot.symbol != symbol) continue;
+        int taken = std::min(lot.quantity, quantity);
+        lot.quantity -= taken;
+        quantity -= taken;
+    }
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "CorporateActions.h"
+#include "FxTable.h"
+#include "SymbolTable.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Имена ниже — представления строк из SymbolTable портфеля и живут до его очистки/загрузки
+struct Asset {
+    std::string_view name;
+    SymbolId symbol;
+    int quantity;
+    float price;
+    std::uint32_t color; // ImU32, заполняется интерфейсом
+    CurrencyId currency; // валюта цены; kBaseCurrency — базовая валюта портфеля
+    // В валюте актива; в базовую переводит курс из FxTable портфеля
+    float value() const { return static_cast<float>(quantity) * price; }
+};
+
+// Стоимость в базовой валюте
+inline float baseValue(const Asset& asset, const FxTable& fx) {
+    return static_cast<float>(static_cast<double>(asset.value()) * fx.rate(asset.currency));
+}
+
+struct TargetAllocation {
+    std::string_view name;
+    float targetPercent;
+    float tolerancePercent; // коридор вокруг цели, внутри которого сделки не нужны
+};
+
+// Налоговый лот: покупка по своей цене в свой момент времени
+struct Lot {
+    SymbolId symbol;
+    int quantity;
+    float costPrice;
+    std::int64_t openTime; // секунды Unix, 0 — неизвестно
+};
+
+struct PortfolioSettings {
+    float defaultTolerancePercent = 0.0f; // коридор для новых активов
+};
+
+// Итог применения новой версии портфеля поверх текущей
+struct PortfolioDiff {
+    size_t added = 0;
+    size_t removed = 0;
+    size_t changed = 0;
+    size_t unchanged = 0;
+};
+
+// Итог применения пакета корпоративных действий
+struct CorporateActionReport {
+    size_t splits = 0;    // строк активов, изменённых сплитом или дивидендом акциями
+    size_t dividends = 0; // строк, получивших денежный дивиденд
+    size_t renames = 0;   // строк, сменивших тикер
+    double cashPaid = 0.0; // в базовой валюте: дивиденды и выплаты за дробные бумаги
+};
+
+// Ядро ребалансировки одного актива, общее для портфеля и бэктеста: целевая стоимость от итога
+// (внутри коридора — текущая) и штуки к сделке по цене в базовой валюте; > 0 — покупка
+inline int rebalanceUnits(float currentValue, float totalValue, float targetPercent, float tolerancePercent,
+    float unitPrice, float& targetValue) {
+    targetValue = totalValue * (targetPercent / 100.0f);
+    // Внутри коридора актив не трогаем
+    float drift_percent = totalValue > 0.0f ? (currentValue - targetValue) / totalValue * 100.0f : 0.0f;
+    if (tolerancePercent > 0.0f && std::abs(drift_percent) <= tolerancePercent) {
+        targetValue = currentValue;
+    }
+    float diff = targetValue - currentValue;
+    return unitPrice > 0.0f ? static_cast<int>(std::round(diff / unitPrice)) : 0;
+}
+
+// Суммы — в базовой валюте, количество — в штуках актива
+struct RebalanceAction {
+    std::string_view name;
+    SymbolId symbol;
+    float currentValue;
+    float targetValue;
+    float diffValue;
+    int unitsToBuyOrSell;
+};
+
+// Неизменяемая копия портфеля на момент ревизии: её читают панели и фоновые задачи,
+// пока окно продолжает менять сам портфель. Заполняется Portfolio::fillSnapshot
+class PortfolioSnapshot {
+public:
+    const std::vector<Asset>& getAssets() const { return assets; }
+    const std::vector<TargetAllocation>& getTargets() const { return targets; }
+    const std::vector<Lot>& getLots() const { return lots; }
+    const PortfolioSettings& getSettings() const { return settings; }
+    const FxTable& getFx() const { return fx; }
+    std::uint64_t getRevision() const { return revision; }
+    float getTotalValue() const { return static_cast<float>(totalValue); }
+    double getCash(CurrencyId currency) const { return cash[currency]; }
+    // Все SymbolId снимка меньше этого числа
+    size_t getSymbolCount() const { return symbolCount; }
+
+private:
+    friend class Portfolio;
+
+    std::vector<Asset> assets;
+    std::vector<TargetAllocation> targets;
+    std::vector<Lot> lots;
+    PortfolioSettings settings;
+    FxTable fx;
+    std::vector<double> cash;
+    double totalValue = 0.0;
+    std::uint64_t revision = 0;
+    size_t symbolCount = 0;
+    // Только удерживает строки имён; саму таблицу дописывает портфель, читать её отсюда нельзя
+    std::shared_ptr<const SymbolTable> names;
+};
+
+// Ядро портфеля без зависимостей от интерфейса: используется и окном, и пакетным режимом.
+// Активы и целевые доли хранятся параллельными массивами с общими индексами.
+class Portfolio {
+public:
+    Portfolio() = default;
+    Portfolio(const Portfolio&) = delete;
+    Portfolio& operator=(const Portfolio&) = delete;
+    Portfolio(Portfolio&&) = default;
+    Portfolio& operator=(Portfolio&&) = default;
+
+    const std::vector<Asset>& getAssets() const { return assets; }
+    const std::vector<TargetAllocation>& getTargets() const { return targets; }
+    std::vector<TargetAllocation>& getTargets() { return targets; }
+    const std::vector<Lot>& getLots() const { return lots; }
+    const PortfolioSettings& getSettings() const { return settings; }
+    PortfolioSettings& getSettings() { return settings; }
+    const SymbolTable& getSymbols() const { return *symbols; }
+    const FxTable& getFx() const { return fx; }
+    // Растёт при каждом изменении состава, количества или цены активов
+    std::uint64_t getRevision() const { return revision; }
+    // Ставит ревизию после previous: портфель, подменяющий другой целиком, не должен повторить его ревизию
+    void continueRevision(std::uint64_t previous) { revision = (revision > previous ? revision : previous) + 1; }
+
+    void reserve(size_t count, size_t nameBytes = 0);
+    void clear();
+    // Возвращает индекс нового актива; цель создаётся с 0% и коридором по умолчанию
+    size_t addAsset(std::string_view name, int quantity, float price, std::uint32_t color,
+        CurrencyId currency = kBaseCurrency);
+    void removeAsset(size_t index);
+    void setQuantity(size_t index, int quantity);
+    void setPrice(size_t index, float price);
+    void setColor(size_t index, std::uint32_t color);
+    void setCurrency(size_t index, CurrencyId currency);
+    // Цена инструмента из внешнего источника: ставится всем активам с этим символом.
+    // Символ валютной пары (см. currency) меняет курс. Возвращает число обновлённых строк
+    size_t setSymbolPrice(SymbolId symbol, float price);
+
+    // Валюта по коду. Новая валюта получает курс 0 (неизвестен) и символ пары "<код>/<базовая>",
+    // так что курс приходит тем же потоком котировок, что и цены активов
+    CurrencyId currency(std::string_view code);
+    // Меняет базовую валюту; только пока в портфеле нет других валют
+    bool setBaseCurrency(std::string_view code);
+    // Единиц базовой валюты за единицу валюты. Переоценивает только корзину этой валюты
+    void setFxRate(CurrencyId currency, double rate);
+    SymbolId getFxSymbol(CurrencyId currency) const { return fxSymbols[currency]; }
+    // Сумма активов и денег валюты в самой валюте
+    double getCurrencyValue(CurrencyId currency) const { return currencyValues[currency]; }
+    // Свободные деньги входят в итог и в корзину своей валюты
+    double getCash(CurrencyId currency) const { return cash[currency]; }
+    // Пополнение (amount > 0) или вывод денег
+    void addCash(CurrencyId currency, double amount);
+    // Стоимость каждого актива в базовой валюте: сплошной проход по активам в их валютах,
+    // затем по группам валют, где курс каждой загружается один раз
+    void convertValues(std::vector<float>& values) const;
+    void setTarget(size_t index, float targetPercent, float tolerancePercent);
+    void addLot(SymbolId symbol, int quantity, float costPrice, std::int64_t openTime);
+    // Восстанавливает активы и лоты (например, после отмены), сохраняя введённые цели по имени
+    void restoreAssets(const std::vector<Asset>& saved, const std::vector<Lot>& savedLots);
+
+    // Проставляет цели по имени; активы без цели получают 0%
+    void applyTargets(const std::vector<TargetAllocation>& source);
+
+    // Сверяет портфель с новой версией по имени и меняет только отличающиеся строки:
+    // новые активы добавляются с целью 0%, исчезнувшие удаляются, у остальных цели сохраняются.
+    // Изменение количества оформляется как сделка: рост открывает лот, снижение закрывает по FIFO.
+    PortfolioDiff applyUpdate(const Portfolio& incoming, std::int64_t time);
+
+    // Сплиты, дивиденды и смены тикера из пакета за один проход по активам и один по лотам.
+    // События берутся только у символов портфеля; после смены тикера применяются события нового
+    // тикера начиная с даты смены. Дробные бумаги и денежные дивиденды зачисляются деньгами
+    // в валюте актива, цели и лоты переезжают вместе с тикером
+    CorporateActionReport applyCorporateActions(const CorporateActionBatch& batch);
+
+    // Поддерживается инкрементально, без прохода по активам; включает свободные деньги
+    float getTotalValue() const { return static_cast<float>(totalValue); }
+    float getTotalTargetPercent() const;
+
+    // Копирует состояние в снимок, переиспользуя его буферы
+    void fillSnapshot(PortfolioSnapshot& snapshot) const;
+
+    // Возвращает false, если сумма целей отличается от 100%. Цели считаются от итога
+    // вместе со свободными деньгами, поэтому деньги распределяются между активами
+    bool calculateRebalance(std::vector<RebalanceAction>& actions, float& extraCapital) const;
+    // Покупки открывают новые лоты, продажи закрывают старые по FIFO; деньги валюты актива
+    // уменьшаются на сумму покупок и растут на сумму продаж (нехватка — отрицательный остаток)
+    void applyRebalance(const std::vector<RebalanceAction>& actions, std::int64_t time);
+
+private:
+    void sellLots(SymbolId symbol, int quantity);
+    void changeQuantity(Asset& asset, int quantity, std::int64_t time);
+    void dropUnheldLots();
+    void recomputeTotals();
+    void rebuildSymbolIndex();
+    void rebuildCurrencyIndex() const;
+    // Изменение стоимости актива в его валюте: корзина валюты и итог в базовой
+    void addValue(CurrencyId currency, double delta) {
+        currencyValues[currency] += delta;
+        totalValue += delta * fx.rate(currency);
+    }
+
+    // Общая со снимками: очистка портфеля заводит новую таблицу, если старую кто-то держит
+    std::shared_ptr<SymbolTable> symbols = std::make_shared<SymbolTable>();
+    std::vector<Asset> assets;
+    std::vector<TargetAllocation> targets;
+    std::vector<Lot> lots;
+    PortfolioSettings settings;
+    FxTable fx;
+    std::vector<SymbolId> fxSymbols{ kInvalidSymbol }; // символ пары по валюте; у базовой нет
+    std::vector<double> currencyValues{ 0.0 };         // по валюте, в самой валюте, вместе с деньгами
+    std::vector<double> cash{ 0.0 };                   // по валюте
+    double totalValue = 0.0; // в базовой валюте; в double, чтобы приращения не накапливали ошибку float
+    std::uint64_t revision = 0;
+
+    // Активы по символу: первый индекс и цепочка остальных; перестраивается после удалений
+    std::vector<std::uint32_t> firstBySymbol;
+    std::vector<std::uint32_t> nextBySymbol;
+    bool symbolIndexValid = false;
+
+    // Индексы активов, сгруппированные по валюте (сортировка подсчётом); только для convertValues
+    mutable std::vector<std::uint32_t> currencyOrder;
+    mutable std::vector<std::uint32_t> currencyOffsets;
+    mutable bool currencyIndexValid = false;
+};
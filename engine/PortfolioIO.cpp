@@ -0,0 +1,445 @@
+#include "PortfolioIO.h"
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+// Читает файл целиком одним чтением
+bool readFile(const std::string& path, std::string& buffer) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    std::streamoff size = file.tellg();
+    file.seekg(0);
+    buffer.resize(static_cast<size_t>(size));
+    return size == 0 || static_cast<bool>(file.read(&buffer[0], size));
+}
+
+// Верхняя оценка числа позиций и суммарной длины имён: ищет ключи "name" и меряет значения.
+// Позволяет выделить арену и массивы за один раз до разбора.
+void estimateNames(std::string_view text, size_t& count, size_t& bytes) {
+    static constexpr std::string_view kKey = "\"name\"";
+    count = 0;
+    bytes = 0;
+    for (size_t pos = text.find(kKey); pos != std::string_view::npos; pos = text.find(kKey, pos)) {
+        pos += kKey.size();
+        size_t open = text.find('"', pos);
+        if (open == std::string_view::npos) break;
+        size_t close = open + 1;
+        while (close < text.size() && text[close] != '"') close += text[close] == '\\' ? 2 : 1;
+        ++count;
+        bytes += close - open; // длина значения плюс завершающий ноль
+        pos = close;
+    }
+}
+
+// Потоковый разбор JSON с отслеживанием пути: для каждой глубины помнится последний ключ
+// и тип контейнера. Лексер переиспользует буфер строк, ключи копируются в строки
+// с сохранённой ёмкостью, так что на запись не тратится ни одной аллокации.
+class JsonPathSax : public nlohmann::json_sax<nlohmann::json> {
+public:
+    std::string error;
+
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t value) override { return onNumber(static_cast<double>(value)); }
+    bool number_unsigned(number_unsigned_t value) override { return onNumber(static_cast<double>(value)); }
+    bool number_float(number_float_t value, const string_t&) override { return onNumber(value); }
+    bool string(string_t& value) override { return onString(value); }
+    bool binary(binary_t&) override { return true; }
+
+    bool key(string_t& name) override {
+        if (level < kMaxDepth) keys[level] = name;
+        return true;
+    }
+
+    bool start_object(std::size_t) override { return enter(false) && onStartObject(); }
+    bool end_object() override { bool ok = onEndObject(); --level; return ok; }
+    bool start_array(std::size_t) override { return enter(true) && onStartArray(); }
+    bool end_array() override { --level; return true; }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        error = "parse error at byte " + std::to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+protected:
+    // Глубина текущего контейнера: 1 — корневой объект
+    int depth() const { return level; }
+    // Последний ключ объекта на глубине d (пусто для массивов и слишком глубоких уровней)
+    const std::string& keyAt(int d) const { return d < kMaxDepth ? keys[d] : empty; }
+    bool isArray(int d) const { return d < kMaxDepth && arrays[d]; }
+    // Значение лежит в объекте текущей глубины под ключом field()
+    const std::string& field() const { return keyAt(level); }
+
+    virtual bool onStartObject() { return true; }
+    virtual bool onEndObject() { return true; }
+    virtual bool onStartArray() { return true; }
+    virtual bool onString(const std::string&) { return true; }
+    virtual bool onNumber(double) { return true; }
+
+private:
+    static constexpr int kMaxDepth = 8;
+
+    bool enter(bool array) {
+        ++level;
+        if (level < kMaxDepth) {
+            keys[level].clear();
+            arrays[level] = array;
+        }
+        return true;
+    }
+
+    std::array<std::string, kMaxDepth> keys;
+    std::array<bool, kMaxDepth> arrays{};
+    std::string empty;
+    int level = 0;
+};
+
+// Полное состояние портфеля, см. формат в PortfolioIO.h
+class PortfolioSaxHandler : public JsonPathSax {
+public:
+    explicit PortfolioSaxHandler(Portfolio& portfolio) : portfolio(portfolio) {}
+
+    bool assetsSeen = false;
+
+protected:
+    bool inAsset() const { return depth() == 3 && isArray(2) && keyAt(1) == "assets"; }
+    bool inLot() const { return depth() == 5 && isArray(4) && keyAt(3) == "lots" && keyAt(1) == "assets" && isArray(2); }
+    bool inSettings() const { return depth() == 2 && !isArray(2) && keyAt(1) == "settings"; }
+    bool inFx() const { return depth() == 2 && !isArray(2) && keyAt(1) == "fx"; }
+    bool inCash() const { return depth() == 2 && !isArray(2) && keyAt(1) == "cash"; }
+
+    bool onStartArray() override {
+        if (depth() == 2 && keyAt(1) == "assets") assetsSeen = true;
+        else if (depth() == 4 && keyAt(3) == "lots" && keyAt(1) == "assets" && isArray(2)) hasLots = true;
+        return true;
+    }
+
+    bool onStartObject() override {
+        if (inAsset()) {
+            hasName = hasQuantity = hasPrice = hasLots = false;
+            color = 0;
+            currency = kBaseCurrency;
+            targetPercent = 0.0f;
+            tolerancePercent = portfolio.getSettings().defaultTolerancePercent;
+            pendingLots.clear();
+        }
+        else if (inLot()) {
+            pendingLots.push_back({ kInvalidSymbol, 0, 0.0f, 0 });
+        }
+        return true;
+    }
+
+    bool onString(const std::string& value) override {
+        if (inAsset() && field() == "name") {
+            name = value;
+            hasName = true;
+        }
+        else if (inAsset() && field() == "currency") {
+            currency = portfolio.currency(value);
+        }
+        else if (inSettings() && field() == "baseCurrency" && !portfolio.setBaseCurrency(value)) {
+            error = "baseCurrency must come before assets and fx rates";
+            return false;
+        }
+        return true;
+    }
+
+    bool onNumber(double value) override {
+        if (depth() == 1 && field() == "version" && value > kPortfolioFormatVersion) {
+            error = "unsupported format version " + std::to_string(static_cast<int>(value));
+            return false;
+        }
+        if (inSettings()) {
+            if (field() == "defaultTolerancePercent") portfolio.getSettings().defaultTolerancePercent = static_cast<float>(value);
+        }
+        else if (inFx()) {
+            portfolio.setFxRate(portfolio.currency(field()), value);
+        }
+        else if (inCash()) {
+            portfolio.addCash(portfolio.currency(field()), value);
+        }
+        else if (inAsset()) {
+            const std::string& f = field();
+            if (f == "quantity") { quantity = static_cast<int>(value); hasQuantity = true; }
+            else if (f == "price") { price = static_cast<float>(value); hasPrice = true; }
+            else if (f == "color") color = static_cast<std::uint32_t>(value);
+            else if (f == "targetPercent") targetPercent = static_cast<float>(value);
+            else if (f == "tolerancePercent") tolerancePercent = static_cast<float>(value);
+        }
+        else if (inLot()) {
+            Lot& lot = pendingLots.back();
+            const std::string& f = field();
+            if (f == "quantity") lot.quantity = static_cast<int>(value);
+            else if (f == "costPrice") lot.costPrice = static_cast<float>(value);
+            else if (f == "openTime") lot.openTime = static_cast<std::int64_t>(value);
+        }
+        return true;
+    }
+
+    bool onEndObject() override {
+        if (!inAsset()) return true;
+        if (!hasName || !hasQuantity || !hasPrice) {
+            error = "asset entry needs name, quantity and price";
+            return false;
+        }
+        size_t index = portfolio.addAsset(name, quantity, price, color, currency);
+        portfolio.setTarget(index, targetPercent, tolerancePercent);
+        SymbolId symbol = portfolio.getAssets()[index].symbol;
+        if (!hasLots && quantity > 0) {
+            // Старый формат: вся позиция считается одним лотом по текущей цене
+            portfolio.addLot(symbol, quantity, price, 0);
+        }
+        for (const auto& lot : pendingLots) {
+            portfolio.addLot(symbol, lot.quantity, lot.costPrice, lot.openTime);
+        }
+        return true;
+    }
+
+private:
+    Portfolio& portfolio;
+    std::string name; // ёмкость переиспользуется между записями
+    int quantity = 0;
+    float price = 0.0f;
+    std::uint32_t color = 0;
+    CurrencyId currency = kBaseCurrency;
+    float targetPercent = 0.0f;
+    float tolerancePercent = 0.0f;
+    std::vector<Lot> pendingLots;
+    bool hasName = false, hasQuantity = false, hasPrice = false, hasLots = false;
+};
+
+// {"targets": [{"name": ..., "targetPercent": ..., "tolerancePercent": ...}, ...]}
+class TargetsSaxHandler : public JsonPathSax {
+public:
+    TargetsSaxHandler(SymbolTable& names, std::vector<TargetAllocation>& targets) : names(names), targets(targets) {}
+
+    bool targetsSeen = false;
+
+protected:
+    bool inTarget() const { return depth() == 3 && isArray(2) && keyAt(1) == "targets"; }
+
+    bool onStartArray() override {
+        if (depth() == 2 && keyAt(1) == "targets") targetsSeen = true;
+        return true;
+    }
+
+    bool onStartObject() override {
+        if (inTarget()) {
+            hasName = hasPercent = false;
+            tolerance = 0.0f;
+        }
+        return true;
+    }
+
+    bool onString(const std::string& value) override {
+        if (inTarget() && field() == "name") {
+            name = names.name(names.intern(value));
+            hasName = true;
+        }
+        return true;
+    }
+
+    bool onNumber(double value) override {
+        if (inTarget()) {
+            if (field() == "targetPercent") { percent = static_cast<float>(value); hasPercent = true; }
+            else if (field() == "tolerancePercent") tolerance = static_cast<float>(value);
+        }
+        return true;
+    }
+
+    bool onEndObject() override {
+        if (!inTarget()) return true;
+        if (!hasName || !hasPercent) {
+            error = "target entry needs name and targetPercent";
+            return false;
+        }
+        targets.push_back({ name, percent, tolerance });
+        return true;
+    }
+
+private:
+    SymbolTable& names;
+    std::vector<TargetAllocation>& targets;
+    std::string_view name;
+    float percent = 0.0f;
+    float tolerance = 0.0f;
+    bool hasName = false, hasPercent = false;
+};
+
+void appendJsonString(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+// %.9g восстанавливает float без потерь
+void appendFormat(std::string& out, const char* format, double value) {
+    char text[64];
+    int n = std::snprintf(text, sizeof(text), format, value);
+    out.append(text, static_cast<size_t>(n));
+}
+
+} // namespace
+
+bool loadPortfolioFile(const std::string& path, Portfolio& portfolio, std::string* error) {
+    // Буфер файла переиспользуется между загрузками (важно для пакетного режима)
+    static thread_local std::string buffer;
+    if (!readFile(path, buffer)) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+
+    size_t count = 0, nameBytes = 0;
+    estimateNames(buffer, count, nameBytes);
+    portfolio.clear();
+    portfolio.reserve(count, nameBytes);
+
+    PortfolioSaxHandler handler(portfolio);
+    if (!nlohmann::json::sax_parse(buffer, &handler) || !handler.assetsSeen) {
+        if (error) *error = path + ": " + (handler.error.empty() ? "missing \"assets\" array" : handler.error);
+        portfolio.clear();
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+// Общая запись для портфеля и его снимка: у обоих одинаковые getAssets/getTargets/getLots/getSettings
+template <class Source>
+bool writePortfolioFile(const std::string& path, const Source& portfolio, size_t symbolCount) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    // Лоты группируются по символу сортировкой подсчётом, порядок открытия внутри символа сохраняется
+    const auto& lots = portfolio.getLots();
+    std::vector<size_t> lotOffsets(symbolCount + 1, 0);
+    for (const auto& lot : lots) ++lotOffsets[lot.symbol + 1];
+    for (size_t s = 0; s < symbolCount; ++s) lotOffsets[s + 1] += lotOffsets[s];
+    std::vector<const Lot*> lotsBySymbol(lots.size());
+    std::vector<size_t> cursor(lotOffsets.begin(), lotOffsets.end() - 1);
+    for (const auto& lot : lots) lotsBySymbol[cursor[lot.symbol]++] = &lot;
+    std::vector<bool> lotsWritten(symbolCount, false);
+
+    std::string out;
+    out.reserve(1 << 16);
+    out += "{\n    \"version\": ";
+    out += std::to_string(kPortfolioFormatVersion);
+    out += ",\n    \"settings\": {\n        \"defaultTolerancePercent\": ";
+    appendFormat(out, "%.9g", portfolio.getSettings().defaultTolerancePercent);
+    const FxTable& fx = portfolio.getFx();
+    out += ",\n        \"baseCurrency\": ";
+    appendJsonString(out, fx.baseCode());
+    out += "\n    },\n    \"fx\": {";
+    for (CurrencyId c = 1; c < fx.size(); ++c) {
+        out += c == 1 ? "\n        " : ",\n        ";
+        appendJsonString(out, fx.code(c));
+        out += ": ";
+        appendFormat(out, "%.17g", fx.rate(c));
+    }
+    out += fx.size() > 1 ? "\n    },\n    \"cash\": {" : "},\n    \"cash\": {";
+    bool anyCash = false;
+    for (CurrencyId c = 0; c < fx.size(); ++c) {
+        if (portfolio.getCash(c) == 0.0) continue;
+        out += anyCash ? ",\n        " : "\n        ";
+        appendJsonString(out, fx.code(c));
+        out += ": ";
+        appendFormat(out, "%.17g", portfolio.getCash(c));
+        anyCash = true;
+    }
+    out += anyCash ? "\n    },\n    \"assets\": [" : "},\n    \"assets\": [";
+
+    const auto& assets = portfolio.getAssets();
+    const auto& targets = portfolio.getTargets();
+    bool ok = true;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        const Asset& asset = assets[i];
+        out += i == 0 ? "\n        {" : ",\n        {";
+        out += "\n            \"name\": ";
+        appendJsonString(out, asset.name);
+        out += ",\n            \"quantity\": ";
+        out += std::to_string(asset.quantity);
+        out += ",\n            \"price\": ";
+        appendFormat(out, "%.9g", asset.price);
+        out += ",\n            \"currency\": ";
+        appendJsonString(out, fx.code(asset.currency));
+        out += ",\n            \"color\": ";
+        out += std::to_string(asset.color);
+        out += ",\n            \"targetPercent\": ";
+        appendFormat(out, "%.9g", targets[i].targetPercent);
+        out += ",\n            \"tolerancePercent\": ";
+        appendFormat(out, "%.9g", targets[i].tolerancePercent);
+        out += ",\n            \"lots\": [";
+        // Лоты символа пишутся у первого актива с этим именем
+        size_t first = lotOffsets[asset.symbol];
+        size_t last = lotsWritten[asset.symbol] ? first : lotOffsets[asset.symbol + 1];
+        lotsWritten[asset.symbol] = true;
+        for (size_t k = first; k < last; ++k) {
+            const Lot& lot = *lotsBySymbol[k];
+            out += k == first ? "\n                { \"quantity\": " : ",\n                { \"quantity\": ";
+            out += std::to_string(lot.quantity);
+            out += ", \"costPrice\": ";
+            appendFormat(out, "%.9g", lot.costPrice);
+            out += ", \"openTime\": ";
+            out += std::to_string(lot.openTime);
+            out += " }";
+        }
+        out += first == last ? "]" : "\n            ]";
+        out += "\n        }";
+
+        if (out.size() >= (1 << 16)) {
+            ok = ok && std::fwrite(out.data(), 1, out.size(), file) == out.size();
+            out.clear();
+        }
+    }
+    out += assets.empty() ? "]\n}\n" : "\n    ]\n}\n";
+    ok = ok && std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+bool savePortfolioFile(const std::string& path, const Portfolio& portfolio) {
+    return writePortfolioFile(path, portfolio, portfolio.getSymbols().size());
+}
+
+bool savePortfolioFile(const std::string& path, const PortfolioSnapshot& snapshot) {
+    return writePortfolioFile(path, snapshot, snapshot.getSymbolCount());
+}
+
+bool loadTargetsFile(const std::string& path, SymbolTable& names, std::vector<TargetAllocation>& targets,
+    std::string* error) {
+    std::string buffer;
+    if (!readFile(path, buffer)) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    targets.clear();
+    TargetsSaxHandler handler(names, targets);
+    if (!nlohmann::json::sax_parse(buffer, &handler) || !handler.targetsSeen) {
+        if (error) *error = path + ": " + (handler.error.empty() ? "missing \"targets\" array" : handler.error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Portfolio.h"
+
+#include <string>
+#include <vector>
+
+// Формат файла (version 3) хранит всё состояние движка:
+// {
+//   "version": 3,
+//   "settings": { "defaultTolerancePercent": 0.0, "baseCurrency": "RUB" },
+//   "fx": { "USD": 92.5 },
+//   "cash": { "RUB": 1500.0, "USD": 12.5 },
+//   "assets": [ { "name": "SBER", "quantity": 10, "price": 250.5, "currency": "RUB", "color": 4280287436,
+//                 "targetPercent": 40.0, "tolerancePercent": 1.0,
+//                 "lots": [ { "quantity": 10, "costPrice": 230.0, "openTime": 1700000000 } ] } ]
+// }
+// Курсы в "fx" — единиц базовой валюты за единицу валюты; цены и стоимость лотов — в валюте актива,
+// "cash" — свободные деньги по валютам (необязательно).
+// Файлы версии 2 (без валют) читаются в базовой валюте RUB; файлы версии 1 (только name/quantity/price) —
+// с целями 0% и одним лотом по текущей цене.
+constexpr int kPortfolioFormatVersion = 3;
+
+// Загрузка идёт потоковым SAX-разбором прямо в арену имён, без промежуточного DOM
+bool loadPortfolioFile(const std::string& path, Portfolio& portfolio, std::string* error = nullptr);
+bool savePortfolioFile(const std::string& path, const Portfolio& portfolio);
+// То же из снимка — можно вызывать в фоновом потоке, пока окно меняет портфель
+bool savePortfolioFile(const std::string& path, const PortfolioSnapshot& snapshot);
+// {"targets": [{"name": ..., "targetPercent": ..., "tolerancePercent": ...}]}.
+// Имена целей интернируются в переданную таблицу, которая должна пережить targets
+bool loadTargetsFile(const std::string& path, SymbolTable& names, std::vector<TargetAllocation>& targets,
+    std::string* error = nullptr);
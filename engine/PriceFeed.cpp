@@ -0,0 +1,256 @@
+#include "PriceFeed.h"
+#include "TickConflator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kPushBatch = 256;
+
+// SplitMix64: переносимый генератор, в отличие от распределений стандартной библиотеки
+std::uint64_t nextRandom(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Равномерно на [0, 1)
+double nextUnit(std::uint64_t& state) {
+    return static_cast<double>(nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::int64_t steadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+} // namespace
+
+PriceFeed::PriceFeed(size_t capacity) : ring(capacity) {}
+
+PriceFeed::~PriceFeed() {
+    stop();
+}
+
+bool PriceFeed::loadReplayFile(const std::string& filePath, std::string* error) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        if (error) *error = "cannot open " + filePath;
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Разбор идёт во временные структуры: при ошибке прежняя запись остаётся нетронутой
+    SymbolTable loadedSymbols;
+    std::vector<RawTick> loaded;
+    loaded.reserve(text.size() / 24);
+    size_t lineNumber = 0;
+    for (size_t begin = 0; begin < text.size();) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) end = text.size();
+        std::string_view line = trim(std::string_view(text).substr(begin, end - begin));
+        begin = end + 1;
+        ++lineNumber;
+        if (line.empty() || line.front() == '#') continue;
+
+        size_t firstComma = line.find(',');
+        size_t secondComma = firstComma == std::string_view::npos ? firstComma : line.find(',', firstComma + 1);
+        if (secondComma == std::string_view::npos) {
+            if (error) *error = filePath + ":" + std::to_string(lineNumber) + ": expected time,symbol,price";
+            return false;
+        }
+        // Строки из полей; strtoll/strtof требуют завершающего нуля
+        std::string timeField(trim(line.substr(0, firstComma)));
+        std::string priceField(trim(line.substr(secondComma + 1)));
+        std::string_view name = trim(line.substr(firstComma + 1, secondComma - firstComma - 1));
+        char* timeEnd = nullptr;
+        char* priceEnd = nullptr;
+        long long timestamp = std::strtoll(timeField.c_str(), &timeEnd, 10);
+        float price = std::strtof(priceField.c_str(), &priceEnd);
+        if (timeEnd == timeField.c_str() && loaded.empty()) continue; // заголовок
+        if (timeEnd == timeField.c_str() || priceEnd == priceField.c_str() || name.empty()) {
+            if (error) *error = filePath + ":" + std::to_string(lineNumber) + ": malformed tick";
+            return false;
+        }
+        loaded.push_back({ loadedSymbols.intern(name), price, timestamp });
+    }
+    // Тики прежней записи, не дошедшие до читателя, к новой не относятся
+    ring.drain([](const PriceTick&) {}, ring.capacity());
+    feedSymbols = std::move(loadedSymbols);
+    ticks = std::move(loaded);
+    path = filePath;
+    portfolioSymbol.clear();
+    unboundSymbols = feedSymbols.size();
+    position.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void PriceFeed::generateSynthetic(const Portfolio& portfolio, size_t count, double ticksPerSecond,
+    std::uint64_t seed) {
+    const auto& assets = portfolio.getAssets();
+    ring.drain([](const PriceTick&) {}, ring.capacity());
+    feedSymbols.clear();
+    ticks.clear();
+    path.clear();
+    portfolioSymbol.clear();
+    position.store(0, std::memory_order_relaxed);
+    if (assets.empty() || count == 0) {
+        unboundSymbols = 0;
+        return;
+    }
+
+    std::vector<double> prices;
+    for (const auto& asset : assets) {
+        SymbolId id = feedSymbols.intern(asset.name);
+        if (id == prices.size()) prices.push_back(asset.price > 0.0f ? asset.price : 100.0);
+    }
+    unboundSymbols = feedSymbols.size();
+
+    std::uint64_t state = seed;
+    const double stepMs = ticksPerSecond > 0.0 ? 1000.0 / ticksPerSecond : 0.0;
+    ticks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        // Куб равномерной величины: небольшая часть символов получает большую часть тиков
+        double u = nextUnit(state);
+        SymbolId symbol = static_cast<SymbolId>(static_cast<double>(prices.size()) * u * u * u);
+        double& symbolPrice = prices[symbol];
+        symbolPrice *= 1.0 + (nextUnit(state) - 0.5) * 0.002;
+        ticks.push_back({ symbol, static_cast<float>(symbolPrice), static_cast<std::int64_t>(i * stepMs) });
+    }
+}
+
+bool PriceFeed::saveReplayFile(const std::string& filePath, std::string* error) const {
+    std::FILE* out = std::fopen(filePath.c_str(), "wb");
+    if (!out) {
+        if (error) *error = "cannot open " + filePath + " for writing";
+        return false;
+    }
+    std::string buffer = "time_ms,symbol,price\n";
+    char number[64];
+    for (const auto& tick : ticks) {
+        int n = std::snprintf(number, sizeof(number), "%lld,", static_cast<long long>(tick.timestamp));
+        buffer.append(number, static_cast<size_t>(n));
+        buffer += feedSymbols.name(tick.symbol);
+        // 9 значащих цифр восстанавливают float без потерь
+        n = std::snprintf(number, sizeof(number), ",%.9g\n", tick.price);
+        buffer.append(number, static_cast<size_t>(n));
+        if (buffer.size() >= (1 << 20)) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+    bool ok = std::fclose(out) == 0;
+    if (!ok && error) *error = "cannot write " + filePath;
+    return ok;
+}
+
+void PriceFeed::bind(const SymbolTable& portfolioSymbols) {
+    std::vector<SymbolId> mapping(feedSymbols.size());
+    unboundSymbols = 0;
+    for (SymbolId id = 0; id < feedSymbols.size(); ++id) {
+        mapping[id] = portfolioSymbols.find(feedSymbols.name(id));
+        if (mapping[id] == kInvalidSymbol) ++unboundSymbols;
+    }
+    if (mapping == portfolioSymbol) return;
+    // Тики в кольце несут символы прежней привязки: они снимаются, а проигрывание отступает
+    // к первому из них, чтобы отправить их заново уже с новыми символами
+    size_t pending = ring.drain([](const PriceTick&) {}, ring.capacity());
+    size_t next = position.load(std::memory_order_relaxed);
+    if (portfolioSymbol.size() == feedSymbols.size()) {
+        while (pending > 0 && next > 0) {
+            --next;
+            if (portfolioSymbol[ticks[next].symbol] != kInvalidSymbol) --pending;
+        }
+        position.store(next, std::memory_order_relaxed);
+    }
+    portfolioSymbol = std::move(mapping);
+}
+
+void PriceFeed::start(double speed) {
+    stop();
+    if (ticks.empty() || portfolioSymbol.size() != feedSymbols.size()) return;
+    if (position.load(std::memory_order_relaxed) >= ticks.size()) rewind();
+    stopRequested.store(false, std::memory_order_relaxed);
+    finished.store(false, std::memory_order_relaxed);
+    producer = std::thread([this, speed] { replayLoop(speed); });
+}
+
+void PriceFeed::stop() {
+    if (!producer.joinable()) return;
+    stopRequested.store(true, std::memory_order_relaxed);
+    producer.join();
+    // Отправленные тики остаются в кольце и дочитываются после паузы; снимает их только bind
+}
+
+void PriceFeed::rewind() {
+    if (!producer.joinable()) position.store(0, std::memory_order_relaxed);
+}
+
+size_t PriceFeed::drain(TickConflator& conflator, size_t maxTicks) {
+    return ring.drain([&](const PriceTick& tick) { conflator.push(tick); }, maxTicks);
+}
+
+void PriceFeed::replayLoop(double speed) {
+    PriceTick batch[kPushBatch];
+    size_t source[kPushBatch]; // индекс тика записи для каждого элемента batch
+    size_t next = position.load(std::memory_order_relaxed);
+    // Время источника привязывается к моменту запуска, чтобы продолжение шло без скачка
+    const Clock::time_point wallStart = Clock::now();
+    const std::int64_t feedStart = ticks[next].timestamp;
+
+    while (next < ticks.size() && !stopRequested.load(std::memory_order_relaxed)) {
+        size_t end = next;
+        if (speed > 0.0) {
+            double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - wallStart).count();
+            std::int64_t due = feedStart + static_cast<std::int64_t>(elapsedMs * speed);
+            if (ticks[next].timestamp > due) {
+                // Короткий сон, чтобы stop не ждал долгих пауз в записи
+                double waitMs = std::min((ticks[next].timestamp - due) / speed, 20.0);
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(waitMs));
+                continue;
+            }
+            while (end < ticks.size() && end - next < kPushBatch && ticks[end].timestamp <= due) ++end;
+        }
+        else {
+            end = std::min(ticks.size(), next + kPushBatch);
+        }
+
+        size_t count = 0;
+        const std::int64_t publishedAt = steadyNanoseconds();
+        for (size_t i = next; i < end; ++i) {
+            SymbolId symbol = portfolioSymbol[ticks[i].symbol];
+            if (symbol == kInvalidSymbol) continue;
+            source[count] = i;
+            batch[count++] = { symbol, ticks[i].price, ticks[i].timestamp, publishedAt };
+        }
+        // Полное кольцо — обратное давление: ждём читателя, тики не теряются
+        size_t sent = 0;
+        while (sent < count && !stopRequested.load(std::memory_order_relaxed)) {
+            sent += ring.pushBatch(batch + sent, count - sent);
+            if (sent < count) std::this_thread::yield();
+        }
+        if (sent < count) {
+            // Остановка посреди пачки: продолжение начнётся с первого неотправленного тика
+            if (sent > 0) position.store(source[sent - 1] + 1, std::memory_order_relaxed);
+            break;
+        }
+        next = end;
+        position.store(next, std::memory_order_relaxed);
+    }
+    finished.store(true, std::memory_order_release);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Portfolio.h"
+#include "SpscRing.h"
+#include "SymbolTable.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TickConflator;
+
+// Котировка в кольце: символ уже переведён в SymbolId портфеля
+struct PriceTick {
+    SymbolId symbol;
+    float price;
+    std::int64_t timestamp;   // миллисекунды времени источника
+    std::int64_t publishedAt; // steady_clock, нс: момент отправки пачки в кольцо
+};
+
+// Источник котировок, проигрывающий записанный поток из CSV «время_мс,символ,цена».
+// Поток-производитель пишет тики в SpscRing, интерфейс раз в кадр вычитывает их в TickConflator,
+// поэтому ни одна сторона не берёт блокировок. Символы файла хранятся в собственной таблице
+// и сопоставляются с портфелем в bind: после загрузки другого портфеля достаточно
+// остановить источник, заново вызвать bind и запустить — проигрывание продолжится с того же места.
+class PriceFeed {
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
+    explicit PriceFeed(size_t capacity = kDefaultCapacity);
+    ~PriceFeed();
+    PriceFeed(const PriceFeed&) = delete;
+    PriceFeed& operator=(const PriceFeed&) = delete;
+
+    // Только при остановленном источнике
+    bool loadReplayFile(const std::string& path, std::string* error = nullptr);
+    // Синтетический рынок по активам портфеля: случайное блуждание цен с заданным зерном.
+    // Одинаковые зерно и портфель дают одинаковую запись на любой платформе
+    void generateSynthetic(const Portfolio& portfolio, size_t count, double ticksPerSecond, std::uint64_t seed);
+    bool saveReplayFile(const std::string& path, std::string* error = nullptr) const;
+    // Сопоставляет символы файла с таблицей портфеля; неизвестные символы пропускаются.
+    // Только при остановленном источнике и из потока читателя: при смене привязки ещё не
+    // прочитанные тики снимаются с кольца и будут отправлены заново
+    void bind(const SymbolTable& portfolioSymbols);
+    // speed: 1 — в темпе записи, N — в N раз быстрее, 0 — без пауз
+    void start(double speed);
+    void stop();
+    void rewind();
+
+    bool isLoaded() const { return !ticks.empty(); }
+    bool isRunning() const { return producer.joinable() && !finished.load(std::memory_order_acquire); }
+    const std::string& getPath() const { return path; }
+    size_t getTickCount() const { return ticks.size(); }
+    size_t getPosition() const { return position.load(std::memory_order_relaxed); }
+    size_t getUnboundSymbols() const { return unboundSymbols; }
+
+    // Только поток интерфейса: переносит до maxTicks накопившихся тиков в conflator.
+    // Возвращает число прочитанных тиков
+    size_t drain(TickConflator& conflator, size_t maxTicks = kDefaultCapacity);
+
+private:
+    struct RawTick {
+        SymbolId symbol; // в таблице файла
+        float price;
+        std::int64_t timestamp;
+    };
+
+    void replayLoop(double speed);
+
+    SpscRing<PriceTick> ring;
+    SymbolTable feedSymbols;
+    std::vector<RawTick> ticks;
+    std::vector<SymbolId> portfolioSymbol; // символ файла -> символ портфеля
+    size_t unboundSymbols = 0;
+    std::string path;
+
+    std::thread producer;
+    std::atomic<bool> stopRequested{ false };
+    std::atomic<bool> finished{ false };
+    std::atomic<size_t> position{ 0 }; // следующий тик к отправке
+};
@@ -0,0 +1,381 @@
+#include "PriceHistory.h"
+#include "Bits.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+std::uint32_t floatBits(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Биты пишутся от младшего к старшему, поэтому префикс «10» записывается как 0b01
+std::uint64_t readBits(const std::uint64_t* words, size_t& position, unsigned count) {
+    if (count == 0) return 0;
+    size_t word = position >> 6;
+    unsigned offset = static_cast<unsigned>(position & 63);
+    std::uint64_t value = words[word] >> offset;
+    if (offset + count > 64) value |= words[word + 1] << (64 - offset);
+    position += count;
+    return count == 64 ? value : value & ((std::uint64_t(1) << count) - 1);
+}
+
+float centsToFloat(std::int64_t cents) {
+    return static_cast<float>(static_cast<double>(cents) / 100.0);
+}
+
+// true, если цена восстанавливается из целого числа сотых без потерь
+bool toCents(float price, std::int64_t& cents) {
+    double scaled = static_cast<double>(price) * 100.0;
+    if (!std::isfinite(scaled) || std::abs(scaled) > 1e15) return false;
+    cents = std::llround(scaled);
+    return centsToFloat(cents) == price;
+}
+
+// Корзины целочисленной дельты: префикс, ширина поля и смещение.
+// Ноль кодируется одним битом, не попавшее в корзины — префиксом 1111 и сырым значением
+struct DeltaBucket {
+    std::uint64_t prefix;
+    unsigned prefixBits;
+    unsigned valueBits;
+    std::int64_t bias;
+};
+
+using DeltaBuckets = DeltaBucket[3];
+
+constexpr DeltaBuckets kTimeBuckets = {
+    { 0b01, 2, 7, 63 },
+    { 0b011, 3, 9, 255 },
+    { 0b0111, 4, 12, 2047 },
+};
+
+constexpr DeltaBuckets kCentBuckets = {
+    { 0b01, 2, 4, 7 },
+    { 0b011, 3, 7, 63 },
+    { 0b0111, 4, 12, 2047 },
+};
+
+constexpr unsigned kRawTimeBits = 64;
+constexpr unsigned kRawCentBits = 32;
+
+// Целое со знаком кодом переменной длины по таблице корзин
+template <class Stream>
+void writeDelta(Stream& out, std::int64_t value, const DeltaBuckets& buckets, unsigned rawBits) {
+    if (value == 0) {
+        out.write(0, 1);
+        return;
+    }
+    for (const auto& bucket : buckets) {
+        if (value >= -bucket.bias && value <= bucket.bias + 1) {
+            out.write(bucket.prefix, bucket.prefixBits);
+            out.write(static_cast<std::uint64_t>(value + bucket.bias), bucket.valueBits);
+            return;
+        }
+    }
+    out.write(0b1111, 4);
+    out.write(static_cast<std::uint64_t>(value), rawBits);
+}
+
+std::int64_t readDelta(const std::uint64_t* words, size_t& position, const DeltaBuckets& buckets, unsigned rawBits) {
+    if (!readBits(words, position, 1)) return 0;
+    unsigned bucket = 0;
+    while (bucket < 3 && readBits(words, position, 1)) ++bucket;
+    if (bucket < 3) {
+        return static_cast<std::int64_t>(readBits(words, position, buckets[bucket].valueBits)) - buckets[bucket].bias;
+    }
+    std::uint64_t raw = readBits(words, position, rawBits);
+    return rawBits == 64 ? static_cast<std::int64_t>(raw) : static_cast<std::int32_t>(raw);
+}
+
+} // namespace
+
+void PriceHistory::BitStream::write(std::uint64_t value, unsigned count) {
+    if (count == 0) return;
+    if (count < 64) value &= (std::uint64_t(1) << count) - 1;
+    unsigned offset = static_cast<unsigned>(bitCount & 63);
+    if (offset == 0) words.push_back(0);
+    words.back() |= value << offset;
+    if (offset + count > 64) words.push_back(value >> (64 - offset));
+    bitCount += count;
+}
+
+PriceHistory::SeriesId PriceHistory::series(std::string_view name) {
+    SeriesId id = names.intern(name);
+    if (id == data.size()) data.emplace_back();
+    return id;
+}
+
+bool PriceHistory::append(SeriesId id, std::int64_t time, float price) {
+    Series& series = data[id];
+    Encoder& encoder = series.encoder;
+    std::uint32_t bits = floatBits(price);
+    if (!series.chunks.empty() && time < series.chunks.back().lastTime) return false;
+
+    std::int64_t cents = 0;
+    bool decimal = toCents(price, cents);
+    bool fits = !series.chunks.empty() && series.chunks.back().count < kChunkPoints;
+    if (fits && series.chunks.back().decimal) {
+        std::int64_t step = cents - encoder.lastCents;
+        fits = decimal && step >= INT32_MIN && step <= INT32_MAX;
+    }
+    if (!fits) {
+        // Новый блок сразу получает объём прошлого: ряды обычно сжимаются ровно
+        size_t timeBits = 0, priceBits = 0;
+        if (!series.chunks.empty()) {
+            Chunk& sealed = series.chunks.back();
+            sealed.times.shrink();
+            sealed.prices.shrink();
+            timeBits = sealed.times.size() + 64;
+            priceBits = sealed.prices.size() + 64;
+        }
+        Chunk& chunk = series.chunks.emplace_back();
+        chunk.firstTime = chunk.lastTime = time;
+        chunk.firstPrice = chunk.lastPrice = bits;
+        chunk.decimal = decimal;
+        chunk.count = 1;
+        chunk.times.reserve(timeBits);
+        chunk.prices.reserve(priceBits);
+        encoder = Encoder();
+        encoder.lastPrice = bits;
+        encoder.lastCents = cents;
+        ++points;
+        return true;
+    }
+
+    Chunk& chunk = series.chunks.back();
+    std::int64_t delta = time - chunk.lastTime;
+    writeDelta(chunk.times, delta - encoder.lastDelta, kTimeBuckets, kRawTimeBits);
+    encoder.lastDelta = delta;
+    chunk.lastTime = time;
+    chunk.lastPrice = bits;
+
+    if (chunk.decimal) {
+        writeDelta(chunk.prices, cents - encoder.lastCents, kCentBuckets, kRawCentBits);
+        encoder.lastCents = cents;
+    }
+    else {
+        std::uint32_t xored = bits ^ encoder.lastPrice;
+        if (xored == 0) {
+            chunk.prices.write(0, 1);
+        }
+        else {
+            unsigned leading = 31 - highestBit(xored);
+            unsigned trailing = lowestBit(xored);
+            if (encoder.hasWindow && leading >= encoder.leading && trailing >= encoder.trailing) {
+                // Значащие биты укладываются в окно предыдущего значения
+                chunk.prices.write(0b01, 2);
+                chunk.prices.write(xored >> encoder.trailing, 32 - encoder.leading - encoder.trailing);
+            }
+            else {
+                unsigned length = 32 - leading - trailing;
+                chunk.prices.write(0b11, 2);
+                chunk.prices.write(leading, 5);
+                chunk.prices.write(length - 1, 5);
+                chunk.prices.write(xored >> trailing, length);
+                encoder.leading = static_cast<std::uint8_t>(leading);
+                encoder.trailing = static_cast<std::uint8_t>(trailing);
+                encoder.hasWindow = true;
+            }
+        }
+    }
+    encoder.lastPrice = bits;
+    ++chunk.count;
+    ++points;
+    return true;
+}
+
+size_t PriceHistory::pointCount(SeriesId id) const {
+    const auto& chunks = data[id].chunks;
+    return chunks.empty() ? 0 : (chunks.size() - 1) * kChunkPoints + chunks.back().count;
+}
+
+bool PriceHistory::lastPoint(SeriesId id, std::int64_t& time, float& price) const {
+    const auto& chunks = data[id].chunks;
+    if (chunks.empty()) return false;
+    time = chunks.back().lastTime;
+    std::memcpy(&price, &chunks.back().lastPrice, sizeof(price));
+    return true;
+}
+
+bool PriceHistory::priceAsOf(SeriesId id, std::int64_t time, float& price) const {
+    Cursor cursor(*this, id);
+    return cursor.advanceAsOf(time, price);
+}
+
+bool PriceHistory::timeRange(SeriesId id, std::int64_t& first, std::int64_t& last) const {
+    const auto& chunks = data[id].chunks;
+    if (chunks.empty()) return false;
+    first = chunks.front().firstTime;
+    last = chunks.back().lastTime;
+    return true;
+}
+
+size_t PriceHistory::readRange(SeriesId id, std::int64_t from, std::int64_t to,
+    std::vector<std::int64_t>& times, std::vector<float>& prices) const {
+    size_t before = times.size();
+    Cursor cursor(*this, id);
+    for (cursor.seek(from); cursor.valid() && cursor.time() <= to; cursor.next()) {
+        times.push_back(cursor.time());
+        prices.push_back(cursor.price());
+    }
+    return times.size() - before;
+}
+
+size_t PriceHistory::memoryUsage() const {
+    size_t bytes = names.memoryUsage() + data.capacity() * sizeof(Series);
+    for (const auto& series : data) {
+        bytes += series.chunks.capacity() * sizeof(Chunk);
+        for (const auto& chunk : series.chunks) bytes += chunk.times.bytes() + chunk.prices.bytes();
+    }
+    return bytes;
+}
+
+void PriceHistory::clear() {
+    names.clear();
+    data.clear();
+    points = 0;
+}
+
+void PriceHistory::resetSeries(SeriesId id) {
+    points -= pointCount(id);
+    data[id] = Series();
+}
+
+size_t PriceHistory::applyCorporateActions(const CorporateActionBatch& batch) {
+    const SymbolTable& events = batch.getSymbols();
+    std::vector<std::int64_t> times, otherTimes;
+    std::vector<float> prices, otherPrices;
+    size_t rewritten = 0;
+    // Блоки сжаты последовательно, поэтому изменённый ряд распаковывается и записывается заново
+    for (const auto& action : batch.getActions()) {
+        if (action.type == CorporateActionType::CashDividend) continue;
+        SeriesId id = findSeries(events.name(action.symbol));
+        if (id == kInvalidSymbol || data[id].chunks.empty()) continue;
+        times.clear();
+        prices.clear();
+        readRange(id, LLONG_MIN, LLONG_MAX, times, prices);
+        resetSeries(id);
+
+        if (action.type == CorporateActionType::SymbolChange) {
+            // Слияние с уже записанными точками нового тикера по времени
+            SeriesId target = series(events.name(action.newSymbol));
+            otherTimes.clear();
+            otherPrices.clear();
+            readRange(target, LLONG_MIN, LLONG_MAX, otherTimes, otherPrices);
+            resetSeries(target);
+            size_t a = 0, b = 0;
+            while (a < times.size() || b < otherTimes.size()) {
+                bool takeOld = b == otherTimes.size() || (a < times.size() && times[a] <= otherTimes[b]);
+                if (takeOld) { append(target, times[a], prices[a]); ++a; }
+                else { append(target, otherTimes[b], otherPrices[b]); ++b; }
+            }
+        }
+        else {
+            // Цены до даты отсечки приводятся к количеству бумаг после сплита
+            const double ratio = action.type == CorporateActionType::Split ? action.value : 1.0 + action.value;
+            for (size_t k = 0; k < times.size(); ++k) {
+                float price = times[k] < action.time ? static_cast<float>(prices[k] / ratio) : prices[k];
+                append(id, times[k], price);
+            }
+        }
+        ++rewritten;
+    }
+    return rewritten;
+}
+
+PriceHistory::Cursor::Cursor(const PriceHistory& history, SeriesId id) : series(&history.data[id]) {
+    if (!series->chunks.empty()) enterChunk(0);
+}
+
+void PriceHistory::Cursor::enterChunk(size_t index) {
+    chunkIndex = index;
+    chunk = &series->chunks[index];
+    point = 0;
+    timeBit = 0;
+    priceBit = 0;
+    currentTime = chunk->firstTime;
+    delta = 0;
+    priceBits = chunk->firstPrice;
+    if (chunk->decimal) toCents(price(), cents);
+    asOfBits = priceBits;
+    decoded = true;
+}
+
+bool PriceHistory::Cursor::advanceAsOf(std::int64_t time, float& result) {
+    const auto& chunks = series->chunks;
+    if (chunks.empty() || chunks.front().firstTime > time) return false;
+
+    // Последний блок, начавшийся не позже time; обычно это текущий или следующий
+    size_t target = chunkIndex;
+    if (target + 1 < chunks.size() && chunks[target + 1].firstTime <= time) {
+        auto after = std::upper_bound(chunks.begin() + static_cast<std::ptrdiff_t>(target + 1), chunks.end(), time,
+            [](std::int64_t t, const Chunk& c) { return t < c.firstTime; });
+        target = static_cast<size_t>(after - chunks.begin()) - 1;
+    }
+    const Chunk& found = chunks[target];
+    if (found.lastTime <= time) {
+        chunkIndex = target;
+        chunk = &found;
+        decoded = false;
+        std::memcpy(&result, &found.lastPrice, sizeof(result));
+        return true;
+    }
+
+    if (!decoded || target != chunkIndex) enterChunk(target);
+    // Курсор останавливается на первой точке позже time (она есть: lastTime > time),
+    // а ответ — цена предыдущей точки
+    while (currentTime <= time) {
+        asOfBits = priceBits;
+        next();
+    }
+    std::memcpy(&result, &asOfBits, sizeof(result));
+    return true;
+}
+
+void PriceHistory::Cursor::seek(std::int64_t time) {
+    const auto& chunks = series->chunks;
+    auto found = std::partition_point(chunks.begin(), chunks.end(),
+        [&](const Chunk& c) { return c.lastTime < time; });
+    if (found == chunks.end()) {
+        chunk = nullptr;
+        return;
+    }
+    enterChunk(static_cast<size_t>(found - chunks.begin()));
+    while (chunk && currentTime < time) next();
+}
+
+float PriceHistory::Cursor::price() const {
+    float value;
+    std::memcpy(&value, &priceBits, sizeof(value));
+    return value;
+}
+
+void PriceHistory::Cursor::next() {
+    if (++point >= chunk->count) {
+        if (chunkIndex + 1 < series->chunks.size()) enterChunk(chunkIndex + 1);
+        else chunk = nullptr;
+        return;
+    }
+
+    delta += readDelta(chunk->times.data(), timeBit, kTimeBuckets, kRawTimeBits);
+    currentTime += delta;
+
+    const std::uint64_t* words = chunk->prices.data();
+    if (chunk->decimal) {
+        cents += readDelta(words, priceBit, kCentBuckets, kRawCentBits);
+        priceBits = floatBits(centsToFloat(cents));
+    }
+    else if (readBits(words, priceBit, 1)) {
+        if (readBits(words, priceBit, 1)) {
+            leading = static_cast<unsigned>(readBits(words, priceBit, 5));
+            unsigned length = static_cast<unsigned>(readBits(words, priceBit, 5)) + 1;
+            trailing = 32 - leading - length;
+        }
+        priceBits ^= static_cast<std::uint32_t>(readBits(words, priceBit, 32 - leading - trailing)) << trailing;
+    }
+}
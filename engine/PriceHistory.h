@@ -0,0 +1,138 @@
+#pragma once
+
+#include "CorporateActions.h"
+#include "SymbolTable.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// История цен по символам. Каждый ряд делится на блоки по kChunkPoints точек;
+// в блоке время и цена лежат отдельными колонками-битовыми потоками:
+//   время — дельта от дельты (равномерный шаг стоит 1 бит на точку),
+//   цена — если она точно выражается в сотых (котировки с шагом в копейку), дельта целых сотых
+//   (неизменная цена — 1 бит, сдвиг на несколько копеек — 6-10 бит); иначе XOR с предыдущим
+//   значением float, как в Gorilla. Режим выбирается по первой цене блока; цена, не подходящая
+//   режиму, закрывает блок досрочно.
+// Добавление пишет только в хвост открытого блока. Заголовки блоков хранят первое и последнее
+// время, поэтому выборка диапазона находит первый нужный блок двоичным поиском
+// и распаковывает только пересекающиеся блоки.
+class PriceHistory {
+public:
+    using SeriesId = std::uint32_t;
+    static constexpr std::uint32_t kChunkPoints = 1024;
+
+    // Ряд по имени символа; создаётся при первом обращении
+    SeriesId series(std::string_view name);
+    SeriesId findSeries(std::string_view name) const { return names.find(name); }
+    std::string_view name(SeriesId id) const { return names.name(id); }
+    size_t seriesCount() const { return data.size(); }
+
+    // Время в миллисекундах. false, если точка раньше последней точки ряда
+    bool append(SeriesId id, std::int64_t time, float price);
+
+    size_t pointCount(SeriesId id) const;
+    size_t totalPoints() const { return points; }
+    bool lastPoint(SeriesId id, std::int64_t& time, float& price) const;
+    bool timeRange(SeriesId id, std::int64_t& first, std::int64_t& last) const;
+    // Цена последней точки не позже time; false, если ряд начинается позже
+    bool priceAsOf(SeriesId id, std::int64_t time, float& price) const;
+
+    // Точки с временем в [from, to] дописываются в колонки times/prices; возвращает их число
+    size_t readRange(SeriesId id, std::int64_t from, std::int64_t to,
+        std::vector<std::int64_t>& times, std::vector<float>& prices) const;
+
+    // Байты под сжатые колонки, заголовки блоков и имена
+    size_t memoryUsage() const;
+    void clear();
+
+    // Сплит и дивиденд акциями делят цены до даты отсечки на коэффициент, чтобы ряд
+    // был сопоставим с ценами после события; смена тикера переносит точки в ряд нового тикера
+    // (старый остаётся пустым). Денежные дивиденды ряд не меняют. Возвращает число перезаписей
+    size_t applyCorporateActions(const CorporateActionBatch& batch);
+
+private:
+    class BitStream {
+    public:
+        void write(std::uint64_t value, unsigned count);
+        void reserve(size_t bits) { words.reserve((bits + 63) / 64); }
+        void shrink() { words.shrink_to_fit(); }
+        size_t size() const { return bitCount; }
+        size_t bytes() const { return words.capacity() * sizeof(std::uint64_t); }
+        const std::uint64_t* data() const { return words.data(); }
+
+    private:
+        std::vector<std::uint64_t> words;
+        size_t bitCount = 0;
+    };
+
+    struct Chunk {
+        std::int64_t firstTime = 0;
+        std::int64_t lastTime = 0;
+        std::uint32_t firstPrice = 0; // биты float
+        std::uint32_t lastPrice = 0;
+        std::uint32_t count = 0;
+        bool decimal = false; // цены в сотых
+        BitStream times;
+        BitStream prices;
+    };
+
+    // Состояние кодировщика открытого (последнего) блока
+    struct Encoder {
+        std::int64_t lastDelta = 0;
+        std::int64_t lastCents = 0;
+        std::uint32_t lastPrice = 0;
+        std::uint8_t leading = 0;
+        std::uint8_t trailing = 0;
+        bool hasWindow = false;
+    };
+
+    struct Series {
+        std::vector<Chunk> chunks;
+        Encoder encoder;
+    };
+
+    void resetSeries(SeriesId id);
+
+public:
+    // Последовательное чтение ряда: текущая точка распакована, next переходит к следующей
+    class Cursor {
+    public:
+        Cursor(const PriceHistory& history, SeriesId id);
+
+        // Встаёт на первую точку со временем >= time
+        void seek(std::int64_t time);
+        bool valid() const { return chunk != nullptr; }
+        std::int64_t time() const { return currentTime; }
+        float price() const;
+        void next();
+
+        // Для неубывающих time: цена последней точки не позже time, false — если такой нет.
+        // Блок, целиком лежащий до time, отвечает по заголовку без распаковки; внутри блока
+        // курсор только продвигается вперёд. Не смешивается с seek/next
+        bool advanceAsOf(std::int64_t time, float& price);
+
+    private:
+        void enterChunk(size_t index);
+
+        const Series* series = nullptr;
+        const Chunk* chunk = nullptr;
+        size_t chunkIndex = 0;
+        std::uint32_t point = 0;
+        size_t timeBit = 0;
+        size_t priceBit = 0;
+        std::int64_t currentTime = 0;
+        std::int64_t delta = 0;
+        std::uint32_t priceBits = 0;
+        std::int64_t cents = 0;
+        unsigned leading = 0;
+        unsigned trailing = 0;
+        std::uint32_t asOfBits = 0; // цена последней точки не позже запрошенного времени
+        bool decoded = false;       // состояние распаковки соответствует chunkIndex
+    };
+
+private:
+    SymbolTable names;
+    std::vector<Series> data;
+    size_t points = 0;
+};
@@ -0,0 +1,230 @@
+#include "ProfitLoss.h"
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+namespace {
+
+std::int64_t splitQuantity(std::int64_t quantity, double ratio) {
+    double exact = std::floor(std::fabs(static_cast<double>(quantity)) * ratio + 1e-9);
+    return quantity < 0 ? -static_cast<std::int64_t>(exact) : static_cast<std::int64_t>(exact);
+}
+
+} // namespace
+
+void ProfitLoss::sync(const Ledger& ledger, const Portfolio& portfolio) {
+    if (ledger.size() < processed) clear();
+    const SymbolTable& names = portfolio.getSymbols();
+    const SymbolTable& journaled = ledger.getSymbols();
+    // Сопоставление символов дополняется только новыми именами с обеих сторон
+    while (fromPortfolio.size() < names.size()) {
+        fromPortfolio.push_back(journaled.find(names.name(static_cast<SymbolId>(fromPortfolio.size()))));
+    }
+    for (; mappedLedgerSymbols < journaled.size(); ++mappedLedgerSymbols) {
+        SymbolId local = names.find(journaled.name(static_cast<SymbolId>(mappedLedgerSymbols)));
+        if (local != kInvalidSymbol) fromPortfolio[local] = static_cast<SymbolId>(mappedLedgerSymbols);
+    }
+    if (processed == ledger.size()) return;
+
+    if (positions.size() < journaled.size()) {
+        positions.resize(journaled.size());
+        queues.resize(journaled.size());
+    }
+    if (totals.size() < ledger.getCurrencies().size()) totals.resize(ledger.getCurrencies().size());
+    for (; processed < ledger.size(); ++processed) apply(ledger.entry(processed));
+
+    // Сделки проходят по цене портфеля, но лоты при заполнении журнала — по цене покупки
+    for (const auto& asset : portfolio.getAssets()) setPrice(asset.symbol, asset.price);
+}
+
+void ProfitLoss::setPrice(SymbolId portfolioSymbol, double price) {
+    if (portfolioSymbol >= fromPortfolio.size()) return;
+    SymbolId symbol = fromPortfolio[portfolioSymbol];
+    if (symbol >= positions.size() || positions[symbol].price == price) return;
+    updatePrice(symbol, price);
+}
+
+void ProfitLoss::clear() {
+    positions.clear();
+    queues.clear();
+    totals.clear();
+    fromPortfolio.clear();
+    mappedLedgerSymbols = 0;
+    processed = 0;
+}
+
+const PositionPnl* ProfitLoss::find(SymbolId portfolioSymbol) const {
+    if (portfolioSymbol >= fromPortfolio.size()) return nullptr;
+    SymbolId symbol = fromPortfolio[portfolioSymbol];
+    return symbol < positions.size() ? &positions[symbol] : nullptr;
+}
+
+void ProfitLoss::apply(const LedgerEntry& entry) {
+    switch (entry.type) {
+    case LedgerEntryType::Trade:
+        removeShare(entry.symbol);
+        positions[entry.symbol].currency = entry.currency;
+        trade(entry.symbol, entry.quantity, entry.value);
+        addShare(entry.symbol);
+        break;
+    case LedgerEntryType::Cash:
+        if (entry.symbol == kInvalidSymbol) break; // пополнения и выводы — не доход
+        removeShare(entry.symbol);
+        positions[entry.symbol].income += entry.value;
+        addShare(entry.symbol);
+        break;
+    case LedgerEntryType::Split:
+        removeShare(entry.symbol);
+        split(entry.symbol, entry.value);
+        addShare(entry.symbol);
+        break;
+    case LedgerEntryType::Rename:
+        removeShare(entry.symbol);
+        removeShare(entry.newSymbol);
+        rename(entry.symbol, entry.newSymbol);
+        addShare(entry.newSymbol);
+        break;
+    case LedgerEntryType::Adjustment:
+        if (entry.symbol == kInvalidSymbol) break; // правка денег
+        removeShare(entry.symbol);
+        positions[entry.symbol].currency = entry.currency;
+        trade(entry.symbol, entry.quantity, entry.value, false);
+        addShare(entry.symbol);
+        break;
+    }
+}
+
+void ProfitLoss::trade(SymbolId symbol, std::int64_t quantity, double price, bool realize) {
+    PositionPnl& position = positions[symbol];
+    LotQueue& queue = queues[symbol];
+    position.price = price;
+    std::int64_t remaining = quantity;
+    if (position.quantity != 0 && (position.quantity > 0) != (quantity > 0)) {
+        // Закрытие: closed — часть позиции со знаком позиции
+        const std::int64_t closed = position.quantity > 0
+            ? std::min(position.quantity, -quantity) : std::max(position.quantity, -quantity);
+        const double averagePrice = position.averageCost / static_cast<double>(position.quantity);
+        if (realize) position.realizedAverage += static_cast<double>(closed) * (price - averagePrice);
+        position.averageCost -= static_cast<double>(closed) * averagePrice;
+
+        std::int64_t left = closed;
+        while (left != 0 && queue.head < queue.lots.size()) {
+            FifoLot& lot = queue.lots[queue.head];
+            const std::int64_t taken = left > 0 ? std::min(left, lot.quantity) : std::max(left, lot.quantity);
+            const double cost = lot.cost * static_cast<double>(taken) / static_cast<double>(lot.quantity);
+            if (realize) position.realizedFifo += static_cast<double>(taken) * price - cost;
+            position.fifoCost -= cost;
+            lot.quantity -= taken;
+            lot.cost -= cost;
+            left -= taken;
+            if (lot.quantity == 0) ++queue.head;
+        }
+        position.quantity -= closed;
+        remaining += closed;
+        if (position.quantity == 0) {
+            // Остатки округления не переживают закрытие позиции
+            position.averageCost = 0.0;
+            position.fifoCost = 0.0;
+            queue.lots.clear();
+            queue.head = 0;
+        }
+    }
+    if (remaining != 0) {
+        const double cost = static_cast<double>(remaining) * price;
+        position.quantity += remaining;
+        position.averageCost += cost;
+        position.fifoCost += cost;
+        queue.lots.push_back({ remaining, cost });
+    }
+    // Закрытые лоты сдвигаются, когда их набралась половина очереди
+    if (queue.head > 32 && queue.head * 2 > queue.lots.size()) {
+        queue.lots.erase(queue.lots.begin(), queue.lots.begin() + static_cast<std::ptrdiff_t>(queue.head));
+        queue.head = 0;
+    }
+}
+
+void ProfitLoss::split(SymbolId symbol, double ratio) {
+    PositionPnl& position = positions[symbol];
+    LotQueue& queue = queues[symbol];
+    const std::int64_t after = splitQuantity(position.quantity, ratio);
+    position.price /= ratio;
+    std::int64_t lotsAfter = 0;
+    for (size_t k = queue.head; k < queue.lots.size(); ++k) {
+        queue.lots[k].quantity = splitQuantity(queue.lots[k].quantity, ratio);
+        lotsAfter += queue.lots[k].quantity;
+    }
+    // Как и в портфеле, потеря округления по лотам уходит в самый старый лот
+    if (queue.head < queue.lots.size()) queue.lots[queue.head].quantity += after - lotsAfter;
+    // Лот, округлившийся до нуля, отдаёт стоимость самому старому
+    for (size_t k = queue.lots.size(); k-- > queue.head + 1;) {
+        if (queue.lots[k].quantity != 0) continue;
+        queue.lots[queue.head].cost += queue.lots[k].cost;
+        queue.lots.erase(queue.lots.begin() + static_cast<std::ptrdiff_t>(k));
+    }
+    position.quantity = after;
+    if (after == 0) {
+        position.averageCost = 0.0;
+        position.fifoCost = 0.0;
+        queue.lots.clear();
+        queue.head = 0;
+    }
+}
+
+void ProfitLoss::rename(SymbolId from, SymbolId to) {
+    PositionPnl moved = positions[from];
+    PositionPnl& target = positions[to];
+    target.quantity += moved.quantity;
+    target.averageCost += moved.averageCost;
+    target.fifoCost += moved.fifoCost;
+    target.realizedAverage += moved.realizedAverage;
+    target.realizedFifo += moved.realizedFifo;
+    target.income += moved.income;
+    target.price = moved.price;
+    target.currency = moved.currency;
+    positions[from] = PositionPnl();
+    LotQueue& source = queues[from];
+    LotQueue& destination = queues[to];
+    destination.lots.insert(destination.lots.end(),
+        source.lots.begin() + static_cast<std::ptrdiff_t>(source.head), source.lots.end());
+    source = LotQueue();
+}
+
+void ProfitLoss::updatePrice(SymbolId symbol, double price) {
+    PositionPnl& position = positions[symbol];
+    if (position.currency >= totals.size()) {
+        position.price = price;
+        return;
+    }
+    PnlTotals& total = totals[position.currency];
+    const double quantity = static_cast<double>(position.quantity);
+    // Оба метода меняются на одно и то же: изменение рыночной стоимости
+    const double delta = quantity * price - quantity * position.price;
+    total.unrealizedAverage += delta;
+    total.unrealizedFifo += delta;
+    position.price = price;
+}
+
+void ProfitLoss::removeShare(SymbolId symbol) {
+    const PositionPnl& position = positions[symbol];
+    if (position.currency >= totals.size()) return;
+    PnlTotals& total = totals[position.currency];
+    total.realizedAverage -= position.realizedAverage;
+    total.realizedFifo -= position.realizedFifo;
+    total.unrealizedAverage -= position.unrealizedAverage();
+    total.unrealizedFifo -= position.unrealizedFifo();
+    total.income -= position.income;
+}
+
+void ProfitLoss::addShare(SymbolId symbol) {
+    const PositionPnl& position = positions[symbol];
+    if (position.currency >= totals.size()) return;
+    PnlTotals& total = totals[position.currency];
+    total.realizedAverage += position.realizedAverage;
+    total.realizedFifo += position.realizedFifo;
+    total.unrealizedAverage += position.unrealizedAverage();
+    total.unrealizedFifo += position.unrealizedFifo();
+    total.income += position.income;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Ledger.h"
+#include "SymbolTable.h"
+
+#include <cstdint>
+#include <vector>
+
+class Portfolio;
+
+// Результат по символу журнала, в валюте позиции, сразу двумя методами учёта:
+// по средней цене и по лотам FIFO
+struct PositionPnl {
+    std::int64_t quantity = 0;
+    double averageCost = 0.0; // стоимость покупки позиции по средней цене
+    double fifoCost = 0.0;    // стоимость покупки оставшихся лотов
+    double realizedAverage = 0.0;
+    double realizedFifo = 0.0;
+    double income = 0.0; // денежные дивиденды
+    double price = 0.0;  // последняя цена: тик или сделка
+    CurrencyId currency = kBaseCurrency; // валюта журнала
+
+    double marketValue() const { return static_cast<double>(quantity) * price; }
+    double unrealizedAverage() const { return marketValue() - averageCost; }
+    double unrealizedFifo() const { return marketValue() - fifoCost; }
+};
+
+struct PnlTotals {
+    double realizedAverage = 0.0;
+    double realizedFifo = 0.0;
+    double unrealizedAverage = 0.0;
+    double unrealizedFifo = 0.0;
+    double income = 0.0;
+};
+
+// Прибыль и убыток поверх журнала, без пересчёта с нуля: каждая новая запись журнала меняет
+// только свой символ (реализованный результат — на сделках, корректировки его не дают), тик
+// цены — только нереализованный результат своего символа. Итоги по валютам поддерживаются
+// приращениями, так что кадр стоит O(изменённых символов), а не O(всех позиций)
+class ProfitLoss {
+public:
+    // Дочитывает новые записи журнала: O(новых записей). Если они были, позиции переоцениваются
+    // по ценам портфеля. Журнал, ставший короче (очищен), обрабатывается заново
+    void sync(const Ledger& ledger, const Portfolio& portfolio);
+    // Тик по символу портфеля: O(1); символы без записей в журнале пропускаются
+    void setPrice(SymbolId portfolioSymbol, double price);
+    void clear();
+
+    // nullptr, если по символу портфеля в журнале ничего нет
+    const PositionPnl* find(SymbolId portfolioSymbol) const;
+    // По валюте журнала
+    const std::vector<PnlTotals>& getTotals() const { return totals; }
+    size_t getProcessed() const { return processed; }
+
+private:
+    // Лот FIFO: количество со знаком позиции и его стоимость покупки
+    struct FifoLot {
+        std::int64_t quantity;
+        double cost;
+    };
+
+    struct LotQueue {
+        std::vector<FifoLot> lots;
+        size_t head = 0; // закрытые лоты в начале не удаляются по одному
+    };
+
+    void apply(const LedgerEntry& entry);
+    // Корректировка журнала (realize = false) закрывает бумаги по их стоимости покупки, без результата
+    void trade(SymbolId symbol, std::int64_t quantity, double price, bool realize = true);
+    void split(SymbolId symbol, double ratio);
+    void rename(SymbolId from, SymbolId to);
+    void updatePrice(SymbolId symbol, double price);
+    // Вычитает из итогов вклад символа; addShare возвращает его после изменения
+    void removeShare(SymbolId symbol);
+    void addShare(SymbolId symbol);
+
+    std::vector<PositionPnl> positions; // по символу журнала
+    std::vector<LotQueue> queues;
+    std::vector<PnlTotals> totals;
+    std::vector<SymbolId> fromPortfolio; // символ журнала по символу портфеля
+    size_t mappedLedgerSymbols = 0;
+    size_t processed = 0;
+};
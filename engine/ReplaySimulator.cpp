@@ -0,0 +1,109 @@
+#include "ReplaySimulator.h"
+#include "Bits.h"
+#include "TickConflator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t steadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// Значения меньше 8 лежат в своих корзинах точно, дальше октава делится на 8 частей
+size_t LatencyHistogram::bucketOf(std::uint64_t value) {
+    if (value < (1u << kSubBits)) return static_cast<size_t>(value);
+    unsigned msb = highestBit(value);
+    unsigned shift = msb - kSubBits;
+    size_t sub = static_cast<size_t>(value >> shift) & ((1u << kSubBits) - 1);
+    return (static_cast<size_t>(shift + 1) << kSubBits) + sub;
+}
+
+std::uint64_t LatencyHistogram::bucketUpper(size_t bucket) {
+    if (bucket < (1u << kSubBits)) return bucket;
+    unsigned shift = static_cast<unsigned>(bucket >> kSubBits) - 1;
+    std::uint64_t sub = bucket & ((1u << kSubBits) - 1);
+    std::uint64_t lower = ((std::uint64_t(1) << kSubBits) + sub) << shift;
+    return lower + ((std::uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(std::uint64_t nanoseconds) {
+    ++buckets[bucketOf(nanoseconds)];
+    ++count;
+    sum += nanoseconds;
+    maxValue = std::max(maxValue, nanoseconds);
+}
+
+void LatencyHistogram::clear() {
+    buckets.fill(0);
+    count = sum = maxValue = 0;
+}
+
+std::uint64_t LatencyHistogram::percentile(double p) const {
+    if (count == 0) return 0;
+    std::uint64_t rank = static_cast<std::uint64_t>(std::clamp(p, 0.0, 100.0) / 100.0 * (count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(bucketUpper(b), maxValue);
+    }
+    return maxValue;
+}
+
+ReplayReport replayIntoPortfolio(PriceFeed& feed, Portfolio& portfolio, const ReplayOptions& options) {
+    ReplayReport report;
+    TickConflator conflator;
+    std::vector<std::int64_t> published;
+    std::vector<PriceHistory::SeriesId> historySeries;
+    if (options.history) {
+        const SymbolTable& symbols = portfolio.getSymbols();
+        historySeries.resize(symbols.size());
+        for (SymbolId id = 0; id < symbols.size(); ++id) historySeries[id] = options.history->series(symbols.name(id));
+    }
+    const auto frame = std::chrono::duration<double, std::milli>(options.frameMs);
+
+    auto start = Clock::now();
+    auto nextFrame = start;
+    feed.start(options.speed);
+    for (;;) {
+        // Флаг читается до вычитывания: тики, отправленные перед остановкой, ещё попадут в этот проход
+        bool running = feed.isRunning();
+        size_t ticks = feed.drain(conflator);
+        published.clear();
+        size_t applied = conflator.consume([&](const PriceTick& tick) {
+            portfolio.setSymbolPrice(tick.symbol, tick.price);
+            if (options.history && !options.history->append(historySeries[tick.symbol], tick.timestamp, tick.price)) {
+                ++report.historyRejected;
+            }
+            published.push_back(tick.publishedAt);
+        });
+        if (applied > 0) {
+            std::int64_t revalued = steadyNanoseconds();
+            for (std::int64_t sent : published) {
+                report.latency.record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, revalued - sent)));
+            }
+        }
+        report.ticks += ticks;
+        report.revaluations += applied;
+        ++report.frames;
+        if (!running && ticks == 0) break;
+
+        if (options.frameMs > 0.0) {
+            nextFrame += std::chrono::duration_cast<Clock::duration>(frame);
+            std::this_thread::sleep_until(nextFrame);
+        }
+        else if (ticks == 0) {
+            std::this_thread::yield();
+        }
+    }
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    feed.stop();
+    return report;
+}
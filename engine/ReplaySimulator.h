@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Portfolio.h"
+#include "PriceFeed.h"
+#include "PriceHistory.h"
+
+#include <array>
+#include <cstdint>
+
+// Гистограмма задержек с логарифмическими корзинами: 8 корзин на каждую степень двойки,
+// поэтому относительная погрешность перцентиля не больше 12.5% при любом разбросе значений.
+// Запись — несколько битовых операций без выделения памяти.
+class LatencyHistogram {
+public:
+    void record(std::uint64_t nanoseconds);
+    void clear();
+
+    std::uint64_t getCount() const { return count; }
+    std::uint64_t getMax() const { return maxValue; }
+    double getMean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    // Верхняя граница корзины, в которую попадает перцентиль p из [0, 100]
+    std::uint64_t percentile(double p) const;
+
+private:
+    static constexpr int kSubBits = 3;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+    static size_t bucketOf(std::uint64_t value);
+    static std::uint64_t bucketUpper(size_t bucket);
+
+    std::array<std::uint64_t, kBuckets> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t maxValue = 0;
+};
+
+struct ReplayOptions {
+    double speed = 0.0;   // как в PriceFeed::start: 0 — без пауз
+    double frameMs = 0.0; // период применения тиков, как у кадров окна; 0 — сразу по приходу
+    PriceHistory* history = nullptr; // если задана, применённые цены записываются в историю
+};
+
+struct ReplayReport {
+    size_t ticks = 0;        // прочитано из кольца
+    size_t revaluations = 0; // применено цен после схлопывания
+    size_t frames = 0;
+    double seconds = 0.0;
+    size_t historyRejected = 0; // точки раньше последней точки ряда
+    LatencyHistogram latency; // от отправки тика до завершения переоценки портфеля
+};
+
+// Проигрывает источник в портфель в текущем потоке, повторяя цикл окна:
+// вычитать кольцо, схлопнуть, переоценить. Источник должен быть привязан к портфелю (bind)
+ReplayReport replayIntoPortfolio(PriceFeed& feed, Portfolio& portfolio, const ReplayOptions& options);
@@ -0,0 +1,40 @@
+#include "Returns.h"
+
+#include <algorithm>
+#include <cmath>
+
+void sampleReturns(const PriceHistory& history, const std::vector<PriceHistory::SeriesId>& series,
+    std::int64_t from, std::int64_t to, std::int64_t barMs, ReturnMatrix& out) {
+    out.columns = series.size();
+    out.bars = barMs > 0 && to > from ? static_cast<size_t>((to - from) / barMs) : 0;
+    out.values.assign(out.bars * out.columns, 0.0f);
+    for (size_t c = 0; c < series.size(); ++c) {
+        if (series[c] == kInvalidSymbol) continue;
+        PriceHistory::Cursor cursor(history, series[c]);
+        float previous = 0.0f;
+        float price;
+        bool started = cursor.advanceAsOf(from, price);
+        if (started) previous = price;
+        for (size_t k = 0; k < out.bars; ++k) {
+            if (!cursor.advanceAsOf(from + static_cast<std::int64_t>(k + 1) * barMs, price)) continue;
+            if (started && previous > 0.0f && price > 0.0f) {
+                out.values[k * out.columns + c] = std::log(price / previous);
+            }
+            previous = price;
+            started = true;
+        }
+    }
+}
+
+bool historySpan(const PriceHistory& history, const std::vector<PriceHistory::SeriesId>& series,
+    std::int64_t& first, std::int64_t& last) {
+    bool found = false;
+    for (PriceHistory::SeriesId id : series) {
+        std::int64_t seriesFirst, seriesLast;
+        if (id == kInvalidSymbol || !history.timeRange(id, seriesFirst, seriesLast)) continue;
+        first = found ? std::min(first, seriesFirst) : seriesFirst;
+        last = found ? std::max(last, seriesLast) : seriesLast;
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "PriceHistory.h"
+
+#include <cstdint>
+#include <vector>
+
+// Логарифмические доходности рядов на равномерной сетке баров: строка — бар, столбец — ряд
+struct ReturnMatrix {
+    size_t bars = 0;
+    size_t columns = 0;
+    std::vector<float> values; // bars × columns по строкам
+
+    const float* row(size_t bar) const { return values.data() + bar * columns; }
+    float at(size_t bar, size_t column) const { return values[bar * columns + column]; }
+};
+
+// Цена ряда на конце бара — последняя точка не позже from + (k + 1) * barMs, доходность бара —
+// ln(p[k] / p[k - 1]); бар 0 сравнивается с ценой на момент from. Пока ряд не начался
+// (и для kInvalidSymbol), доходность 0. Каждый ряд проходится одним курсором без поиска
+void sampleReturns(const PriceHistory& history, const std::vector<PriceHistory::SeriesId>& series,
+    std::int64_t from, std::int64_t to, std::int64_t barMs, ReturnMatrix& out);
+
+// Общий интервал рядов в истории: от самой ранней до самой поздней точки; false, если точек нет
+bool historySpan(const PriceHistory& history, const std::vector<PriceHistory::SeriesId>& series,
+    std::int64_t& first, std::int64_t& last);
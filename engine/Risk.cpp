@@ -0,0 +1,250 @@
+#include "Risk.h"
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Сторона плитки: плитка сумм в double — 32 КБ, она остаётся в L1 на всём проходе по барам
+constexpr size_t kTile = 64;
+// Бары упаковываются пачками: две панели kChunk × kTile в double — по 128 КБ
+constexpr size_t kChunk = 256;
+
+// Плитка [rowBegin, +rows) × [columnBegin, +columns) суммы scale_t · x_t x_t^T. Строки плитки
+// и столбцы пачки баров копируются в плотные панели (недостающие до kTile — нулями), затем
+// блок 4×4 сумм копится в регистрах по всей пачке: на одно умножение приходится одна загрузка
+// панели вместо чтения и записи плитки, как было бы в axpy по строкам
+void accumulateTile(const ReturnMatrix& returns, const std::vector<double>& scale, size_t rowBegin, size_t rows,
+    size_t columnBegin, size_t columns, double* sums, double* rowPanel, double* columnPanel) {
+    std::fill(sums, sums + kTile * kTile, 0.0);
+    for (size_t first = 0; first < returns.bars; first += kChunk) {
+        const size_t count = std::min(kChunk, returns.bars - first);
+        for (size_t t = 0; t < count; ++t) {
+            const float* row = returns.row(first + t);
+            double* packedRow = rowPanel + t * kTile;
+            double* packedColumn = columnPanel + t * kTile;
+            std::fill(packedRow + rows, packedRow + kTile, 0.0);
+            std::fill(packedColumn + columns, packedColumn + kTile, 0.0);
+            for (size_t i = 0; i < rows; ++i) packedRow[i] = scale[first + t] * row[rowBegin + i];
+            for (size_t j = 0; j < columns; ++j) packedColumn[j] = row[columnBegin + j];
+        }
+        for (size_t i = 0; i < kTile; i += 4) {
+            for (size_t j = 0; j < kTile; j += 4) {
+                double block[4][4] = {};
+                for (size_t t = 0; t < count; ++t) {
+                    const double* a = rowPanel + t * kTile + i;
+                    const double* b = columnPanel + t * kTile + j;
+                    for (int r = 0; r < 4; ++r) {
+                        for (int q = 0; q < 4; ++q) block[r][q] += a[r] * b[q];
+                    }
+                }
+                for (int r = 0; r < 4; ++r) {
+                    for (int q = 0; q < 4; ++q) sums[(i + r) * kTile + j + q] += block[r][q];
+                }
+            }
+        }
+    }
+}
+
+// Скалярное произведение с четырьмя независимыми суммами
+double dot(const double* a, const double* b, size_t count) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        s0 += a[k] * b[k];
+        s1 += a[k + 1] * b[k + 1];
+        s2 += a[k + 2] * b[k + 2];
+        s3 += a[k + 3] * b[k + 3];
+    }
+    for (; k < count; ++k) s0 += a[k] * b[k];
+    return (s0 + s1) + (s2 + s3);
+}
+
+} // namespace
+
+void RiskModel::estimate(const ReturnMatrix& returns, const RiskSettings& source, ThreadPool& pool) {
+    clear();
+    settings = source;
+    assets = returns.columns;
+    bars = returns.bars;
+    const size_t n = assets;
+    matrix.assign(n * n, 0.0);
+    expected.assign(n, 0.0);
+    if (n == 0 || bars == 0) return;
+
+    // Нормированные веса баров: для EWMA самый свежий бар весит 1 - λ, каждый предыдущий — в λ раз меньше
+    std::vector<double> scale(bars);
+    if (settings.method == CovarianceMethod::Sample) {
+        std::fill(scale.begin(), scale.end(), 1.0 / static_cast<double>(bars));
+        weightSum = 1.0;
+        weightSquares = 1.0 / static_cast<double>(bars);
+    } else {
+        double weight = 1.0 - settings.decay;
+        for (size_t t = bars; t-- > 0;) {
+            scale[t] = weight;
+            weightSum += weight;
+            weightSquares += weight * weight;
+            weight *= settings.decay;
+        }
+        for (double& s : scale) s /= weightSum;
+    }
+
+    for (size_t t = 0; t < bars; ++t) {
+        const float* row = returns.row(t);
+        for (size_t i = 0; i < n; ++i) expected[i] += row[i];
+    }
+    for (double& mean : expected) mean /= static_cast<double>(bars);
+    // EWMA считается с нулевым средним
+    std::vector<double> means = settings.method == CovarianceMethod::Sample ? expected : std::vector<double>(n, 0.0);
+
+    // Плитки над диагональю и на ней; нижняя половина заполняется отражением
+    const size_t tiles = (n + kTile - 1) / kTile;
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for (size_t I = 0; I < tiles; ++I) {
+        for (size_t J = I; J < tiles; ++J) pairs.emplace_back(I, J);
+    }
+    std::vector<std::vector<double>> buffers(pool.size());
+    pool.parallelFor(pairs.size(), 1, [&](size_t begin, size_t end, size_t slot) {
+        std::vector<double>& buffer = buffers[slot];
+        buffer.resize(kTile * kTile + 2 * kChunk * kTile);
+        double* sums = buffer.data();
+        for (size_t p = begin; p < end; ++p) {
+            const size_t rowBegin = pairs[p].first * kTile;
+            const size_t columnBegin = pairs[p].second * kTile;
+            const size_t rows = std::min(kTile, n - rowBegin);
+            const size_t columns = std::min(kTile, n - columnBegin);
+            accumulateTile(returns, scale, rowBegin, rows, columnBegin, columns, sums, sums + kTile * kTile,
+                sums + kTile * kTile + kChunk * kTile);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < columns; ++j) {
+                    const size_t r = rowBegin + i, c = columnBegin + j;
+                    const double value = sums[i * kTile + j] - means[r] * means[c];
+                    matrix[r * n + c] = value;
+                    matrix[c * n + r] = value;
+                }
+            }
+        }
+    });
+
+    for (size_t t = 0; t < bars; ++t) {
+        const float* row = returns.row(t);
+        double norm = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const double deviation = row[i] - means[i];
+            norm += deviation * deviation;
+        }
+        fourthMoment += scale[t] * norm * norm;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        trace += matrix[i * n + i];
+        frobenius += dot(&matrix[i * n], &matrix[i * n], n);
+    }
+    updateShrinkage();
+}
+
+bool RiskModel::update(const float* returns) {
+    if (settings.method != CovarianceMethod::Ewma || assets == 0 || weightSum <= 0.0) return false;
+    const size_t n = assets;
+    const double fresh = 1.0 - settings.decay;
+    const double total = settings.decay * weightSum + fresh;
+    // Σ' = a·Σ + b·x x^T с нормировкой на новую сумму весов
+    const double a = settings.decay * weightSum / total;
+    const double b = fresh / total;
+    weightSquares = settings.decay * settings.decay * weightSquares + fresh * fresh;
+    weightSum = total;
+
+    double norm = 0.0;
+    for (size_t i = 0; i < n; ++i) norm += static_cast<double>(returns[i]) * returns[i];
+    fourthMoment = a * fourthMoment + b * norm * norm;
+
+    std::vector<double> column(returns, returns + n);
+    for (size_t i = 0; i < n; ++i) expected[i] += (column[i] - expected[i]) / static_cast<double>(bars + 1);
+    trace = 0.0;
+    frobenius = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double* row = &matrix[i * n];
+        const double scaled = b * column[i];
+        for (size_t j = 0; j < n; ++j) row[j] = a * row[j] + scaled * column[j];
+        trace += row[i];
+        frobenius += dot(row, row, n);
+    }
+    ++bars;
+    updateShrinkage();
+    return true;
+}
+
+void RiskModel::clear() {
+    matrix.clear();
+    expected.clear();
+    assets = 0;
+    bars = 0;
+    weightSum = 0.0;
+    weightSquares = 0.0;
+    fourthMoment = 0.0;
+    trace = 0.0;
+    frobenius = 0.0;
+    shrinkage = 0.0;
+    meanVariance = 0.0;
+    shrunkValid = false;
+}
+
+double RiskModel::covariance(size_t i, size_t j) const {
+    const double value = (1.0 - shrinkage) * matrix[i * assets + j];
+    return i == j ? value + shrinkage * meanVariance : value;
+}
+
+const std::vector<double>& RiskModel::getCovariance() const {
+    if (shrunkValid) return shrunk;
+    const size_t n = assets;
+    shrunk.resize(n * n);
+    for (size_t k = 0; k < n * n; ++k) shrunk[k] = (1.0 - shrinkage) * matrix[k];
+    for (size_t i = 0; i < n; ++i) shrunk[i * n + i] += shrinkage * meanVariance;
+    shrunkValid = true;
+    return shrunk;
+}
+
+// Ледуа — Вольф (2004): цель m·I, m = tr(S)/n; расстояние d² = |S - m·I|², разброс оценки
+// b² = Σω_t² · E|x_t x_t^T - S|² = Σω_t² · (E|x_t|⁴ - |S|²); коэффициент — min(b², d²) / d²
+void RiskModel::updateShrinkage() {
+    shrunkValid = false;
+    shrinkage = 0.0;
+    meanVariance = assets > 0 ? trace / static_cast<double>(assets) : 0.0;
+    if (!settings.shrink || assets == 0 || weightSum <= 0.0) return;
+    const double distance = frobenius - static_cast<double>(assets) * meanVariance * meanVariance;
+    if (distance <= 0.0) return;
+    const double concentration = weightSquares / (weightSum * weightSum);
+    const double spread = std::max(0.0, concentration * (fourthMoment - frobenius));
+    shrinkage = std::min(spread, distance) / distance;
+}
+
+PortfolioRisk RiskModel::evaluate(const std::vector<double>& weights, ThreadPool& pool) const {
+    PortfolioRisk risk;
+    const size_t n = assets;
+    if (weights.size() != n || n == 0) return risk;
+    std::vector<double> product(n);
+    pool.parallelFor(n, 16, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            product[i] = (1.0 - shrinkage) * dot(&matrix[i * n], weights.data(), n)
+                + shrinkage * meanVariance * weights[i];
+        }
+    });
+    const double variance = dot(weights.data(), product.data(), n);
+    risk.volatility = std::sqrt(std::max(variance, 0.0));
+    risk.marginal.assign(n, 0.0);
+    risk.component.assign(n, 0.0);
+    if (risk.volatility <= 0.0) return risk;
+    for (size_t i = 0; i < n; ++i) {
+        risk.marginal[i] = product[i] / risk.volatility;
+        risk.component[i] = weights[i] * risk.marginal[i];
+    }
+    return risk;
+}
+
+void portfolioWeights(const Portfolio& portfolio, std::vector<double>& weights) {
+    std::vector<float> values;
+    portfolio.convertValues(values);
+    const double total = portfolio.getTotalValue();
+    weights.resize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) weights[i] = total > 0.0 ? values[i] / total : 0.0;
+}
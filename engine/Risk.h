@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Returns.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+class Portfolio;
+
+enum class CovarianceMethod : std::uint8_t {
+    Sample, // все бары с равным весом, за вычетом среднего
+    Ewma,   // экспоненциальные веса с нулевым средним, как в RiskMetrics
+};
+
+struct RiskSettings {
+    CovarianceMethod method = CovarianceMethod::Ewma;
+    double decay = 0.94; // λ: вес бара умножается на него с каждым следующим
+    bool shrink = true;  // усадка Ледуа — Вольфа к единичной матрице со средней дисперсией
+};
+
+// Риск доходности портфеля за один бар; веса — доли стоимости портфеля
+struct PortfolioRisk {
+    double volatility = 0.0;       // стандартное отклонение, доля стоимости
+    std::vector<double> marginal;  // ∂volatility / ∂w_i = (Σw)_i / volatility
+    std::vector<double> component; // w_i · marginal_i; в сумме дают volatility
+};
+
+// Ковариация доходностей активов. Матрица хранится без усадки, а усадка — это только
+// коэффициент и средняя дисперсия, которые подмешиваются при чтении; поэтому новый бар EWMA
+// обновляет матрицу одним проходом ранга 1, а параметры усадки — по следам, накопленным в том же проходе
+class RiskModel {
+public:
+    // Полный пересчёт по матрице доходностей: блочное X^T·X по плиткам на пуле потоков
+    void estimate(const ReturnMatrix& returns, const RiskSettings& settings, ThreadPool& pool);
+    // Новый бар (returns — size() доходностей) за O(n²), без прохода по истории.
+    // Только для EWMA; false, если модель не оценена или оценка выборочная
+    bool update(const float* returns);
+    void clear();
+
+    size_t size() const { return assets; }
+    size_t getBars() const { return bars; }
+    const RiskSettings& getSettings() const { return settings; }
+    double getShrinkage() const { return shrinkage; }
+    // Средняя доходность бара по каждому активу, с равными весами при любом методе
+    const std::vector<double>& getExpectedReturns() const { return expected; }
+    // С учётом усадки
+    double covariance(size_t i, size_t j) const;
+    // Вся матрица с усадкой, size() × size() по строкам. Собирается при первом обращении после
+    // оценки или нового бара и дальше общая для границы и паритета риска
+    const std::vector<double>& getCovariance() const;
+
+    // weights — size() долей; Σw считается по строкам матрицы на пуле потоков
+    PortfolioRisk evaluate(const std::vector<double>& weights, ThreadPool& pool) const;
+
+private:
+    void updateShrinkage();
+
+    RiskSettings settings;
+    std::vector<double> matrix; // assets × assets, по строкам, без усадки
+    std::vector<double> expected;
+    size_t assets = 0;
+    size_t bars = 0;
+    // Для EWMA: сумма весов баров и сумма их квадратов без нормировки
+    double weightSum = 0.0;
+    double weightSquares = 0.0;
+    double fourthMoment = 0.0; // взвешенное среднее |x_t|⁴, нужно для оценки усадки
+    double trace = 0.0;
+    double frobenius = 0.0; // сумма квадратов элементов матрицы
+    double shrinkage = 0.0;
+    double meanVariance = 0.0;
+    mutable std::vector<double> shrunk;
+    mutable bool shrunkValid = false;
+};
+
+// Доли активов в стоимости портфеля в базовой валюте, в порядке getAssets. Знаменатель —
+// поддерживаемый портфелем итог вместе со свободными деньгами: деньги риска не несут
+void portfolioWeights(const Portfolio& portfolio, std::vector<double>& weights);
@@ -0,0 +1,338 @@
+#include "RiskParity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Проходов покоординатного спуска до перехода на Ньютона
+constexpr size_t kMaxSweeps = 50;
+constexpr size_t kMaxNewtonSteps = 100;
+constexpr double kContributionTolerance = 1e-10;
+// Относительная невязка сопряжённых градиентов в шаге Ньютона
+constexpr double kSolveTolerance = 1e-10;
+
+// Активы с положительной дисперсией; остальные в расчёт не входят
+bool collectActive(const std::vector<double>& covariance, size_t assets, std::vector<size_t>& active,
+    std::string* error) {
+    if (assets == 0 || covariance.size() != assets * assets) {
+        if (error) *error = "covariance does not match the number of assets";
+        return false;
+    }
+    active.clear();
+    for (size_t i = 0; i < assets; ++i) {
+        if (covariance[i * assets + i] > 0.0) active.push_back(i);
+    }
+    if (active.empty()) {
+        if (error) *error = "asset variance must be positive";
+        return false;
+    }
+    return true;
+}
+
+void finishAllocation(RiskParityAllocation& allocation, const std::vector<double>& covariance, size_t assets) {
+    double variance = 0.0;
+    for (size_t i = 0; i < assets; ++i) {
+        const double weight = allocation.weights[i];
+        if (weight == 0.0) continue;
+        const double* row = &covariance[i * assets];
+        for (size_t j = 0; j < assets; ++j) variance += weight * allocation.weights[j] * row[j];
+    }
+    allocation.volatility = std::sqrt(std::max(variance, 0.0));
+}
+
+// Дисперсия кластера order[begin, end) с долями внутри него, обратными дисперсии
+double clusterVariance(const std::vector<double>& covariance, size_t assets, const std::vector<size_t>& order,
+    size_t begin, size_t end, std::vector<double>& share) {
+    share.resize(end - begin);
+    double total = 0.0;
+    for (size_t k = begin; k < end; ++k) {
+        share[k - begin] = 1.0 / covariance[order[k] * assets + order[k]];
+        total += share[k - begin];
+    }
+    double variance = 0.0;
+    for (size_t a = begin; a < end; ++a) {
+        const double* row = &covariance[order[a] * assets];
+        double sum = 0.0;
+        for (size_t b = begin; b < end; ++b) sum += share[b - begin] * row[order[b]];
+        variance += share[a - begin] * sum;
+    }
+    return variance / (total * total);
+}
+
+// out = Σ·x по строкам активных активов; у остальных x = 0
+void multiply(const std::vector<double>& covariance, size_t assets, const std::vector<size_t>& active,
+    const std::vector<double>& x, std::vector<double>& out) {
+    std::fill(out.begin(), out.end(), 0.0);
+    for (size_t i : active) {
+        const double* row = &covariance[i * assets];
+        double sum = 0.0;
+        for (size_t j = 0; j < assets; ++j) sum += row[j] * x[j];
+        out[i] = sum;
+    }
+}
+
+// f(y) = ½yᵀΣy - b·Σ ln y по готовому sigmaY = Σy
+double objective(const std::vector<double>& y, const std::vector<double>& sigmaY, const std::vector<size_t>& active,
+    double budget) {
+    double value = 0.0;
+    for (size_t i : active) value += 0.5 * y[i] * sigmaY[i] - budget * std::log(y[i]);
+    return value;
+}
+
+size_t findRoot(std::vector<size_t>& parent, size_t node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+} // namespace
+
+bool equalRiskContribution(const std::vector<double>& covariance, size_t assets, RiskParityAllocation& allocation,
+    std::string* error) {
+    const auto started = std::chrono::steady_clock::now();
+    allocation = RiskParityAllocation();
+    std::vector<size_t> active;
+    if (!collectActive(covariance, assets, active, error)) return false;
+    const size_t n = assets;
+    const double budget = 1.0 / static_cast<double>(active.size());
+
+    // Старт — доли, обратные волатильности; sigmaY = Σy по всем активам
+    std::vector<double> y(n, 0.0), sigmaY(n, 0.0);
+    for (size_t i : active) y[i] = 1.0 / std::sqrt(covariance[i * n + i]);
+    multiply(covariance, n, active, y, sigmaY);
+    auto converged = [&] {
+        // В точке минимума y_i·(Σy)_i = b_i для всех i
+        allocation.maxDeviation = 0.0;
+        for (size_t i : active) {
+            allocation.maxDeviation = std::max(allocation.maxDeviation, std::abs(y[i] * sigmaY[i] / budget - 1.0));
+        }
+        return allocation.maxDeviation < kContributionTolerance;
+    };
+
+    bool done = false;
+    while (!done && allocation.sweeps < kMaxSweeps) {
+        ++allocation.sweeps;
+        for (size_t i : active) {
+            const double variance = covariance[i * n + i];
+            const double others = sigmaY[i] - variance * y[i];
+            const double next = (std::sqrt(others * others + 4.0 * variance * budget) - others) / (2.0 * variance);
+            const double step = next - y[i];
+            if (step == 0.0) continue;
+            y[i] = next;
+            // Σ симметрична: столбец i — та же строка i
+            const double* row = &covariance[i * n];
+            for (size_t j = 0; j < n; ++j) sigmaY[j] += step * row[j];
+        }
+        done = converged();
+    }
+
+    // При сильном общем факторе спуск по координатам ползёт: дальше — Ньютон с дроблением шага.
+    // Система H·d = g, H = Σ + diag(b / y²), решается сопряжёнными градиентами с диагональным
+    // предобусловливанием — нужны только умножения на Σ
+    std::vector<double> gradient(n, 0.0), direction(n), residual(n), preconditioned(n), search(n);
+    std::vector<double> product(n), trial(n, 0.0);
+    while (!done && allocation.newtonSteps < kMaxNewtonSteps) {
+        ++allocation.newtonSteps;
+        double gradientNorm = 0.0;
+        for (size_t i : active) {
+            gradient[i] = sigmaY[i] - budget / y[i];
+            gradientNorm += gradient[i] * gradient[i];
+        }
+        std::fill(direction.begin(), direction.end(), 0.0);
+        residual = gradient;
+        double rho = 0.0;
+        for (size_t i : active) {
+            preconditioned[i] = residual[i] / (covariance[i * n + i] + budget / (y[i] * y[i]));
+            rho += residual[i] * preconditioned[i];
+        }
+        search = preconditioned;
+        for (size_t iteration = 0; iteration < active.size(); ++iteration) {
+            multiply(covariance, n, active, search, product);
+            double curvature = 0.0;
+            for (size_t i : active) {
+                product[i] += budget / (y[i] * y[i]) * search[i];
+                curvature += search[i] * product[i];
+            }
+            if (!(curvature > 0.0)) break;
+            const double step = rho / curvature;
+            double remaining = 0.0;
+            for (size_t i : active) {
+                direction[i] += step * search[i];
+                residual[i] -= step * product[i];
+                remaining += residual[i] * residual[i];
+            }
+            if (remaining <= kSolveTolerance * kSolveTolerance * gradientNorm) break;
+            double next = 0.0;
+            for (size_t i : active) {
+                preconditioned[i] = residual[i] / (covariance[i * n + i] + budget / (y[i] * y[i]));
+                next += residual[i] * preconditioned[i];
+            }
+            for (size_t i : active) search[i] = preconditioned[i] + next / rho * search[i];
+            rho = next;
+        }
+        // Полный шаг, если он оставляет y > 0 и уменьшает f по Армихо; иначе — вдвое короче
+        double slope = 0.0;
+        for (size_t i : active) slope += gradient[i] * direction[i];
+        const double current = objective(y, sigmaY, active, budget);
+        double scale = 1.0;
+        bool accepted = false;
+        for (int halving = 0; halving < 60 && !accepted; ++halving, scale *= 0.5) {
+            bool positive = true;
+            for (size_t i : active) {
+                trial[i] = y[i] - scale * direction[i];
+                positive = positive && trial[i] > 0.0;
+            }
+            if (!positive) continue;
+            multiply(covariance, n, active, trial, product);
+            accepted = objective(trial, product, active, budget) <= current - 0.25 * scale * slope;
+        }
+        if (!accepted) break;
+        y.swap(trial);
+        sigmaY.swap(product);
+        done = converged();
+    }
+
+    const double total = std::accumulate(y.begin(), y.end(), 0.0);
+    allocation.weights.resize(n);
+    for (size_t i = 0; i < n; ++i) allocation.weights[i] = y[i] / total;
+    finishAllocation(allocation, covariance, n);
+    allocation.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+bool hierarchicalRiskParity(const std::vector<double>& covariance, size_t assets, ThreadPool& pool,
+    RiskParityAllocation& allocation, std::string* error) {
+    const auto started = std::chrono::steady_clock::now();
+    allocation = RiskParityAllocation();
+    std::vector<size_t> active;
+    if (!collectActive(covariance, assets, active, error)) return false;
+    const size_t n = assets;
+    const size_t m = active.size();
+
+    // d_ij = √(½(1 - ρ_ij)) по активным активам, m × m
+    std::vector<double> correlationDistance(m * m);
+    for (size_t a = 0; a < m; ++a) {
+        const double* row = &covariance[active[a] * n];
+        const double deviation = std::sqrt(row[active[a]]);
+        for (size_t b = 0; b < m; ++b) {
+            const double correlation = row[active[b]] / (deviation * std::sqrt(covariance[active[b] * n + active[b]]));
+            correlationDistance[a * m + b] = std::sqrt(std::max(0.0, 0.5 * (1.0 - correlation)));
+        }
+    }
+
+    // Евклидовы расстояния между строками d: строки делятся между потоками, каждая считает
+    // только правее диагонали, а нижний треугольник отражается после
+    std::vector<double> distance(m * m, 0.0);
+    pool.parallelFor(m, 4, [&](size_t begin, size_t end, size_t) {
+        for (size_t a = begin; a < end; ++a) {
+            const double* left = &correlationDistance[a * m];
+            for (size_t b = a + 1; b < m; ++b) {
+                const double* right = &correlationDistance[b * m];
+                double sum = 0.0;
+                for (size_t k = 0; k < m; ++k) sum += (left[k] - right[k]) * (left[k] - right[k]);
+                distance[a * m + b] = std::sqrt(sum);
+            }
+        }
+    });
+    for (size_t a = 0; a < m; ++a) {
+        for (size_t b = a + 1; b < m; ++b) distance[b * m + a] = distance[a * m + b];
+    }
+
+    // Одиночная связь — это минимальное остовное дерево: алгоритм Прима за O(m²), затем слияния
+    // в порядке роста длины рёбер
+    struct Edge {
+        double length;
+        size_t from, to;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(m > 0 ? m - 1 : 0);
+    std::vector<double> nearest(m, std::numeric_limits<double>::infinity());
+    std::vector<size_t> nearestFrom(m, 0);
+    std::vector<char> inTree(m, 0);
+    size_t current = 0;
+    inTree[0] = 1;
+    for (size_t added = 1; added < m; ++added) {
+        size_t next = m;
+        for (size_t b = 0; b < m; ++b) {
+            if (inTree[b]) continue;
+            if (distance[current * m + b] < nearest[b]) {
+                nearest[b] = distance[current * m + b];
+                nearestFrom[b] = current;
+            }
+            if (next == m || nearest[b] < nearest[next]) next = b;
+        }
+        edges.push_back({ nearest[next], nearestFrom[next], next });
+        inTree[next] = 1;
+        current = next;
+    }
+    std::stable_sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) { return x.length < y.length; });
+
+    // Узлы дерева кластеров: листья 0..m-1, слияния m..2m-2
+    std::vector<size_t> parent(m), clusterOf(m), left(m - 1), right(m - 1);
+    std::iota(parent.begin(), parent.end(), size_t(0));
+    std::iota(clusterOf.begin(), clusterOf.end(), size_t(0));
+    for (size_t k = 0; k < edges.size(); ++k) {
+        const size_t x = findRoot(parent, edges[k].from);
+        const size_t y = findRoot(parent, edges[k].to);
+        left[k] = clusterOf[x];
+        right[k] = clusterOf[y];
+        parent[y] = x;
+        clusterOf[x] = m + k;
+    }
+
+    // Порядок листьев обходом в глубину: похожие активы оказываются рядом
+    std::vector<size_t> order;
+    order.reserve(m);
+    std::vector<size_t> stack{ 2 * m - 2 };
+    while (!stack.empty()) {
+        const size_t node = stack.back();
+        stack.pop_back();
+        if (node < m) {
+            order.push_back(active[node]);
+        } else {
+            stack.push_back(right[node - m]);
+            stack.push_back(left[node - m]);
+        }
+    }
+
+    // Рекурсивное деление: половины получают доли α и 1 - α, α = 1 - V_left / (V_left + V_right)
+    allocation.weights.assign(n, 0.0);
+    for (size_t i : active) allocation.weights[i] = 1.0;
+    std::vector<double> share;
+    std::vector<std::pair<size_t, size_t>> ranges{ { 0, m } };
+    while (!ranges.empty()) {
+        const auto [begin, end] = ranges.back();
+        ranges.pop_back();
+        if (end - begin < 2) continue;
+        const size_t middle = begin + (end - begin) / 2;
+        const double leftVariance = clusterVariance(covariance, n, order, begin, middle, share);
+        const double rightVariance = clusterVariance(covariance, n, order, middle, end, share);
+        const double alpha = 1.0 - leftVariance / (leftVariance + rightVariance);
+        for (size_t k = begin; k < middle; ++k) allocation.weights[order[k]] *= alpha;
+        for (size_t k = middle; k < end; ++k) allocation.weights[order[k]] *= 1.0 - alpha;
+        ranges.push_back({ begin, middle });
+        ranges.push_back({ middle, end });
+    }
+    finishAllocation(allocation, covariance, n);
+    allocation.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+std::vector<TargetAllocation> allocationTargets(const Portfolio& portfolio, const std::vector<double>& weights) {
+    const auto& assets = portfolio.getAssets();
+    const auto& targets = portfolio.getTargets();
+    const SymbolTable& symbols = portfolio.getSymbols();
+    std::vector<TargetAllocation> result;
+    result.reserve(assets.size());
+    for (size_t i = 0; i < assets.size() && i < weights.size(); ++i) {
+        result.push_back({ symbols.name(assets[i].symbol), static_cast<float>(weights[i] * 100.0),
+            targets[i].tolerancePercent });
+    }
+    return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Portfolio.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <vector>
+
+// Распределение по риску: доли неотрицательны и в сумме дают 1. Активы с нулевой дисперсией
+// (без истории) получают нулевую долю
+struct RiskParityAllocation {
+    std::vector<double> weights;
+    double volatility = 0.0;  // √(wᵀΣw)
+    double maxDeviation = 0.0; // ERC: наибольшее отклонение вклада в риск от равного, в долях
+    size_t sweeps = 0;        // ERC: проходов по координатам
+    size_t newtonSteps = 0;   // ERC: шагов Ньютона после них
+    double elapsedMs = 0.0;
+};
+
+// Равный вклад в риск: w_i·(Σw)_i одинаковы. Циклический покоординатный спуск по
+// ½yᵀΣy - Σ b_i·ln y_i: минимум по y_i при остальных фиксированных — корень квадратного уравнения
+// Σ_ii·y_i² + c_i·y_i - b_i = 0, где c_i = (Σy)_i - Σ_ii·y_i, а Σy после шага обновляется
+// одним столбцом. Проход — O(n²). Если за несколько десятков проходов вклады не сравнялись,
+// решение доводится демпфированным методом Ньютона. Ответ — y, нормированный в сумму 1
+bool equalRiskContribution(const std::vector<double>& covariance, size_t assets, RiskParityAllocation& allocation,
+    std::string* error = nullptr);
+
+// Иерархический паритет риска (Лопес де Прадо): расстояния d_ij = √(½(1 - ρ_ij)), по ним —
+// евклидовы расстояния между строками d, одиночная связь через минимальное остовное дерево,
+// порядок листьев дерева кластеров и рекурсивное деление этого порядка пополам с долями,
+// обратными дисперсии половин. Матрица расстояний между строками — O(n³) и считается на пуле потоков
+bool hierarchicalRiskParity(const std::vector<double>& covariance, size_t assets, ThreadPool& pool,
+    RiskParityAllocation& allocation, std::string* error = nullptr);
+
+// Доли в порядке getAssets → цели для applyTargets; коридоры остаются от текущих целей
+std::vector<TargetAllocation> allocationTargets(const Portfolio& portfolio, const std::vector<double>& weights);
@@ -0,0 +1,199 @@
+#include "RollingWindow.h"
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cmath>
+
+void RollingStats::MaxQueue::reset(size_t capacity) {
+    items.assign(capacity, Item{ 0, 0.0 });
+    head = 0;
+    length = 0;
+}
+
+void RollingStats::MaxQueue::push(std::uint64_t bar, double value, size_t window) {
+    const size_t capacity = items.size();
+    while (length > 0 && items[(head + length - 1) % capacity].value <= value) --length;
+    items[(head + length) % capacity] = { bar, value };
+    ++length;
+    while (items[head].bar + window <= bar) {
+        head = (head + 1) % capacity;
+        --length;
+    }
+}
+
+void RollingStats::reset(size_t size) {
+    window = std::max<size_t>(1, size);
+    returns.assign(window, 0.0);
+    benchmarkReturns.assign(window, 0.0);
+    next = 0;
+    count = 0;
+    sinceResum = 0;
+    bar = 0;
+    lastPrice = 0.0;
+    meanReturn = 0.0;
+    meanBenchmark = 0.0;
+    squares = 0.0;
+    benchmarkSquares = 0.0;
+    coMoment = 0.0;
+    // В очереди — бары последнего окна плюс только что добавленный до снятия вышедших
+    peaks.reset(window + 1);
+    drawdowns.reset(window + 1);
+}
+
+void RollingStats::push(double price, double benchmarkReturn) {
+    if (!(price > 0.0)) return;
+    if (lastPrice > 0.0) {
+        const double value = price / lastPrice - 1.0;
+        if (count == window) remove(returns[next], benchmarkReturns[next]);
+        returns[next] = value;
+        benchmarkReturns[next] = benchmarkReturn;
+        next = (next + 1) % window;
+        add(value, benchmarkReturn);
+        if (++sinceResum >= window) resum();
+    }
+    lastPrice = price;
+    peaks.push(bar, price, window);
+    drawdowns.push(bar, drawdown(), window);
+    ++bar;
+}
+
+double RollingStats::volatility() const {
+    return count > 1 ? std::sqrt(std::max(0.0, squares / static_cast<double>(count - 1))) : 0.0;
+}
+
+double RollingStats::drawdown() const {
+    if (peaks.empty() || peaks.front().value <= 0.0) return 0.0;
+    return 1.0 - lastPrice / peaks.front().value;
+}
+
+// C_n = C_(n-1) + (x - mean_x(n-1))·(y - mean_y(n))
+void RollingStats::add(double value, double benchmark) {
+    ++count;
+    const double n = static_cast<double>(count);
+    const double deviation = value - meanReturn;
+    const double benchmarkDeviation = benchmark - meanBenchmark;
+    meanReturn += deviation / n;
+    meanBenchmark += benchmarkDeviation / n;
+    squares += deviation * (value - meanReturn);
+    benchmarkSquares += benchmarkDeviation * (benchmark - meanBenchmark);
+    coMoment += deviation * (benchmark - meanBenchmark);
+}
+
+// Обратный шаг к add: средние без выпавшего бара, затем те же произведения
+void RollingStats::remove(double value, double benchmark) {
+    if (count <= 1) {
+        count = 0;
+        meanReturn = meanBenchmark = squares = benchmarkSquares = coMoment = 0.0;
+        return;
+    }
+    const double rest = static_cast<double>(count - 1);
+    const double restMean = meanReturn - (value - meanReturn) / rest;
+    const double restBenchmark = meanBenchmark - (benchmark - meanBenchmark) / rest;
+    squares -= (value - restMean) * (value - meanReturn);
+    benchmarkSquares -= (benchmark - restBenchmark) * (benchmark - meanBenchmark);
+    coMoment -= (value - restMean) * (benchmark - meanBenchmark);
+    meanReturn = restMean;
+    meanBenchmark = restBenchmark;
+    --count;
+}
+
+void RollingStats::resum() {
+    sinceResum = 0;
+    const size_t first = (next + window - count) % window;
+    double sum = 0.0, benchmarkSum = 0.0;
+    for (size_t k = 0; k < count; ++k) {
+        sum += returns[(first + k) % window];
+        benchmarkSum += benchmarkReturns[(first + k) % window];
+    }
+    const double n = static_cast<double>(count);
+    meanReturn = count ? sum / n : 0.0;
+    meanBenchmark = count ? benchmarkSum / n : 0.0;
+    squares = benchmarkSquares = coMoment = 0.0;
+    for (size_t k = 0; k < count; ++k) {
+        const double deviation = returns[(first + k) % window] - meanReturn;
+        const double benchmarkDeviation = benchmarkReturns[(first + k) % window] - meanBenchmark;
+        squares += deviation * deviation;
+        benchmarkSquares += benchmarkDeviation * benchmarkDeviation;
+        coMoment += deviation * benchmarkDeviation;
+    }
+}
+
+void RollingAnalytics::configure(const Portfolio& source, const std::vector<PriceHistory::SeriesId>& assetSeries,
+    PriceHistory::SeriesId benchmarkSeries, const RollingSettings& rollingSettings, std::int64_t start) {
+    settings = rollingSettings;
+    series = assetSeries;
+    benchmark = benchmarkSeries;
+    benchmarkPrice = 0.0;
+    barEnd = start;
+    const auto& holdings = source.getAssets();
+    const FxTable& fx = source.getFx();
+    quantities.resize(holdings.size());
+    for (size_t i = 0; i < holdings.size(); ++i) {
+        quantities[i] = static_cast<double>(holdings[i].quantity) * fx.rate(holdings[i].currency);
+    }
+    series.resize(holdings.size(), kInvalidSymbol);
+    prices.assign(holdings.size(), 0.0);
+    cash = 0.0;
+    for (CurrencyId c = 0; c < fx.size(); ++c) cash += source.getCash(c) * fx.rate(c);
+    assets.assign(holdings.size(), RollingStats(settings.window));
+    portfolio.reset(settings.window);
+}
+
+size_t RollingAnalytics::advance(const PriceHistory& history, std::int64_t now) {
+    const std::int64_t barMs = settings.barMs;
+    if (barMs <= 0 || barEnd + barMs > now) return 0;
+
+    // Бары старше двух окон на статистику не влияют: после долгого перерыва окна начинаются заново
+    const std::int64_t keep = 2 * static_cast<std::int64_t>(settings.window) + 2;
+    const std::int64_t pending = (now - barEnd) / barMs;
+    if (pending > keep) {
+        barEnd += (pending - keep) * barMs;
+        for (RollingStats& stats : assets) stats.reset(settings.window);
+        portfolio.reset(settings.window);
+        std::fill(prices.begin(), prices.end(), 0.0);
+        benchmarkPrice = 0.0;
+    }
+
+    // Курсоры живут один вызов: между вызовами в историю дописываются точки
+    std::vector<PriceHistory::Cursor> cursors;
+    std::vector<size_t> cursorOf(series.size(), static_cast<size_t>(-1));
+    cursors.reserve(series.size() + 1);
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (series[i] == kInvalidSymbol || series[i] >= history.seriesCount()) continue;
+        cursorOf[i] = cursors.size();
+        cursors.emplace_back(history, series[i]);
+    }
+    const bool hasBenchmark = benchmark != kInvalidSymbol && benchmark < history.seriesCount();
+    if (hasBenchmark) cursors.emplace_back(history, benchmark);
+
+    size_t bars = 0;
+    for (; barEnd + barMs <= now; ++bars) {
+        barEnd += barMs;
+        float price;
+        double benchmarkReturn = 0.0;
+        if (hasBenchmark && cursors.back().advanceAsOf(barEnd, price)) {
+            if (benchmarkPrice > 0.0) benchmarkReturn = price / benchmarkPrice - 1.0;
+            benchmarkPrice = price;
+        }
+        double value = cash;
+        for (size_t i = 0; i < series.size(); ++i) {
+            if (cursorOf[i] != static_cast<size_t>(-1) && cursors[cursorOf[i]].advanceAsOf(barEnd, price)) prices[i] = price;
+            assets[i].push(prices[i], benchmarkReturn);
+            value += quantities[i] * prices[i];
+        }
+        portfolio.push(value, benchmarkReturn);
+    }
+    return bars;
+}
+
+void RollingAnalytics::clear() {
+    series.clear();
+    quantities.clear();
+    prices.clear();
+    assets.clear();
+    portfolio.reset(settings.window);
+    cash = 0.0;
+    benchmark = kInvalidSymbol;
+    benchmarkPrice = 0.0;
+    barEnd = 0;
+}
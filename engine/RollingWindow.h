@@ -0,0 +1,111 @@
+#pragma once
+
+#include "PriceHistory.h"
+
+#include <cstdint>
+#include <vector>
+
+class Portfolio;
+
+// Статистика ряда цен по скользящему окну из window баров. Новый бар обновляет её за O(1):
+// средние, дисперсии и ковариация с бенчмарком — по Уэлфорду с добавлением нового и вычитанием
+// выпавшего бара, максимум цены и просадки — монотонными очередями (амортизированно O(1)).
+// Раз в window баров суммы собираются заново из окна, чтобы вычитание не копило ошибку
+class RollingStats {
+public:
+    explicit RollingStats(size_t window = 20) { reset(window); }
+    void reset(size_t window);
+
+    // Цена на конце бара и доходность бенчмарка за тот же бар (0, если бенчмарка нет).
+    // Первая цена только запоминается: доходность появляется со второго бара
+    void push(double price, double benchmarkReturn);
+
+    size_t getWindow() const { return window; }
+    size_t size() const { return count; } // доходностей в окне
+    double mean() const { return count ? meanReturn : 0.0; }
+    double volatility() const;
+    // cov(r, r_b) / var(r_b); 0 без разброса бенчмарка
+    double beta() const { return benchmarkSquares > 0.0 ? coMoment / benchmarkSquares : 0.0; }
+    // От максимума цены за окно до текущей цены, доля
+    double drawdown() const;
+    // Наибольшая из drawdown() по барам окна. Пик для каждого бара ищется в окне, кончающемся
+    // на нём, поэтому пик может лежать до window баров раньше начала текущего окна
+    double maxDrawdown() const { return drawdowns.empty() ? 0.0 : drawdowns.front().value; }
+
+private:
+    // Очередь максимумов окна: значения от головы к хвосту убывают, вышедшие из окна снимаются с головы
+    class MaxQueue {
+    public:
+        struct Item {
+            std::uint64_t bar;
+            double value;
+        };
+
+        void reset(size_t capacity);
+        void push(std::uint64_t bar, double value, size_t window);
+        bool empty() const { return length == 0; }
+        const Item& front() const { return items[head]; }
+
+    private:
+        std::vector<Item> items; // кольцо
+        size_t head = 0;
+        size_t length = 0;
+    };
+
+    void add(double value, double benchmark);
+    void remove(double value, double benchmark);
+    void resum();
+
+    size_t window = 0;
+    std::vector<double> returns; // кольца последних window доходностей
+    std::vector<double> benchmarkReturns;
+    size_t next = 0;
+    size_t count = 0;
+    size_t sinceResum = 0;
+    std::uint64_t bar = 0;
+    double lastPrice = 0.0;
+    double meanReturn = 0.0;
+    double meanBenchmark = 0.0;
+    double squares = 0.0; // Σ(r - mean)²
+    double benchmarkSquares = 0.0;
+    double coMoment = 0.0; // Σ(r - mean)(r_b - mean_b)
+    MaxQueue peaks;
+    MaxQueue drawdowns;
+};
+
+struct RollingSettings {
+    std::int64_t barMs = 60 * 1000;
+    std::uint32_t window = 60;
+};
+
+// Окна по каждому активу портфеля и по портфелю целиком. Бары берутся из истории цен на сетке
+// barMs с переносом последней цены вперёд; стоимость портфеля — текущие количества по ценам бара,
+// в базовой валюте по текущим курсам, вместе со свободными деньгами
+class RollingAnalytics {
+public:
+    // Окна пусты; первый бар кончается в start + barMs. benchmark может быть kInvalidSymbol
+    void configure(const Portfolio& portfolio, const std::vector<PriceHistory::SeriesId>& series,
+        PriceHistory::SeriesId benchmark, const RollingSettings& settings, std::int64_t start);
+    // Проталкивает все бары, закончившиеся не позже now; возвращает их число
+    size_t advance(const PriceHistory& history, std::int64_t now);
+    void clear();
+
+    const RollingSettings& getSettings() const { return settings; }
+    PriceHistory::SeriesId getBenchmark() const { return benchmark; }
+    std::int64_t getBarEnd() const { return barEnd; }
+    // В порядке getAssets портфеля на момент configure
+    const std::vector<RollingStats>& getAssets() const { return assets; }
+    const RollingStats& getPortfolio() const { return portfolio; }
+
+private:
+    RollingSettings settings;
+    std::vector<PriceHistory::SeriesId> series;
+    std::vector<double> quantities; // в базовой валюте: количество × текущий курс
+    std::vector<double> prices;     // последние известные цены
+    double cash = 0.0;
+    PriceHistory::SeriesId benchmark = kInvalidSymbol;
+    double benchmarkPrice = 0.0;
+    std::int64_t barEnd = 0; // конец последнего учтённого бара
+    std::vector<RollingStats> assets;
+    RollingStats portfolio;
+};
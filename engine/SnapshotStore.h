@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Публикация неизменяемых снимков с эпохальным освобождением (RCU).
+// Читатель закрепляет текущую эпоху в своём слоте и читает указатель на снимок: две атомарные
+// операции, без ожидания писателя. Писатель подменяет указатель, а старый снимок откладывает
+// с номером эпохи и освобождает, когда ни один закреплённый читатель не может его видеть;
+// читателей он тоже не ждёт. Долгие задачи берут retain(): снимок живёт по shared_ptr,
+// и закреплённая эпоха не задерживает освобождение остальных.
+// Писатель один (publish, takeSpare, collect — из одного потока), читателей — до kMaxReaders одновременно.
+template <class T>
+class SnapshotStore {
+    struct Node {
+        std::shared_ptr<T> value;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{ 0 }; // 0 — слот свободен
+    };
+
+public:
+    static constexpr size_t kMaxReaders = 64;
+
+    class ReadGuard {
+    public:
+        ReadGuard() = default;
+        ReadGuard(ReadGuard&& other) noexcept : slot(std::exchange(other.slot, nullptr)), node(other.node) {}
+        ReadGuard& operator=(ReadGuard&& other) noexcept {
+            if (this != &other) {
+                release();
+                slot = std::exchange(other.slot, nullptr);
+                node = other.node;
+            }
+            return *this;
+        }
+        ~ReadGuard() { release(); }
+
+        const T* get() const { return node ? node->value.get() : nullptr; }
+        const T& operator*() const { return *node->value; }
+        const T* operator->() const { return node->value.get(); }
+        explicit operator bool() const { return node != nullptr; }
+
+        // Снимок для работы после снятия закрепления (фоновые задачи)
+        std::shared_ptr<const T> retain() const { return node ? node->value : nullptr; }
+
+    private:
+        friend class SnapshotStore;
+        ReadGuard(Slot* slot, Node* node) : slot(slot), node(node) {}
+        void release() {
+            if (slot) slot->epoch.store(0, std::memory_order_release);
+            slot = nullptr;
+        }
+
+        Slot* slot = nullptr;
+        Node* node = nullptr;
+    };
+
+    SnapshotStore() = default;
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+    // Читателей к этому моменту быть не должно
+    ~SnapshotStore() {
+        delete current.load(std::memory_order_relaxed);
+        for (auto& entry : retired) delete entry.second;
+    }
+
+    // Любой поток. Пустой guard, если ничего ещё не опубликовано
+    ReadGuard read() {
+        static thread_local size_t hint = 0;
+        for (;;) {
+            for (size_t i = 0; i < kMaxReaders; ++i) {
+                Slot& slot = slots[(hint + i) % kMaxReaders];
+                std::uint64_t expected = 0;
+                std::uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+                if (slot.epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst)) {
+                    hint = (hint + i) % kMaxReaders;
+                    return ReadGuard(&slot, current.load(std::memory_order_seq_cst));
+                }
+            }
+            std::this_thread::yield(); // все слоты заняты — только при превышении kMaxReaders
+        }
+    }
+
+    // Писатель: буфер для следующего снимка — освобождённый ранее, если он ни у кого не удержан
+    std::shared_ptr<T> takeSpare() {
+        std::shared_ptr<T> buffer = std::move(spare);
+        return buffer ? buffer : std::make_shared<T>();
+    }
+
+    // Писатель: делает снимок текущим и освобождает те, что больше никому не видны
+    void publish(std::shared_ptr<T> value) {
+        Node* old = current.exchange(new Node{ std::move(value) }, std::memory_order_seq_cst);
+        // Старый снимок могли взять только читатели, закрепившие эпоху не позже этой
+        std::uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+        if (old) retired.emplace_back(epoch, old);
+        collect();
+    }
+
+    void collect() {
+        std::uint64_t oldestPinned = std::numeric_limits<std::uint64_t>::max();
+        for (const auto& slot : slots) {
+            std::uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0) oldestPinned = std::min(oldestPinned, epoch);
+        }
+        auto visible = std::partition(retired.begin(), retired.end(),
+            [&](const std::pair<std::uint64_t, Node*>& entry) { return entry.first >= oldestPinned; });
+        for (auto it = visible; it != retired.end(); ++it) {
+            Node* node = it->second;
+            if (!spare && node->value.use_count() == 1) spare = std::move(node->value);
+            delete node;
+        }
+        retired.erase(visible, retired.end());
+    }
+
+    size_t retiredCount() const { return retired.size(); }
+
+private:
+    std::atomic<Node*> current{ nullptr };
+    std::atomic<std::uint64_t> globalEpoch{ 1 };
+    Slot slots[kMaxReaders];
+    std::vector<std::pair<std::uint64_t, Node*>> retired; // только писатель
+    std::shared_ptr<T> spare;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Очередь без блокировок для одного писателя и одного читателя.
+// Индексы писателя и читателя лежат на разных кеш-линиях; каждая сторона держит
+// локальную копию чужого индекса и перечитывает атомарный, только когда копия упирается
+// в границу. Поэтому в установившемся режиме сторона трогает чужую линию редко.
+template <class T>
+class SpscRing {
+public:
+    // Ёмкость округляется вверх до степени двойки
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        buffer.reset(new T[size]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // Только поток-писатель
+    bool tryPush(const T& item) {
+        size_t write = writeIndex.load(std::memory_order_relaxed);
+        if (write - cachedRead > mask) {
+            cachedRead = readIndex.load(std::memory_order_acquire);
+            if (write - cachedRead > mask) return false;
+        }
+        buffer[write & mask] = item;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Только поток-писатель. Публикует сколько поместилось одной атомарной записью
+    size_t pushBatch(const T* items, size_t count) {
+        size_t write = writeIndex.load(std::memory_order_relaxed);
+        size_t free = capacity() - (write - cachedRead);
+        if (free < count) {
+            cachedRead = readIndex.load(std::memory_order_acquire);
+            free = capacity() - (write - cachedRead);
+        }
+        size_t n = std::min(free, count);
+        for (size_t i = 0; i < n; ++i) buffer[(write + i) & mask] = items[i];
+        writeIndex.store(write + n, std::memory_order_release);
+        return n;
+    }
+
+    // Только поток-читатель
+    bool tryPop(T& item) {
+        size_t read = readIndex.load(std::memory_order_relaxed);
+        if (read == cachedWrite) {
+            cachedWrite = writeIndex.load(std::memory_order_acquire);
+            if (read == cachedWrite) return false;
+        }
+        item = buffer[read & mask];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Только поток-читатель: обрабатывает до maxItems элементов и освобождает их разом
+    template <class F>
+    size_t drain(F&& fn, size_t maxItems) {
+        size_t read = readIndex.load(std::memory_order_relaxed);
+        cachedWrite = writeIndex.load(std::memory_order_acquire);
+        size_t n = std::min(cachedWrite - read, maxItems);
+        for (size_t i = 0; i < n; ++i) fn(buffer[(read + i) & mask]);
+        readIndex.store(read + n, std::memory_order_release);
+        return n;
+    }
+
+    // Примерное заполнение: годится для статистики, не для синхронизации
+    size_t sizeApprox() const {
+        return writeIndex.load(std::memory_order_relaxed) - readIndex.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    std::unique_ptr<T[]> buffer;
+    size_t mask = 0;
+
+    alignas(kCacheLine) std::atomic<size_t> writeIndex{ 0 };
+    size_t cachedRead = 0;  // копия readIndex у писателя
+
+    alignas(kCacheLine) std::atomic<size_t> readIndex{ 0 };
+    size_t cachedWrite = 0; // копия writeIndex у читателя
+};
@@ -0,0 +1,208 @@
+#include "StressTest.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+// Книг в плитке произведения: столбцы экспозиций плитки остаются в кэше на все сценарии
+constexpr size_t kBookTile = 256;
+
+bool fail(std::string* error, std::string message) {
+    if (error) *error = std::move(message);
+    return false;
+}
+
+} // namespace
+
+SymbolId FactorRegistry::addFactor(std::string_view name, double defaultLoading) {
+    const SymbolId factor = factors.intern(name);
+    if (factor == defaults.size()) defaults.push_back(defaultLoading);
+    else defaults[factor] = defaultLoading;
+    return factor;
+}
+
+void FactorRegistry::setLoading(SymbolId factor, std::string_view symbol, double loading) {
+    const SymbolId id = symbols.intern(symbol);
+    if (id == bySymbol.size()) bySymbol.emplace_back();
+    std::vector<Loading>& list = bySymbol[id];
+    for (Loading& item : list) {
+        if (item.factor == factor) {
+            item.value = loading;
+            return;
+        }
+    }
+    list.push_back({ factor, loading });
+}
+
+void FactorRegistry::clear() {
+    factors.clear();
+    defaults.clear();
+    symbols.clear();
+    bySymbol.clear();
+}
+
+const std::vector<FactorRegistry::Loading>& FactorRegistry::loadings(std::string_view symbol) const {
+    static const std::vector<Loading> kNone;
+    const SymbolId id = symbols.find(symbol);
+    return id == kInvalidSymbol ? kNone : bySymbol[id];
+}
+
+bool StressScenarioSet::loadFile(const std::string& path, std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return fail(error, "cannot open " + path);
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const nlohmann::json root = nlohmann::json::parse(text, nullptr, false);
+    if (root.is_discarded() || !root.is_object()) return fail(error, path + ": invalid JSON");
+
+    FactorRegistry loaded;
+    const auto factorList = root.find("factors");
+    if (factorList != root.end()) {
+        if (!factorList->is_array()) return fail(error, "\"factors\" must be an array");
+        for (const nlohmann::json& item : *factorList) {
+            const auto name = item.find("name");
+            if (!item.is_object() || name == item.end() || !name->is_string() || name->get_ref<const std::string&>().empty()) {
+                return fail(error, "factor without a name");
+            }
+            const std::string& factorName = name->get_ref<const std::string&>();
+            const auto fallback = item.find("default");
+            if (fallback != item.end() && !fallback->is_number()) return fail(error, factorName + ": \"default\" must be a number");
+            const SymbolId factor = loaded.addFactor(factorName, fallback != item.end() ? fallback->get<double>() : 0.0);
+            const auto members = item.find("members");
+            if (members == item.end()) continue;
+            if (!members->is_object()) return fail(error, factorName + ": \"members\" must be an object");
+            for (const auto& member : members->items()) {
+                if (!member.value().is_number()) return fail(error, factorName + ": loading of " + member.key() + " must be a number");
+                loaded.setLoading(factor, member.key(), member.value().get<double>());
+            }
+        }
+    }
+
+    std::vector<StressScenario> parsed;
+    const auto scenarioList = root.find("scenarios");
+    if (scenarioList != root.end()) {
+        if (!scenarioList->is_array()) return fail(error, "\"scenarios\" must be an array");
+        for (const nlohmann::json& item : *scenarioList) {
+            const auto name = item.find("name");
+            if (!item.is_object() || name == item.end() || !name->is_string()) return fail(error, "scenario without a name");
+            StressScenario scenario;
+            scenario.name = name->get<std::string>();
+            const auto shocks = item.find("shocks");
+            if (shocks == item.end() || !shocks->is_object()) return fail(error, scenario.name + ": \"shocks\" object is missing");
+            for (const auto& shock : shocks->items()) {
+                if (!shock.value().is_number()) return fail(error, scenario.name + ": shock " + shock.key() + " must be a number");
+                const double value = shock.value().get<double>();
+                const SymbolId factor = loaded.findFactor(shock.key());
+                if (factor != kInvalidSymbol) {
+                    scenario.factorShocks.emplace_back(factor, value);
+                } else if (value > -1.0) {
+                    scenario.currencyShocks.emplace_back(shock.key(), value);
+                } else {
+                    return fail(error, scenario.name + ": currency shock " + shock.key() + " must be above -100%");
+                }
+            }
+            parsed.push_back(std::move(scenario));
+        }
+    }
+
+    factors = std::move(loaded);
+    scenarios = std::move(parsed);
+    return true;
+}
+
+void StressScenarioSet::clear() {
+    factors.clear();
+    scenarios.clear();
+}
+
+StressReport runStressTests(const StressScenarioSet& set, const std::vector<StressBook>& books,
+    std::string_view baseCurrency, ThreadPool& pool) {
+    const auto started = std::chrono::steady_clock::now();
+    const FactorRegistry& factors = set.getFactors();
+    const std::vector<StressScenario>& scenarios = set.getScenarios();
+    StressReport report;
+    report.books = books.size();
+    report.scenarios = scenarios.size();
+    report.values.assign(books.size(), 0.0);
+    report.pnl.assign(scenarios.size() * books.size(), 0.0);
+
+    // Валюты всех книг — блоки столбцов: стоимость и по столбцу на фактор
+    SymbolTable currencies;
+    currencies.intern(baseCurrency);
+    for (const StressBook& book : books) {
+        for (const StressHolding& holding : book.holdings) currencies.intern(holding.currency);
+    }
+    const size_t stride = factors.size() + 1;
+    const size_t columns = currencies.size() * stride;
+    const size_t bookCount = books.size();
+
+    // Экспозиции хранятся по столбцам: столбец — bookCount подряд идущих чисел, так что
+    // произведение ниже идёт по книгам непрерывными отрезками
+    std::vector<double> exposures(columns * bookCount, 0.0);
+    pool.parallelFor(bookCount, 64, [&](size_t begin, size_t end, size_t) {
+        for (size_t b = begin; b < end; ++b) {
+            double total = 0.0;
+            for (const StressHolding& holding : books[b].holdings) {
+                total += holding.value;
+                double* column = &exposures[currencies.find(holding.currency) * stride * bookCount + b];
+                column[0] += holding.value;
+                if (holding.symbol.empty()) continue;
+                for (size_t f = 0; f < factors.size(); ++f) {
+                    column[(f + 1) * bookCount] += holding.value * factors.defaultLoading(static_cast<SymbolId>(f));
+                }
+                for (const FactorRegistry::Loading& loading : factors.loadings(holding.symbol)) {
+                    column[(loading.factor + 1) * bookCount] += holding.value * (loading.value - factors.defaultLoading(loading.factor));
+                }
+            }
+            report.values[b] = total;
+        }
+    });
+
+    // Строка сценария: (m_c - 1) в столбце стоимости валюты c и m_c·шок_f в её столбцах факторов
+    std::vector<double> shocks(scenarios.size() * columns, 0.0);
+    std::vector<double> multipliers(currencies.size());
+    std::vector<double> factorShocks(factors.size());
+    for (size_t s = 0; s < scenarios.size(); ++s) {
+        std::fill(multipliers.begin(), multipliers.end(), 1.0);
+        double baseShock = 1.0;
+        for (const auto& [code, shock] : scenarios[s].currencyShocks) {
+            const SymbolId c = currencies.find(code);
+            if (c == 0) baseShock = 1.0 + shock;
+            else if (c != kInvalidSymbol) multipliers[c] = 1.0 + shock;
+        }
+        for (size_t c = 1; c < currencies.size(); ++c) multipliers[c] /= baseShock;
+        std::fill(factorShocks.begin(), factorShocks.end(), 0.0);
+        for (const auto& [factor, shock] : scenarios[s].factorShocks) factorShocks[factor] += shock;
+        double* row = &shocks[s * columns];
+        for (size_t c = 0; c < currencies.size(); ++c) {
+            row[c * stride] = multipliers[c] - 1.0;
+            for (size_t f = 0; f < factors.size(); ++f) row[c * stride + 1 + f] = multipliers[c] * factorShocks[f];
+        }
+    }
+
+    // P&L[s][b] = Σ_k shocks[s][k]·exposures[k][b]; нулевые шоки пропускаются — сценарии обычно разреженные
+    const size_t tiles = (bookCount + kBookTile - 1) / kBookTile;
+    pool.parallelFor(tiles, 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            const size_t first = tile * kBookTile;
+            const size_t last = std::min(bookCount, first + kBookTile);
+            for (size_t s = 0; s < scenarios.size(); ++s) {
+                double* out = &report.pnl[s * bookCount];
+                const double* row = &shocks[s * columns];
+                for (size_t k = 0; k < columns; ++k) {
+                    const double weight = row[k];
+                    if (weight == 0.0) continue;
+                    const double* column = &exposures[k * bookCount];
+                    for (size_t b = first; b < last; ++b) out[b] += weight * column[b];
+                }
+            }
+        }
+    });
+
+    report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
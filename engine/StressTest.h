@@ -0,0 +1,101 @@
+#pragma once
+
+#include "SymbolTable.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Реестр факторов: нагрузка символа на фактор — изменение цены на единицу шока фактора.
+// Символ, не перечисленный у фактора, получает его нагрузку по умолчанию
+class FactorRegistry {
+public:
+    struct Loading {
+        SymbolId factor;
+        double value;
+    };
+
+    // Повторное имя возвращает уже заведённый фактор и меняет его нагрузку по умолчанию
+    SymbolId addFactor(std::string_view name, double defaultLoading = 0.0);
+    void setLoading(SymbolId factor, std::string_view symbol, double loading);
+    void clear();
+
+    size_t size() const { return defaults.size(); }
+    SymbolId findFactor(std::string_view name) const { return factors.find(name); }
+    std::string_view name(SymbolId factor) const { return factors.name(factor); }
+    double defaultLoading(SymbolId factor) const { return defaults[factor]; }
+    // Явные нагрузки символа; пусто, если символ ни у одного фактора не перечислен
+    const std::vector<Loading>& loadings(std::string_view symbol) const;
+
+private:
+    SymbolTable factors;
+    std::vector<double> defaults;
+    SymbolTable symbols;
+    std::vector<std::vector<Loading>> bySymbol;
+};
+
+// Сценарий: шоки факторов и валют. Шок валюты меняет её курс к базовой в (1 + шок) раз,
+// шок самой базовой валюты — курсы всех остальных в 1 / (1 + шок) раз
+struct StressScenario {
+    std::string name;
+    std::vector<std::pair<SymbolId, double>> factorShocks;
+    std::vector<std::pair<std::string, double>> currencyShocks;
+};
+
+// Файл сценариев:
+// {
+//   "factors": [
+//     { "name": "equities", "default": 1.0, "members": { "SU26238": 0.0 } },
+//     { "name": "rates", "members": { "SU26238": -7.5 } }
+//   ],
+//   "scenarios": [
+//     { "name": "Crisis", "shocks": { "equities": -0.30, "RUB": -0.20, "rates": 0.02 } }
+//   ]
+// }
+// Шоки — доли; ключ шока, не найденный среди факторов, считается кодом валюты. Без "scenarios" файл
+// задаёт только факторы — их нагрузки нужны и панели экспозиций
+class StressScenarioSet {
+public:
+    bool loadFile(const std::string& path, std::string* error = nullptr);
+    void clear();
+
+    FactorRegistry& getFactors() { return factors; }
+    const FactorRegistry& getFactors() const { return factors; }
+    std::vector<StressScenario>& getScenarios() { return scenarios; }
+    const std::vector<StressScenario>& getScenarios() const { return scenarios; }
+
+private:
+    FactorRegistry factors;
+    std::vector<StressScenario> scenarios;
+};
+
+// Позиция книги: стоимость в базовой валюте; пустой symbol — деньги в валюте currency
+struct StressHolding {
+    std::string_view symbol;
+    std::string_view currency;
+    double value;
+};
+
+struct StressBook {
+    std::string name;
+    std::vector<StressHolding> holdings;
+};
+
+struct StressReport {
+    size_t scenarios = 0;
+    size_t books = 0;
+    std::vector<double> values; // стоимость книг до шока
+    std::vector<double> pnl;    // сценарии × книги, по строкам сценариев
+    double elapsedMs = 0.0;
+
+    double at(size_t scenario, size_t book) const { return pnl[scenario * books + book]; }
+};
+
+// Новая стоимость позиции — value·(1 + Σ_f нагрузка_f·шок_f)·(курсовой множитель её валюты), поэтому
+// результат книги линеен по её экспозициям E[валюта][фактор] = Σ value·нагрузка. Экспозиции всех книг
+// собираются одним проходом по позициям на пуле потоков, сценарии разворачиваются в векторы при тех же
+// столбцах, и матрица P&L — произведение книги × столбцы на сценарии × столбцы, плитками на пуле
+StressReport runStressTests(const StressScenarioSet& set, const std::vector<StressBook>& books,
+    std::string_view baseCurrency, ThreadPool& pool);
@@ -0,0 +1,112 @@
+#include "SymbolTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kMinBlockSize = 4096;
+
+size_t slotCountFor(size_t symbolCount) {
+    size_t slots = 16;
+    while (slots < symbolCount * 2) slots <<= 1; // заполнение не выше 50%
+    return slots;
+}
+
+} // namespace
+
+std::uint64_t SymbolTable::hash(std::string_view name) {
+    // FNV-1a: имена короткие, более сложная функция не окупается
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void SymbolTable::reserve(size_t symbolCount, size_t nameBytes) {
+    names.reserve(symbolCount);
+    hashes.reserve(symbolCount);
+    if (slots.size() < slotCountFor(symbolCount)) {
+        rehash(slotCountFor(symbolCount));
+    }
+    size_t free = blocks.empty() ? 0 : blocks.back().size - blocks.back().used;
+    if (nameBytes > 0 && free < nameBytes) {
+        blocks.push_back({ std::unique_ptr<char[]>(new char[nameBytes]), nameBytes, 0 });
+    }
+}
+
+std::string_view SymbolTable::store(std::string_view name) {
+    size_t needed = name.size() + 1;
+    if (blocks.empty() || blocks.back().size - blocks.back().used < needed) {
+        size_t size = std::max({ kMinBlockSize, needed, blocks.empty() ? size_t(0) : blocks.back().size * 2 });
+        blocks.push_back({ std::unique_ptr<char[]>(new char[size]), size, 0 });
+    }
+    Block& block = blocks.back();
+    char* dst = block.data.get() + block.used;
+    std::memcpy(dst, name.data(), name.size());
+    dst[name.size()] = '\0';
+    block.used += needed;
+    return std::string_view(dst, name.size());
+}
+
+void SymbolTable::rehash(size_t slotCount) {
+    slots.assign(slotCount, kInvalidSymbol);
+    size_t mask = slotCount - 1;
+    for (SymbolId id = 0; id < names.size(); ++id) {
+        size_t slot = hashes[id] & mask;
+        while (slots[slot] != kInvalidSymbol) slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
+}
+
+SymbolId SymbolTable::find(std::string_view name) const {
+    if (slots.empty()) return kInvalidSymbol;
+    std::uint64_t h = hash(name);
+    size_t mask = slots.size() - 1;
+    for (size_t slot = h & mask; slots[slot] != kInvalidSymbol; slot = (slot + 1) & mask) {
+        SymbolId id = slots[slot];
+        if (hashes[id] == h && names[id] == name) return id;
+    }
+    return kInvalidSymbol;
+}
+
+SymbolId SymbolTable::intern(std::string_view name) {
+    if (slots.size() < slotCountFor(names.size() + 1)) {
+        rehash(slotCountFor(names.size() + 1));
+    }
+    std::uint64_t h = hash(name);
+    size_t mask = slots.size() - 1;
+    size_t slot = h & mask;
+    for (; slots[slot] != kInvalidSymbol; slot = (slot + 1) & mask) {
+        SymbolId id = slots[slot];
+        if (hashes[id] == h && names[id] == name) return id;
+    }
+    SymbolId id = static_cast<SymbolId>(names.size());
+    names.push_back(store(name));
+    hashes.push_back(h);
+    slots[slot] = id;
+    return id;
+}
+
+size_t SymbolTable::memoryUsage() const {
+    size_t bytes = names.capacity() * sizeof(std::string_view) + hashes.capacity() * sizeof(std::uint64_t) +
+        slots.capacity() * sizeof(SymbolId);
+    for (const auto& block : blocks) bytes += block.size;
+    return bytes;
+}
+
+void SymbolTable::clear() {
+    if (!blocks.empty()) {
+        auto largest = std::max_element(blocks.begin(), blocks.end(),
+            [](const Block& a, const Block& b) { return a.size < b.size; });
+        Block keep = std::move(*largest);
+        keep.used = 0;
+        blocks.clear();
+        blocks.push_back(std::move(keep));
+    }
+    names.clear();
+    hashes.clear();
+    std::fill(slots.begin(), slots.end(), kInvalidSymbol);
+}
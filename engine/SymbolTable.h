@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using SymbolId = std::uint32_t;
+constexpr SymbolId kInvalidSymbol = ~SymbolId(0);
+
+// Интернирование имён активов. Строки лежат в арене из крупных блоков, которые
+// никогда не перемещаются, поэтому выданные string_view живут до clear().
+// Каждая строка хранится с завершающим нулём, так что name(id).data() — готовая C-строка.
+class SymbolTable {
+public:
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    SymbolTable(SymbolTable&&) = default;
+    SymbolTable& operator=(SymbolTable&&) = default;
+
+    // Заранее выделяет место: при точной оценке загрузка обходится O(1) аллокациями
+    void reserve(size_t symbolCount, size_t nameBytes);
+    SymbolId intern(std::string_view name);
+    SymbolId find(std::string_view name) const;
+    std::string_view name(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+    size_t memoryUsage() const;
+    // Сохраняет самый крупный блок арены для повторного использования
+    void clear();
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used;
+    };
+
+    static std::uint64_t hash(std::string_view name);
+    std::string_view store(std::string_view name);
+    void rehash(size_t slotCount);
+
+    std::vector<Block> blocks;
+    std::vector<std::string_view> names;
+    std::vector<std::uint64_t> hashes; // параллельно names, чтобы не пересчитывать при rehash
+    std::vector<SymbolId> slots;       // открытая адресация, размер — степень двойки
+};
@@ -0,0 +1,87 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Поток пула (или поток, уже выполняющий parallelFor) не должен ждать сам себя
+thread_local bool insidePool = false;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    workers.reserve(threads - 1);
+    for (size_t slot = 1; slot < threads; ++slot) {
+        workers.emplace_back([this, slot] { workerLoop(slot); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::runChunks(size_t slot) {
+    for (;;) {
+        size_t begin = nextIndex.fetch_add(jobGrain, std::memory_order_relaxed);
+        if (begin >= jobCount) break;
+        (*job)(begin, std::min(begin + jobGrain, jobCount), slot);
+    }
+}
+
+void ThreadPool::workerLoop(size_t slot) {
+    insidePool = true;
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runChunks(slot);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const RangeFunction& fn) {
+    if (count == 0) return;
+    if (grain == 0) grain = std::max<size_t>(1, count / (size() * 8));
+    if (insidePool || workers.empty() || count <= grain) {
+        fn(0, count, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        jobGrain = grain;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    insidePool = true;
+    runChunks(0);
+    insidePool = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busyWorkers == 0; });
+    job = nullptr;
+}
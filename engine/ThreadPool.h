@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул рабочих потоков для параллельных циклов движка.
+// parallelFor раздаёт блоки индексов через атомарный счётчик (динамическая балансировка),
+// вызывающий поток работает наравне с остальными. Вызов изнутри задачи пула выполняется
+// последовательно в том же потоке, поэтому вложенные циклы не блокируются.
+class ThreadPool {
+public:
+    // Функция блока: [begin, end) и номер слота потока в диапазоне [0, size())
+    using RangeFunction = std::function<void(size_t begin, size_t end, size_t slot)>;
+
+    // threads == 0 — по числу аппаратных потоков
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Число слотов: рабочие потоки плюс вызывающий
+    size_t size() const { return workers.size() + 1; }
+
+    // grain — минимальный размер блока; 0 подбирается автоматически
+    void parallelFor(size_t count, size_t grain, const RangeFunction& fn);
+
+    // Общий пул процесса. parallelFor занимает пул на весь цикл, а интерфейс зовёт его каждый кадр,
+    // поэтому долгие фоновые расчёты берут собственный пул, а не этот
+    static ThreadPool& shared();
+
+private:
+    void workerLoop(size_t slot);
+    void runChunks(size_t slot);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::mutex submitMutex; // одновременно выполняется один цикл
+
+    const RangeFunction* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    std::atomic<size_t> nextIndex{ 0 };
+    size_t busyWorkers = 0;
+    std::uint64_t generation = 0;
+    bool stopping = false;
+};
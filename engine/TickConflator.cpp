@@ -0,0 +1,16 @@
+#include "TickConflator.h"
+
+#include <algorithm>
+
+void TickConflator::grow(SymbolId symbol) {
+    // С запасом, чтобы новые символы не перевыделяли массивы на каждом тике
+    size_t size = std::max<size_t>(symbol + 1, slots.size() * 2);
+    slots.resize(size);
+    dirty.resize((size + 63) / 64, 0);
+}
+
+void TickConflator::discard() {
+    std::fill(dirty.begin(), dirty.end(), 0);
+    dirtyCount = 0;
+    received = 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Bits.h"
+#include "Portfolio.h"
+#include "PriceFeed.h"
+#include "SymbolTable.h"
+
+#include <cstdint>
+#include <vector>
+
+// Схлопывание тиков между кадрами: на символ хранится только последняя цена,
+// изменённые символы отмечаются битом. apply трогает каждый изменённый символ один раз,
+// сколько бы тиков по нему ни пришло, и обходит битовую карту по словам,
+// пропуская по 64 нетронутых символа за сравнение.
+class TickConflator {
+public:
+    void push(const PriceTick& tick) {
+        if (tick.symbol >= slots.size()) grow(tick.symbol);
+        std::uint64_t bit = std::uint64_t(1) << (tick.symbol & 63);
+        std::uint64_t& word = dirty[tick.symbol >> 6];
+        if (!(word & bit)) {
+            word |= bit;
+            ++dirtyCount;
+        }
+        slots[tick.symbol] = tick;
+        ++received;
+    }
+
+    // Переносит накопленные цены в портфель и очищает отметки. Возвращает число символов
+    size_t apply(Portfolio& portfolio) {
+        return consume([&](const PriceTick& tick) { portfolio.setSymbolPrice(tick.symbol, tick.price); });
+    }
+
+    // Передаёт последний тик каждого изменённого символа в fn по возрастанию SymbolId
+    // и очищает отметки
+    template <class F>
+    size_t consume(F&& fn) {
+        size_t applied = 0;
+        if (dirtyCount > 0) {
+            for (size_t w = 0; w < dirty.size(); ++w) {
+                std::uint64_t word = dirty[w];
+                if (!word) continue;
+                dirty[w] = 0;
+                while (word) {
+                    fn(slots[w * 64 + lowestBit(word)]);
+                    word &= word - 1;
+                    ++applied;
+                }
+            }
+        }
+        dirtyCount = 0;
+        received = 0;
+        return applied;
+    }
+
+    // Сбрасывает отметки без применения (например, при смене портфеля)
+    void discard();
+
+    size_t getDirtyCount() const { return dirtyCount; }
+    // Тики, пришедшие с последнего apply, включая схлопнутые
+    std::uint64_t getReceived() const { return received; }
+
+private:
+    void grow(SymbolId symbol);
+
+    std::vector<PriceTick> slots;
+    std::vector<std::uint64_t> dirty; // бит на символ
+    size_t dirtyCount = 0;
+    std::uint64_t received = 0;
+};
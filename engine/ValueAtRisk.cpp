@@ -0,0 +1,146 @@
+#include "ValueAtRisk.h"
+#include "Returns.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Первое обращение курсора в пачке распаковывает блок ряда с начала, поэтому пачек немного:
+// по четыре на поток, но не короче kMinScenarioChunk
+constexpr size_t kMinScenarioChunk = 256;
+constexpr size_t kChunksPerThread = 4;
+
+// Хвост из ceil((1 - c)·N) худших сценариев; порядок values после вызова не сохраняется
+VarMeasures tailLoss(double* values, size_t count, double confidence) {
+    VarMeasures measures;
+    if (count == 0) return measures;
+    const double exact = (1.0 - confidence) * static_cast<double>(count);
+    const size_t tail = std::min(count, std::max<size_t>(1, static_cast<size_t>(std::ceil(exact - 1e-9))));
+    std::nth_element(values, values + (tail - 1), values + count);
+    double sum = 0.0;
+    for (size_t k = 0; k < tail; ++k) sum += values[k];
+    measures.var = -values[tail - 1];
+    measures.cvar = -sum / static_cast<double>(tail);
+    return measures;
+}
+
+VarMeasures normalLoss(double mean, double deviation, double confidence) {
+    const double z = normalQuantile(confidence);
+    const double density = std::exp(-0.5 * z * z) / std::sqrt(2.0 * 3.14159265358979323846);
+    return { z * deviation - mean, deviation * density / (1.0 - confidence) - mean };
+}
+
+} // namespace
+
+double normalQuantile(double probability) {
+    double low = -40.0, high = 40.0;
+    for (int i = 0; i < 200 && high - low > 1e-12; ++i) {
+        const double middle = 0.5 * (low + high);
+        if (0.5 * std::erfc(-middle / std::sqrt(2.0)) < probability) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return 0.5 * (low + high);
+}
+
+VarReport computeValueAtRisk(const PriceHistory& history, const std::vector<PriceHistory::SeriesId>& series,
+    const std::vector<VarBook>& books, std::int64_t end, const VarSettings& settings, ThreadPool& pool) {
+    const auto started = std::chrono::steady_clock::now();
+    VarReport report;
+    const size_t columns = series.size();
+    const std::int64_t bar = settings.barMs;
+    const size_t horizon = std::max<std::uint32_t>(1, settings.horizonBars);
+
+    // Сценарии берутся только там, где у самого раннего ряда уже есть цена horizon баров назад
+    size_t count = 0;
+    std::int64_t first = 0, last = 0;
+    if (bar > 0 && historySpan(history, series, first, last) && end > first) {
+        const std::int64_t available = (end - first) / bar - static_cast<std::int64_t>(horizon) + 1;
+        if (available > 0) count = std::min<size_t>(settings.scenarios, static_cast<size_t>(available));
+    }
+    report.scenarios = count;
+
+    // Позиции книг по столбцам: ряд распаковывается один раз на пачку для всех книг, где он есть
+    std::vector<size_t> offsets(columns + 1, 0);
+    for (const VarBook& book : books) {
+        for (std::uint32_t column : book.columns) ++offsets[column + 1];
+    }
+    for (size_t c = 0; c < columns; ++c) offsets[c + 1] += offsets[c];
+    std::vector<std::pair<size_t, double>> holders(offsets[columns]);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t b = 0; b < books.size(); ++b) {
+        for (size_t k = 0; k < books[b].columns.size(); ++k) {
+            holders[fill[books[b].columns[k]]++] = { b, books[b].values[k] };
+        }
+    }
+
+    // P&L по книгам: [книга][сценарий]; пачки пишут в непересекающиеся диапазоны сценариев
+    std::vector<double> shortPnl(books.size() * count, 0.0);
+    std::vector<double> longPnl(books.size() * count, 0.0);
+    const size_t chunkSize = std::max(kMinScenarioChunk,
+        (count + kChunksPerThread * pool.size() - 1) / (kChunksPerThread * pool.size()));
+    const size_t chunks = (count + chunkSize - 1) / chunkSize;
+    pool.parallelFor(chunks, 1, [&](size_t begin, size_t finish, size_t) {
+        std::vector<float> prices(chunkSize + horizon);
+        std::vector<double> shortReturns(chunkSize), longReturns(chunkSize);
+        for (size_t chunk = begin; chunk < finish; ++chunk) {
+            const size_t firstScenario = chunk * chunkSize;
+            const size_t size = std::min(chunkSize, count - firstScenario);
+            // Цена k соответствует моменту сценария firstScenario + k - horizon
+            const std::int64_t origin = end - static_cast<std::int64_t>(count - 1 - firstScenario + horizon) * bar;
+            for (size_t c = 0; c < columns; ++c) {
+                if (offsets[c] == offsets[c + 1] || series[c] == kInvalidSymbol) continue;
+                PriceHistory::Cursor cursor(history, series[c]);
+                for (size_t k = 0; k < size + horizon; ++k) {
+                    float price;
+                    prices[k] = cursor.advanceAsOf(origin + static_cast<std::int64_t>(k) * bar, price) ? price : 0.0f;
+                }
+                for (size_t k = 0; k < size; ++k) {
+                    const float now = prices[k + horizon];
+                    const float previous = prices[k + horizon - 1];
+                    const float start = prices[k];
+                    shortReturns[k] = now > 0.0f && previous > 0.0f ? static_cast<double>(now) / previous - 1.0 : 0.0;
+                    longReturns[k] = now > 0.0f && start > 0.0f ? static_cast<double>(now) / start - 1.0 : 0.0;
+                }
+                for (size_t h = offsets[c]; h < offsets[c + 1]; ++h) {
+                    const double value = holders[h].second;
+                    double* shortOut = &shortPnl[holders[h].first * count + firstScenario];
+                    double* longOut = &longPnl[holders[h].first * count + firstScenario];
+                    for (size_t k = 0; k < size; ++k) {
+                        shortOut[k] += value * shortReturns[k];
+                        longOut[k] += value * longReturns[k];
+                    }
+                }
+            }
+        }
+    });
+
+    report.books.resize(books.size());
+    pool.parallelFor(books.size(), 1, [&](size_t begin, size_t finish, size_t) {
+        for (size_t b = begin; b < finish; ++b) {
+            BookRisk& risk = report.books[b];
+            risk.name = books[b].name;
+            for (double value : books[b].values) risk.value += value;
+            if (count == 0) continue;
+            double* shortValues = &shortPnl[b * count];
+            double sum = 0.0, squares = 0.0;
+            for (size_t k = 0; k < count; ++k) sum += shortValues[k];
+            const double mean = sum / static_cast<double>(count);
+            for (size_t k = 0; k < count; ++k) squares += (shortValues[k] - mean) * (shortValues[k] - mean);
+            const double deviation = count > 1 ? std::sqrt(squares / static_cast<double>(count - 1)) : 0.0;
+            // Длинный горизонт параметрически — по правилу корня из времени
+            risk.parametric[0] = normalLoss(mean, deviation, settings.confidence);
+            risk.parametric[1] = normalLoss(mean * static_cast<double>(horizon),
+                deviation * std::sqrt(static_cast<double>(horizon)), settings.confidence);
+            risk.historical[0] = tailLoss(shortValues, count, settings.confidence);
+            risk.historical[1] = tailLoss(&longPnl[b * count], count, settings.confidence);
+        }
+    });
+    report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
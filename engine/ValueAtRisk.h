@@ -0,0 +1,53 @@
+#pragma once
+
+#include "PriceHistory.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VarSettings {
+    std::int64_t barMs = 86400000;  // короткий горизонт: один бар, по умолчанию сутки
+    std::uint32_t horizonBars = 10; // длинный горизонт в барах
+    std::uint32_t scenarios = 10000; // последних баров истории
+    double confidence = 0.99;
+};
+
+// Книга — набор позиций: столбец в общем списке рядов и стоимость в базовой валюте
+struct VarBook {
+    std::string name;
+    std::vector<std::uint32_t> columns;
+    std::vector<double> values;
+};
+
+// Потери положительны: VaR — квантиль убытка, CVaR — средний убыток за ним
+struct VarMeasures {
+    double var = 0.0;
+    double cvar = 0.0;
+};
+
+struct BookRisk {
+    std::string name;
+    double value = 0.0;
+    // [0] — один бар, [1] — horizonBars
+    VarMeasures historical[2];
+    VarMeasures parametric[2]; // нормальное распределение с моментами исторического P&L за бар
+};
+
+struct VarReport {
+    std::vector<BookRisk> books;
+    size_t scenarios = 0; // меньше заказанного, если история короче
+    double elapsedMs = 0.0;
+};
+
+// Сценарий s заканчивается в end - (S - 1 - s)·barMs; доходность ряда в нём — отношение цены на конец
+// к цене бар (или horizonBars баров) назад, окна длинного горизонта перекрываются. Книги
+// переоцениваются полностью: P&L = Σ v·(p1/p0 - 1). Сценарии режутся на пачки по потокам, и каждая
+// пачка проходит ряды по одному курсором, так что матрица сценариев × рядов не хранится.
+// Квантили — nth_element по P&L каждой книги, без полной сортировки
+VarReport computeValueAtRisk(const PriceHistory& history, const std::vector<PriceHistory::SeriesId>& series,
+    const std::vector<VarBook>& books, std::int64_t end, const VarSettings& settings, ThreadPool& pool);
+
+// Квантиль стандартного нормального распределения
+double normalQuantile(double probability);
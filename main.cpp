@@ -4,46 +4,161 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <string>
-#include <nlohmann/json.hpp>
-#include <fstream>
-#include <numeric>
 #include <random>
 #include <cmath>
+#include <ctime>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <chrono>
 #include <imgui_internal.h>
 #include "tinyfiledialogs.h"
+#include "PortfolioIO.h"
+#include "FileWatcher.h"
+#include "BulkIngest.h"
+#include "CommandLine.h"
+#include "PriceFeed.h"
+#include "TickConflator.h"
+#include "PriceHistory.h"
+#include "AsOfValuation.h"
+#include "SnapshotStore.h"
+#include "Ledger.h"
+#include "ProfitLoss.h"
+#include "Calendar.h"
+#include "MonteCarlo.h"
+#include "Risk.h"
+#include "ValueAtRisk.h"
+#include "Backtest.h"
+#include "Frontier.h"
+#include "RiskParity.h"
+#include "Performance.h"
+#include "RollingWindow.h"
+#include "StressTest.h"
+#include "FactorExposure.h"
+#ifdef _WIN32
 #include <windows.h>
-
-struct Asset {
-    std::string name;
-    int quantity;
-    float price;
-    ImU32 color;
-    float value() const { return static_cast<float>(quantity) * price; }
-};
-
-struct TargetAllocation {
-    std::string name;
-    float targetPercent;
-};
-
-struct RebalanceAction {
-    std::string name;
-    float currentValue;
-    float targetValue;
-    float diffValue;
-    int unitsToBuyOrSell;
-};
+#include <cstdio>
+#endif
 
 class PortfolioApp {
 private:
-    std::vector<Asset> assets;
-    std::vector<TargetAllocation> targets;
+    Portfolio portfolio;
     std::vector<RebalanceAction> actions;
     std::vector<Asset> previousAssets;
+    std::vector<Lot> previousLots;
+    size_t rebalanceBegin = 0; //     ,  
+    size_t rebalanceEnd = 0;
     char nameBuffer[128] = "";
+    char currencyBuffer[8] = ""; //    
     int quantity = 0;
     float price = 0.0f;
     float extraCapital = 0.0f;
+    std::string portfolioPath;
+    FileWatcher watcher;
+    bool watchFile = false;
+    PortfolioDiff lastReload;
+    bool reloaded = false;
+    ConsolidatedBook accountsBook;
+    IngestStats ingestStats;
+    int selectedPosition = -1;
+    PriceFeed priceFeed;
+    TickConflator conflator;
+    bool feedActive = false;
+    float feedSpeed = 1.0f;
+    size_t feedBoundSymbols = 0;
+    size_t feedTicksInWindow = 0;
+    double feedWindowStart = 0.0;
+    float feedTickRate = 0.0f;
+    std::string feedError;
+    std::string actionsStatus;
+    PriceHistory priceHistory;
+    std::vector<PriceHistory::SeriesId> historySeries; //  SymbolId 
+    int historySelected = 0;
+    int historyWindowSeconds = 600;
+    std::vector<std::int64_t> historyTimes;
+    std::vector<float> historyPrices;
+    std::vector<float> navValues;
+    double navMs = 0.0;
+    SnapshotStore<PortfolioSnapshot> snapshots;
+    std::uint64_t publishedRevision = 0;
+    bool snapshotStale = true; //       
+    std::thread saveThread;
+    std::atomic<bool> saving{ false };
+    std::atomic<bool> saveFailed{ false };
+    Ledger ledger;
+    std::string ledgerError;
+    char ledgerDate[11] = ""; //    
+    LedgerState ledgerView;
+    TimeWeightedReturn performance;
+    int performanceCloseHour = 24;
+    std::vector<float> performanceGrowth;
+    MoneyWeightedReturn moneyWeighted;
+    ProfitLoss pnl;
+    bool pnlFifo = false; //    
+    MonteCarloSettings monteCarloSettings;
+    int monteCarloBarSeconds = 60;           //     
+    float monteCarloFallbackVolatility = 1.0f; // %      
+    std::thread monteCarloThread;
+    ThreadPool monteCarloPool; //  :           
+    std::atomic<bool> monteCarloRunning{ false };
+    std::atomic<bool> monteCarloCancel{ false };
+    MonteCarloFan monteCarloFan; //   ,   monteCarloRunning == false
+    RiskSettings riskSettings;
+    int riskBarSeconds = 60;
+    RiskModel riskModel;
+    std::vector<PriceHistory::SeriesId> riskSeries; //  
+    std::vector<SymbolId> riskSymbols;              //     
+    std::int64_t riskBarMs = 0;   // ,    
+    std::int64_t riskBarEnd = 0;  //   ,   , 
+    std::int64_t lastTickTime = 0;
+    ReturnMatrix riskBar;
+    std::vector<double> riskWeights;
+    PortfolioRisk portfolioRisk;
+    RollingSettings rollingSettings;
+    int rollingBarSeconds = 60;
+    int rollingWindow = 60;
+    int rollingBenchmark = 0; // 0   ,    rollingBenchmark - 1
+    RollingAnalytics rolling;
+    std::vector<SymbolId> rollingSymbols;
+    std::uint64_t riskRevision = 0;
+    bool riskStale = true;
+    VarSettings varSettings;
+    int varBarSeconds = 86400;
+    float varConfidencePercent = 99.0f;
+    VarReport varReport;
+    StressScenarioSet stressScenarios;
+    StressReport stressReport;
+    std::vector<std::string> stressBooks; //    
+    std::string stressStatus;
+    SymbolTable exposureUniverse;            //  :  ,    
+    FactorLoadings exposureLoadings;
+    std::vector<std::string> exposureBooks;
+    std::vector<double> exposureWeights;     //  ,   exposureUniverse
+    std::vector<double> exposureValues;      //  ,   
+    ExposureTracker exposureTargets;         //   ,    
+    std::vector<SymbolId> exposureSymbols;   //     
+    std::vector<SymbolId> exposureColumns;   //   ;    
+    std::vector<double> exposureAssetTargets; //   ,    exposureTargets
+    double exposureMs = 0.0;
+    std::string exposureStatus;
+    int backtestBarSeconds = 86400;
+    float backtestCostBps = 10.0f;
+    float backtestContribution = 0.0f;
+    int backtestContributionBars = 21;
+    std::vector<BacktestStrategy> backtestStrategies;
+    std::vector<BacktestResult> backtestResults;
+    int backtestSelected = -1;
+    double backtestMs = 0.0;
+    std::string backtestStatus;
+    EfficientFrontier frontier;
+    std::vector<double> frontierCovariance;
+    std::vector<ImVec2> frontierCurve; // (, )  
+    FrontierPoint frontierChoice;
+    float frontierPosition = 0.5f;
+    std::string frontierStatus;
+    RiskParityAllocation riskParity;
+    bool riskParityHierarchical = false;
+    std::string riskParityStatus;
     bool firstFrame = true;
     ImFont* robotoFont = nullptr;
 
@@ -54,15 +169,11 @@ private:
         return ImColor::HSV(hueDist(gen), 0.8f, 0.8f);
     }
 
-    float getTotalValue() const {
-        return std::accumulate(assets.begin(), assets.end(), 0.0f,
-            [](float sum, const Asset& a) { return sum + a.value(); });
-    }
-
-    void drawBarChart() {
+    void drawBarChart(const PortfolioSnapshot& view) {
         ImGui::Text(u8" :");
 
-        float total_value = getTotalValue();
+        const auto& assets = view.getAssets();
+        float total_value = view.getTotalValue();
         if (total_value <= 0.0f) return;
 
         ImVec2 graph_size = ImVec2(ImGui::GetContentRegionAvail().x, 150.0f);
@@ -76,7 +187,7 @@ private:
         float current_x = cursor.x;
 
         for (const auto& asset : assets) {
-            float height = (asset.value() / total_value) * max_bar_height;
+            float height = (baseValue(asset, view.getFx()) / total_value) * max_bar_height;
             ImVec2 bar_start(current_x + 2.0f, cursor.y + graph_size.y - height);
             ImVec2 bar_end(current_x + x_step - 2.0f, cursor.y + graph_size.y);
 
@@ -86,7 +197,7 @@ private:
             //   
             if (x_step > 30.0f) { //       
                 ImVec2 text_pos(current_x + 5.0f, cursor.y + graph_size.y - 20.0f);
-                draw_list->AddText(text_pos, IM_COL32(255, 255, 255, 255), asset.name.c_str());
+                draw_list->AddText(text_pos, IM_COL32(255, 255, 255, 255), asset.name.data(), asset.name.data() + asset.name.size());
             }
 
             current_x += x_step;
@@ -95,64 +206,1198 @@ private:
         ImGui::Dummy(graph_size); //     
     }
 
+    //    ;        
+    void drawFxRates() {
+        const FxTable& fx = portfolio.getFx();
+        if (fx.size() < 2) return;
+        ImGui::Text(u8"  %s:", fx.baseCode().c_str());
+        for (CurrencyId c = 1; c < fx.size(); ++c) {
+            double rate = fx.rate(c);
+            ImGui::PushID(c);
+            ImGui::SetNextItemWidth(120.0f);
+            if (ImGui::InputDouble(fx.code(c).c_str(), &rate, 0.0, 0.0, "%.4f") && rate >= 0.0) {
+                portfolio.setFxRate(c, rate);
+                if (!actions.empty()) calculateRebalance();
+            }
+            if (!fx.hasRate(c)) {
+                ImGui::SameLine();
+                ImGui::TextUnformatted(u8" ");
+            }
+            ImGui::PopID();
+        }
+    }
+
     void calculateRebalance() {
+        portfolio.calculateRebalance(actions, extraCapital);
+    }
+
+    //      :      
+    std::int64_t ledgerTime() const {
+        return std::max<std::int64_t>(std::time(nullptr), ledger.lastTime());
+    }
+
+    //            
+    void applyLedger() {
+        ledger.flush();
+        ledger.applyTo(portfolio);
+        assignMissingColors();
+    }
+
+    //      ;      .  
+    //  ;   ,       
+    void openLedger() {
+        ledgerError.clear();
+        pnl.clear();
+        performance.clear();
+        if (portfolioPath.empty() || !ledger.open(portfolioPath + ".ledger", &ledgerError)) ledger.clear();
+        if (ledger.size() == 0) {
+            ledger.recordLots(portfolio);
+            ledger.recordAdjustments(portfolio, ledgerTime());
+        }
+        applyLedger();
+    }
+
+    //  ,       
+    void publishSnapshot() {
+        if (!snapshotStale && portfolio.getRevision() == publishedRevision) return;
+        std::shared_ptr<PortfolioSnapshot> next = snapshots.takeSpare();
+        portfolio.fillSnapshot(*next);
+        snapshots.publish(std::move(next));
+        publishedRevision = portfolio.getRevision();
+        snapshotStale = false;
+    }
+
+    //      :        
+    void savePortfolio() {
+        if (saving) return;
+        const char* filterPatterns[] = { "*.json" };
+        const char* filePath = tinyfd_saveFileDialog(" ", "", 1, filterPatterns, "JSON files");
+        if (!filePath) return;
+        std::string ledgerPath = std::string(filePath) + ".ledger";
+        if (ledger.getPath() != ledgerPath && !ledger.saveAs(ledgerPath, &ledgerError)) ledger.close();
+        publishSnapshot();
+        std::shared_ptr<const PortfolioSnapshot> snapshot = snapshots.read().retain();
+        if (saveThread.joinable()) saveThread.join();
+        saving = true;
+        saveFailed = false;
+        saveThread = std::thread([this, snapshot, path = std::string(filePath)]() {
+            saveFailed = !savePortfolioFile(path, *snapshot);
+            saving = false;
+        });
+    }
+
+    void loadPortfolio() {
+        const char* filterPatterns[] = { "*.json" };
+        const char* filePath = tinyfd_openFileDialog(" ", "", 1, filterPatterns, "JSON files", 0);
+        Portfolio loaded;
+        if (filePath && loadPortfolioFile(filePath, loaded)) {
+            //       
+            actions.clear();
+            previousAssets.clear();
+            previousLots.clear();
+            loaded.continueRevision(portfolio.getRevision());
+            portfolio = std::move(loaded);
+            snapshotStale = true;
+            riskStale = true;
+            assignMissingColors();
+            portfolioPath = filePath;
+            reloaded = false;
+            openLedger();
+            if (watchFile) watcher.start(portfolioPath);
+            rebindPriceFeed();
+        }
+    }
+
+    //       ,      accountsBook
+    void loadPortfolioFolder() {
+        const char* folder = tinyfd_selectFolderDialog("  ", "");
+        if (!folder) return;
+        std::vector<std::string> files = listPortfolioFiles(folder);
+        if (files.empty()) return;
+        accountsBook = ingestPortfolioFiles(files, ThreadPool::shared(), &ingestStats);
+        selectedPosition = -1;
         actions.clear();
-        float total_value = getTotalValue();
-        float total_target_percent = std::accumulate(targets.begin(), targets.end(), 0.0f,
-            [](float sum, const TargetAllocation& t) { return sum + t.targetPercent; });
+        previousAssets.clear();
+        previousLots.clear();
+        accountsBook.toPortfolio(portfolio);
+        assignMissingColors();
+        portfolioPath.clear();
+        watcher.stop();
+        reloaded = false;
+        openLedger();
+        rebindPriceFeed();
+    }
 
-        if (abs(total_target_percent - 100.0f) > 0.01f) {
+    void openPriceFeed() {
+        const char* filterPatterns[] = { "*.csv" };
+        const char* filePath = tinyfd_openFileDialog("", "", 1, filterPatterns, "CSV files", 0);
+        if (!filePath) return;
+        priceFeed.stop();
+        feedActive = false;
+        feedError.clear();
+        if (!priceFeed.loadReplayFile(filePath, &feedError)) return;
+        rebindPriceFeed();
+    }
+
+    // ,      CSV       
+    void openCorporateActions() {
+        const char* filterPatterns[] = { "*.csv" };
+        const char* filePath = tinyfd_openFileDialog(" ", "", 1, filterPatterns, "CSV files", 0);
+        if (!filePath) return;
+        CorporateActionBatch batch;
+        if (!batch.loadFile(filePath, &actionsStatus)) return;
+        //    :         
+        ledger.applyCorporateActions(batch, portfolio);
+        CorporateActionReport report = portfolio.applyCorporateActions(batch);
+        priceHistory.applyCorporateActions(batch);
+        applyLedger();
+        navValues.clear();
+        //      ,    
+        previousAssets.clear();
+        previousLots.clear();
+        if (!actions.empty()) calculateRebalance();
+        char text[256];
+        std::snprintf(text, sizeof(text), u8": %zu, : %zu,  : %zu,  %.2f %s",
+            report.splits, report.dividends, report.renames, report.cashPaid, portfolio.getFx().baseCode().c_str());
+        actionsStatus = text;
+    }
+
+    // SymbolId   ()    : 
+    // ,         
+    void rebindPriceFeed() {
+        if (!priceFeed.isLoaded()) return;
+        priceFeed.stop();
+        conflator.discard();
+        historySeries.clear();
+        navValues.clear();
+        priceFeed.bind(portfolio.getSymbols());
+        feedBoundSymbols = portfolio.getSymbols().size();
+        if (feedActive) priceFeed.start(feedSpeed);
+    }
+
+    //          
+    PriceHistory::SeriesId historySeriesFor(SymbolId symbol) {
+        if (symbol >= historySeries.size()) historySeries.resize(symbol + 1, kInvalidSymbol);
+        if (historySeries[symbol] == kInvalidSymbol) {
+            historySeries[symbol] = priceHistory.series(portfolio.getSymbols().name(symbol));
+        }
+        return historySeries[symbol];
+    }
+
+    void drawHistoryPanel() {
+        if (priceHistory.seriesCount() == 0) {
+            ImGui::TextWrapped(u8" :  ,     .");
             return;
         }
+        ImGui::Text(u8": %zu, : %zu, : %.1f ", priceHistory.seriesCount(),
+            priceHistory.totalPoints(), priceHistory.memoryUsage() / (1024.0 * 1024.0));
+        if (historySelected >= static_cast<int>(priceHistory.seriesCount())) historySelected = 0;
+        auto seriesName = [](void* data, int index, const char** text) {
+            *text = static_cast<PriceHistory*>(data)->name(static_cast<PriceHistory::SeriesId>(index)).data();
+            return true;
+        };
+        ImGui::Combo(u8"", &historySelected, seriesName, &priceHistory,
+            static_cast<int>(priceHistory.seriesCount()));
+        ImGui::InputInt(u8", ", &historyWindowSeconds);
+        if (historyWindowSeconds < 1) historyWindowSeconds = 1;
+
+        //   ,   
+        std::int64_t first = 0, last = 0;
+        auto id = static_cast<PriceHistory::SeriesId>(historySelected);
+        historyTimes.clear();
+        historyPrices.clear();
+        if (priceHistory.timeRange(id, first, last)) {
+            priceHistory.readRange(id, last - historyWindowSeconds * 1000LL, last, historyTimes, historyPrices);
+        }
+        ImGui::PlotLines("##history", historyPrices.data(), static_cast<int>(historyPrices.size()), 0, nullptr,
+            FLT_MAX, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y * 0.5f));
+
+        //          
+        if (ImGui::Button(u8"  ")) computeHistoryNav();
+        if (!navValues.empty()) {
+            ImGui::SameLine();
+            ImGui::Text(u8"%zu   %.1f ", navValues.size(), navMs);
+            ImGui::PlotLines("##nav", navValues.data(), static_cast<int>(navValues.size()), 0, nullptr,
+                FLT_MAX, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y));
+        }
+    }
+
+    void computeHistoryNav() {
+        std::int64_t first = INT64_MAX, last = INT64_MIN;
+        for (PriceHistory::SeriesId id = 0; id < priceHistory.seriesCount(); ++id) {
+            std::int64_t seriesFirst, seriesLast;
+            if (!priceHistory.timeRange(id, seriesFirst, seriesLast)) continue;
+            first = std::min(first, seriesFirst);
+            last = std::max(last, seriesLast);
+        }
+        navValues.clear();
+        if (first > last) return;
+        const int points = 200;
+        std::vector<std::int64_t> times(points);
+        for (int i = 0; i < points; ++i) times[i] = first + (last - first) * i / (points - 1);
+        double start = ImGui::GetTime();
+        std::vector<NavPoint> nav = valueSeriesAsOf(portfolio, priceHistory, times, ThreadPool::shared());
+        navMs = (ImGui::GetTime() - start) * 1000.0;
+        for (const auto& point : nav) navValues.push_back(static_cast<float>(point.value));
+    }
+
+    //          ,     
+    void startMonteCarlo() {
+        if (monteCarloRunning) return;
+        if (monteCarloThread.joinable()) monteCarloThread.join();
+        MonteCarloInput input;
+        std::vector<PriceHistory::SeriesId> series;
+        const FxTable& fx = portfolio.getFx();
+        for (const auto& asset : portfolio.getAssets()) {
+            input.values.push_back(static_cast<float>(baseValue(asset, fx)));
+            series.push_back(historySeriesFor(asset.symbol));
+        }
+        for (CurrencyId c = 0; c < fx.size(); ++c) input.cash += portfolio.getCash(c) * fx.rate(c);
+        const std::int64_t barMs = monteCarloBarSeconds * 1000LL;
+        const std::int64_t maxBars = 100000;
+        std::int64_t first = 0, last = 0;
+        if (historySpan(priceHistory, series, first, last)) {
+            first = std::max(first, last - maxBars * barMs);
+            sampleReturns(priceHistory, series, first, last, barMs, input.history);
+        }
+        input.estimateGbm(0.0f, monteCarloFallbackVolatility / 100.0f);
+
+        monteCarloCancel = false;
+        monteCarloRunning = true;
+        monteCarloThread = std::thread([this, input = std::move(input), settings = monteCarloSettings]() {
+            monteCarloFan = runMonteCarlo(input, settings, monteCarloPool, &monteCarloCancel);
+            monteCarloRunning = false;
+        });
+    }
+
+    void drawMonteCarloPanel() {
+        const bool running = monteCarloRunning;
+        int method = static_cast<int>(monteCarloSettings.method);
+        const char* methods[] = { u8" ", u8" " };
+        if (ImGui::Combo(u8"", &method, methods, 2)) monteCarloSettings.method = static_cast<MonteCarloMethod>(method);
+        int paths = static_cast<int>(monteCarloSettings.paths);
+        int steps = static_cast<int>(monteCarloSettings.steps);
+        int seed = static_cast<int>(monteCarloSettings.seed);
+        if (ImGui::InputInt(u8"", &paths, 1000)) monteCarloSettings.paths = static_cast<std::uint32_t>(std::max(paths, 1));
+        if (ImGui::InputInt(u8"", &steps, 10)) monteCarloSettings.steps = static_cast<std::uint32_t>(std::max(steps, 1));
+        ImGui::InputInt(u8", ", &monteCarloBarSeconds);
+        if (monteCarloBarSeconds < 1) monteCarloBarSeconds = 1;
+        ImGui::InputFloat(u8"  , %", &monteCarloFallbackVolatility, 0.1f, 1.0f, "%.2f");
+        if (monteCarloFallbackVolatility < 0.0f) monteCarloFallbackVolatility = 0.0f;
+        if (ImGui::InputInt(u8"", &seed)) monteCarloSettings.seed = static_cast<std::uint64_t>(seed);
+
+        if (!running) {
+            if (ImGui::Button(u8"")) startMonteCarlo();
+        } else {
+            if (ImGui::Button(u8"")) monteCarloCancel = true;
+            ImGui::SameLine();
+            ImGui::Text(u8"...");
+        }
+        if (running) return;
 
-        extraCapital = 0.0f;
-        for (const auto& target : targets) {
-            auto it = std::find_if(assets.begin(), assets.end(),
-                [&](const Asset& a) { return a.name == target.name; });
-            if (it != assets.end()) {
-                float current_value = it->value();
-                float target_value = total_value * (target.targetPercent / 100.0f);
-                float diff = target_value - current_value;
-                int units = static_cast<int>(std::round(diff / it->price));
+        const MonteCarloFan& fan = monteCarloFan;
+        if (fan.steps.size() < 2) return;
+        ImGui::Text(u8": %llu  %.0f ", static_cast<unsigned long long>(fan.paths), fan.elapsedMs);
+        ImGui::Text(u8": %.2f,   : %.2f,  : %.1f%%",
+            fan.initial, fan.meanFinal, fan.lossProbability * 100.0);
+        drawFanChart(fan);
+    }
+
+    // :  595  2575   
+    void drawFanChart(const MonteCarloFan& fan) {
+        const size_t points = fan.steps.size();
+        const int levels = MonteCarloFan::kLevels;
+        float low = fan.levels[0], high = fan.levels[0];
+        for (float level : fan.levels) {
+            low = std::min(low, level);
+            high = std::max(high, level);
+        }
+        if (high <= low) high = low + 1.0f;
 
-                actions.push_back({ it->name, current_value, target_value, diff, units });
-                extraCapital += diff;
+        ImVec2 size(ImGui::GetContentRegionAvail().x, std::max(ImGui::GetContentRegionAvail().y, 150.0f));
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        draw_list->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(50, 50, 50, 255));
+        const float lastStep = static_cast<float>(fan.steps.back());
+        auto at = [&](size_t point, int level) {
+            return ImVec2(origin.x + size.x * fan.steps[point] / lastStep,
+                origin.y + size.y * (1.0f - (fan.levels[point * levels + level] - low) / (high - low)));
+        };
+        for (size_t i = 0; i + 1 < points; ++i) {
+            draw_list->AddQuadFilled(at(i, 0), at(i + 1, 0), at(i + 1, 4), at(i, 4), IM_COL32(70, 130, 180, 70));
+            draw_list->AddQuadFilled(at(i, 1), at(i + 1, 1), at(i + 1, 3), at(i, 3), IM_COL32(70, 130, 180, 140));
+            draw_list->AddLine(at(i, 2), at(i + 1, 2), IM_COL32(255, 255, 255, 255), 2.0f);
+        }
+        const float initialY = origin.y + size.y * (1.0f - (static_cast<float>(fan.initial) - low) / (high - low));
+        if (initialY >= origin.y && initialY <= origin.y + size.y) {
+            draw_list->AddLine(ImVec2(origin.x, initialY), ImVec2(origin.x + size.x, initialY), IM_COL32(200, 80, 80, 200));
+        }
+
+        ImGui::InvisibleButton("##fan", size);
+        if (ImGui::IsItemHovered()) {
+            float share = (ImGui::GetIO().MousePos.x - origin.x) / size.x;
+            size_t point = 0;
+            while (point + 1 < points && fan.steps[point + 1] <= share * lastStep) ++point;
+            ImGui::BeginTooltip();
+            ImGui::Text(u8" %u", fan.steps[point]);
+            for (int level = 0; level < levels; ++level) {
+                ImGui::Text("p%.0f: %.2f", MonteCarloFan::kPercentiles[level], fan.levels[point * levels + level]);
             }
+            ImGui::EndTooltip();
         }
     }
 
-    void savePortfolio() {
-        const char* filterPatterns[] = { "*.json" };
-        const char* filePath = tinyfd_saveFileDialog(" ", "", 1, filterPatterns, "JSON files");
-        if (filePath) {
-            nlohmann::json j;
-            for (const auto& asset : assets) {
-                j["assets"].push_back({ {"name", asset.name}, {"quantity", asset.quantity}, {"price", asset.price} });
+    //       ;  EWMA     
+    void estimateRisk() {
+        riskSeries.clear();
+        riskSymbols.clear();
+        for (const auto& asset : portfolio.getAssets()) {
+            riskSeries.push_back(historySeriesFor(asset.symbol));
+            riskSymbols.push_back(asset.symbol);
+        }
+        const std::int64_t barMs = riskBarSeconds * 1000LL;
+        const std::int64_t maxBars = 100000;
+        riskBarMs = barMs;
+        std::int64_t first = 0, last = 0;
+        ReturnMatrix returns;
+        if (historySpan(priceHistory, riskSeries, first, last)) {
+            first = std::max(first, last - maxBars * barMs);
+            sampleReturns(priceHistory, riskSeries, first, last, barMs, returns);
+        }
+        riskModel.estimate(returns, riskSettings, ThreadPool::shared());
+        riskBarEnd = first + static_cast<std::int64_t>(returns.bars) * barMs;
+        riskStale = true;
+    }
+
+    void advanceRisk() {
+        if (riskModel.getBars() == 0 || riskModel.getSettings().method != CovarianceMethod::Ewma) return;
+        const std::int64_t barMs = riskBarMs;
+        for (int bar = 0; bar < 1000 && riskBarEnd + barMs <= lastTickTime; ++bar) {
+            sampleReturns(priceHistory, riskSeries, riskBarEnd, riskBarEnd + barMs, barMs, riskBar);
+            riskModel.update(riskBar.row(0));
+            riskBarEnd += barMs;
+            riskStale = true;
+        }
+    }
+
+    bool sameAssets(const std::vector<SymbolId>& symbols) const {
+        const auto& assets = portfolio.getAssets();
+        if (assets.size() != symbols.size()) return false;
+        for (size_t i = 0; i < assets.size(); ++i) {
+            if (assets[i].symbol != symbols[i]) return false;
+        }
+        return true;
+    }
+
+    bool riskMatchesPortfolio() const { return sameAssets(riskSymbols); }
+
+    //       window ,      
+    void configureRolling() {
+        std::vector<PriceHistory::SeriesId> series;
+        rollingSymbols.clear();
+        for (const auto& asset : portfolio.getAssets()) {
+            series.push_back(historySeriesFor(asset.symbol));
+            rollingSymbols.push_back(asset.symbol);
+        }
+        rollingSettings.barMs = rollingBarSeconds * 1000LL;
+        rollingSettings.window = static_cast<std::uint32_t>(rollingWindow);
+        const auto benchmark = rollingBenchmark > 0
+            ? static_cast<PriceHistory::SeriesId>(rollingBenchmark - 1) : kInvalidSymbol;
+        std::int64_t first = 0, last = 0;
+        if (!historySpan(priceHistory, series, first, last)) {
+            rolling.clear();
+            return;
+        }
+        last = std::max(last, lastTickTime);
+        std::int64_t start = last - (rollingWindow + 1LL) * rollingSettings.barMs;
+        start -= start % rollingSettings.barMs;
+        rolling.configure(portfolio, series, benchmark, rollingSettings, start);
+        rolling.advance(priceHistory, last);
+    }
+
+    void drawRollingPanel() {
+        ImGui::InputInt(u8", ##rolling", &rollingBarSeconds);
+        if (rollingBarSeconds < 1) rollingBarSeconds = 1;
+        ImGui::InputInt(u8", ", &rollingWindow);
+        rollingWindow = std::clamp(rollingWindow, 2, 100000);
+        if (rollingBenchmark > static_cast<int>(priceHistory.seriesCount())) rollingBenchmark = 0;
+        auto benchmarkName = [](void* data, int index, const char** text) {
+            *text = index == 0 ? u8""
+                : static_cast<PriceHistory*>(data)->name(static_cast<PriceHistory::SeriesId>(index - 1)).data();
+            return true;
+        };
+        ImGui::Combo(u8"", &rollingBenchmark, benchmarkName, &priceHistory,
+            static_cast<int>(priceHistory.seriesCount()) + 1);
+        if (ImGui::Button(u8" ")) configureRolling();
+        if (rolling.getBarEnd() == 0) {
+            ImGui::TextWrapped(u8"  :    .");
+            return;
+        }
+        if (!sameAssets(rollingSymbols)) {
+            ImGui::TextWrapped(u8"     .");
+            return;
+        }
+
+        const auto& assets = portfolio.getAssets();
+        const auto& stats = rolling.getAssets();
+        if (ImGui::BeginTable("RollingTable", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                ImVec2(0.0f, ImGui::GetContentRegionAvail().y))) {
+            ImGui::TableSetupScrollFreeze(0, 2);
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"  ");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8". ");
+            ImGui::TableHeadersRow();
+            auto row = [](const char* name, const RollingStats& window) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0); ImGui::Text("%s", name);
+                ImGui::TableSetColumnIndex(1); ImGui::Text("%+.4f%%", window.mean() * 100.0);
+                ImGui::TableSetColumnIndex(2); ImGui::Text("%.4f%%", window.volatility() * 100.0);
+                ImGui::TableSetColumnIndex(3); ImGui::Text("%.2f", window.beta());
+                ImGui::TableSetColumnIndex(4); ImGui::Text("%.2f%%", window.drawdown() * 100.0);
+                ImGui::TableSetColumnIndex(5); ImGui::Text("%.2f%%", window.maxDrawdown() * 100.0);
+            };
+            row(u8"", rolling.getPortfolio());
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(stats.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) row(assets[i].name.data(), stats[i]);
             }
-            std::ofstream file(filePath);
-            file << j.dump(4);
+            ImGui::EndTable();
         }
     }
 
-    void loadPortfolio() {
+    //    ( )       
+    void buildFrontier() {
+        frontierCurve.clear();
+        frontierChoice = FrontierPoint();
+        if (riskModel.getBars() == 0 || !riskMatchesPortfolio()) {
+            frontierStatus = u8"         .";
+            return;
+        }
+        frontierCovariance = riskModel.getCovariance();
+        std::string error;
+        if (!solveEfficientFrontier(frontierCovariance, riskModel.getExpectedReturns(), frontier, &error)) {
+            frontierStatus = error;
+            return;
+        }
+        const int points = 50;
+        for (int k = 0; k < points; ++k) {
+            FrontierPoint point = frontier.at(static_cast<double>(k) / (points - 1), frontierCovariance);
+            frontierCurve.push_back(ImVec2(static_cast<float>(point.volatility), static_cast<float>(point.expectedReturn)));
+        }
+        frontierChoice = frontier.at(frontierPosition, frontierCovariance);
+        frontierStatus.clear();
+    }
+
+    void drawFrontier() {
+        if (ImGui::Button(u8" ")) buildFrontier();
+        if (!frontierStatus.empty()) ImGui::TextWrapped("%s", frontierStatus.c_str());
+        if (frontierCurve.empty()) return;
+        ImGui::SameLine();
+        ImGui::Text(u8"%zu   %.1f ", frontier.corners.size(), frontier.elapsedMs);
+        if (ImGui::SliderFloat(u8"   ", &frontierPosition, 0.0f, 1.0f, "%.2f")) {
+            frontierChoice = frontier.at(frontierPosition, frontierCovariance);
+        }
+        ImGui::Text(u8" :  %.3f%%,  %.3f%%",
+            frontierChoice.expectedReturn * 100.0, frontierChoice.volatility * 100.0);
+
+        // :   X ,   Y 
+        ImVec2 size(ImGui::GetContentRegionAvail().x, 120.0f);
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        draw_list->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(50, 50, 50, 255));
+        ImVec2 low = frontierCurve[0], high = frontierCurve[0];
+        for (const ImVec2& point : frontierCurve) {
+            low = ImVec2(std::min(low.x, point.x), std::min(low.y, point.y));
+            high = ImVec2(std::max(high.x, point.x), std::max(high.y, point.y));
+        }
+        auto screen = [&](float volatility, float expected) {
+            float x = high.x > low.x ? (volatility - low.x) / (high.x - low.x) : 0.5f;
+            float y = high.y > low.y ? (expected - low.y) / (high.y - low.y) : 0.5f;
+            return ImVec2(origin.x + 4.0f + x * (size.x - 8.0f), origin.y + size.y - 4.0f - y * (size.y - 8.0f));
+        };
+        for (size_t k = 0; k + 1 < frontierCurve.size(); ++k) {
+            draw_list->AddLine(screen(frontierCurve[k].x, frontierCurve[k].y),
+                screen(frontierCurve[k + 1].x, frontierCurve[k + 1].y), IM_COL32(70, 130, 180, 255), 2.0f);
+        }
+        draw_list->AddCircleFilled(screen(static_cast<float>(frontierChoice.volatility),
+            static_cast<float>(frontierChoice.expectedReturn)), 4.0f, IM_COL32(255, 200, 0, 255));
+        ImGui::Dummy(size);
+
+        //     ;   
+        if (ImGui::Button(u8"  ") && riskMatchesPortfolio()) {
+            const auto& targets = portfolio.getTargets();
+            for (size_t i = 0; i < frontierChoice.weights.size(); ++i) {
+                portfolio.setTarget(i, static_cast<float>(frontierChoice.weights[i] * 100.0), targets[i].tolerancePercent);
+            }
+            snapshotStale = true;
+            if (!actions.empty()) calculateRebalance();
+        }
+    }
+
+    // ERC  HRP      ,   
+    void buildRiskParity(bool hierarchical) {
+        riskParity = RiskParityAllocation();
+        riskParityHierarchical = hierarchical;
+        if (riskModel.getBars() == 0 || !riskMatchesPortfolio()) {
+            riskParityStatus = u8"         .";
+            return;
+        }
+        std::string error;
+        const bool solved = hierarchical
+            ? hierarchicalRiskParity(riskModel.getCovariance(), riskModel.size(), ThreadPool::shared(), riskParity, &error)
+            : equalRiskContribution(riskModel.getCovariance(), riskModel.size(), riskParity, &error);
+        riskParityStatus = solved ? std::string() : error;
+    }
+
+    void drawRiskParity() {
+        if (ImGui::Button(u8"   ")) buildRiskParity(false);
+        ImGui::SameLine();
+        if (ImGui::Button("HRP")) buildRiskParity(true);
+        if (!riskParityStatus.empty()) ImGui::TextWrapped("%s", riskParityStatus.c_str());
+        if (riskParity.weights.empty()) return;
+        if (riskParityHierarchical) {
+            ImGui::Text(u8"HRP  %.1f ", riskParity.elapsedMs);
+        } else {
+            ImGui::Text(u8"ERC: %zu   %zu    %.1f ,   %.1e",
+                riskParity.sweeps, riskParity.newtonSteps, riskParity.elapsedMs, riskParity.maxDeviation);
+        }
+        ImGui::Text(u8"  : %.3f%%", riskParity.volatility * 100.0);
+        if (ImGui::Button(u8"  ##parity") && riskMatchesPortfolio()) {
+            portfolio.applyTargets(allocationTargets(portfolio, riskParity.weights));
+            snapshotStale = true;
+            if (!actions.empty()) calculateRebalance();
+        }
+    }
+
+    void drawRiskPanel() {
+        drawValueAtRisk();
+        ImGui::Separator();
+        int method = static_cast<int>(riskSettings.method);
+        const char* methods[] = { u8"", "EWMA" };
+        if (ImGui::Combo(u8"", &method, methods, 2)) riskSettings.method = static_cast<CovarianceMethod>(method);
+        if (riskSettings.method == CovarianceMethod::Ewma) {
+            float decay = static_cast<float>(riskSettings.decay);
+            if (ImGui::SliderFloat(u8"", &decay, 0.8f, 0.999f, "%.3f")) riskSettings.decay = decay;
+        }
+        ImGui::Checkbox(u8"   ", &riskSettings.shrink);
+        ImGui::InputInt(u8", ", &riskBarSeconds);
+        if (riskBarSeconds < 1) riskBarSeconds = 1;
+        if (ImGui::Button(u8"  ")) estimateRisk();
+        if (riskModel.getBars() == 0) {
+            ImGui::TextWrapped(u8"  :    .");
+            return;
+        }
+
+        //  :          
+        const auto& assets = portfolio.getAssets();
+        if (!riskMatchesPortfolio()) {
+            ImGui::TextWrapped(u8"      .");
+            return;
+        }
+        if (riskStale || riskRevision != portfolio.getRevision()) {
+            portfolioWeights(portfolio, riskWeights);
+            portfolioRisk = riskModel.evaluate(riskWeights, ThreadPool::shared());
+            riskRevision = portfolio.getRevision();
+            riskStale = false;
+        }
+
+        const double total = portfolio.getTotalValue();
+        ImGui::Text(u8": %zu, : %.2f", riskModel.getBars(), riskModel.getShrinkage());
+        ImGui::Text(u8"  : %.3f%% (%.2f %s)", portfolioRisk.volatility * 100.0,
+            portfolioRisk.volatility * total, portfolio.getFx().baseCode().c_str());
+        if (portfolioRisk.volatility <= 0.0) return;
+        if (ImGui::BeginTable("RiskTable", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                ImVec2(0.0f, ImGui::GetContentRegionAvail().y))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8" ");
+            ImGui::TableSetupColumn(u8"  ");
+            ImGui::TableHeadersRow();
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(assets.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", assets[i].name.data());
+                    ImGui::TableSetColumnIndex(1); ImGui::Text("%.2f%%", riskWeights[i] * 100.0);
+                    ImGui::TableSetColumnIndex(2); ImGui::Text("%.3f%%", portfolioRisk.marginal[i] * 100.0);
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%.1f%%", portfolioRisk.component[i] / portfolioRisk.volatility * 100.0);
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    // :     .  ,      SeriesId.
+    //   :      ,       
+    void computeValueAtRiskReport() {
+        std::vector<PriceHistory::SeriesId> series;
+        std::vector<std::uint32_t> columnOf;
+        auto column = [&](PriceHistory::SeriesId id) {
+            if (id >= columnOf.size()) columnOf.resize(id + 1, UINT32_MAX);
+            if (columnOf[id] == UINT32_MAX) {
+                columnOf[id] = static_cast<std::uint32_t>(series.size());
+                series.push_back(id);
+            }
+            return columnOf[id];
+        };
+
+        std::vector<VarBook> books(1);
+        books[0].name = portfolioPath.empty() ? u8"" : portfolioPath;
+        const FxTable& fx = portfolio.getFx();
+        for (const auto& asset : portfolio.getAssets()) {
+            books[0].columns.push_back(column(historySeriesFor(asset.symbol)));
+            books[0].values.push_back(baseValue(asset, fx));
+        }
+        const auto& accounts = accountsBook.getAccounts();
+        const size_t firstAccount = books.size();
+        for (const auto& account : accounts) books.push_back({ account.name, {}, {} });
+        const auto& positions = accountsBook.getPositions();
+        for (size_t p = 0; p < positions.size(); ++p) {
+            const PriceHistory::SeriesId id = priceHistory.findSeries(positions[p].name);
+            if (id == kInvalidSymbol) continue;
+            for (auto it = accountsBook.breakdownBegin(p); it != accountsBook.breakdownEnd(p); ++it) {
+                VarBook& book = books[firstAccount + it->account];
+                book.columns.push_back(column(id));
+                book.values.push_back(static_cast<double>(it->quantity) * it->price);
+            }
+        }
+
+        varSettings.barMs = varBarSeconds * 1000LL;
+        varSettings.confidence = varConfidencePercent / 100.0;
+        std::int64_t first = 0, last = 0;
+        if (!historySpan(priceHistory, series, first, last)) last = 0;
+        varReport = computeValueAtRisk(priceHistory, series, books, last, varSettings, ThreadPool::shared());
+    }
+
+    void drawValueAtRisk() {
+        ImGui::InputInt(u8" VaR, ", &varBarSeconds, 3600);
+        if (varBarSeconds < 1) varBarSeconds = 1;
+        int horizon = static_cast<int>(varSettings.horizonBars);
+        if (ImGui::InputInt(u8", ", &horizon)) varSettings.horizonBars = static_cast<std::uint32_t>(std::max(horizon, 1));
+        int scenarios = static_cast<int>(varSettings.scenarios);
+        if (ImGui::InputInt(u8"", &scenarios, 1000)) varSettings.scenarios = static_cast<std::uint32_t>(std::max(scenarios, 1));
+        ImGui::SliderFloat(u8", %", &varConfidencePercent, 90.0f, 99.9f, "%.1f");
+        if (ImGui::Button(u8" VaR")) computeValueAtRiskReport();
+        if (varReport.books.empty()) return;
+        ImGui::Text(u8": %zu  %.1f ", varReport.scenarios, varReport.elapsedMs);
+        if (ImGui::BeginTable("VarTable", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"VaR, 1 ");
+            ImGui::TableSetupColumn(u8"CVaR, 1 ");
+            ImGui::TableSetupColumn(u8"VaR, ");
+            ImGui::TableSetupColumn(u8"CVaR, ");
+            ImGui::TableHeadersRow();
+            for (const BookRisk& book : varReport.books) {
+                for (int method = 0; method < 2; ++method) {
+                    const VarMeasures* measures = method == 0 ? book.historical : book.parametric;
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    if (method == 0) ImGui::Text("%s (%.0f)", book.name.c_str(), book.value);
+                    ImGui::TableSetColumnIndex(1); ImGui::Text(method == 0 ? u8"." : u8".");
+                    ImGui::TableSetColumnIndex(2); ImGui::Text("%.2f", measures[0].var);
+                    ImGui::TableSetColumnIndex(3); ImGui::Text("%.2f", measures[0].cvar);
+                    ImGui::TableSetColumnIndex(4); ImGui::Text("%.2f", measures[1].var);
+                    ImGui::TableSetColumnIndex(5); ImGui::Text("%.2f", measures[1].cvar);
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    void openStressScenarios() {
         const char* filterPatterns[] = { "*.json" };
-        const char* filePath = tinyfd_openFileDialog(" ", "", 1, filterPatterns, "JSON files", 0);
-        if (filePath) {
-            std::ifstream file(filePath);
-            if (file.is_open()) {
-                nlohmann::json j;
-                file >> j;
-                assets.clear();
-                targets.clear();
-                for (const auto& item : j["assets"]) {
-                    assets.push_back({ item["name"].get<std::string>(), item["quantity"].get<int>(), item["price"].get<float>(), generateRandomColor() });
-                    targets.push_back({ item["name"].get<std::string>(), 0.0f });
+        const char* filePath = tinyfd_openFileDialog("-", "", 1, filterPatterns, "JSON files", 0);
+        if (!filePath) return;
+        stressReport = StressReport();
+        stressBooks.clear();
+        exposureBooks.clear(); //   
+        if (!stressScenarios.loadFile(filePath, &stressStatus)) return;
+        char text[128];
+        std::snprintf(text, sizeof(text), u8": %zu, : %zu",
+            stressScenarios.getFactors().size(), stressScenarios.getScenarios().size());
+        stressStatus = text;
+    }
+
+    //   ,   VaR:             
+    void runStressScenarios() {
+        const FxTable& fx = portfolio.getFx();
+        std::vector<StressBook> books(1);
+        books[0].name = portfolioPath.empty() ? u8"" : portfolioPath;
+        for (const auto& asset : portfolio.getAssets()) {
+            books[0].holdings.push_back({ asset.name, fx.code(asset.currency), baseValue(asset, fx) });
+        }
+        for (CurrencyId c = 0; c < fx.size(); ++c) {
+            if (portfolio.getCash(c) != 0.0) books[0].holdings.push_back({ {}, fx.code(c), portfolio.getCash(c) * fx.rate(c) });
+        }
+        const auto& accounts = accountsBook.getAccounts();
+        for (const auto& account : accounts) books.push_back({ account.name, {} });
+        const auto& positions = accountsBook.getPositions();
+        for (size_t p = 0; p < positions.size(); ++p) {
+            for (auto it = accountsBook.breakdownBegin(p); it != accountsBook.breakdownEnd(p); ++it) {
+                books[1 + it->account].holdings.push_back({ positions[p].name,
+                    accountsBook.getCurrencies().name(it->currency), static_cast<double>(it->quantity) * it->price });
+            }
+        }
+        stressReport = runStressTests(stressScenarios, books, fx.baseCode(), ThreadPool::shared());
+        stressBooks.clear();
+        for (StressBook& book : books) stressBooks.push_back(std::move(book.name));
+    }
+
+    void drawStressPanel() {
+        if (ImGui::Button(u8" ")) openStressScenarios();
+        ImGui::SameLine();
+        if (ImGui::Button(u8"") && !stressScenarios.getScenarios().empty()) runStressScenarios();
+        if (!stressStatus.empty()) ImGui::TextWrapped("%s", stressStatus.c_str());
+        if (stressReport.books == 0 || stressReport.scenarios == 0) return;
+        ImGui::Text(u8"%zu  x %zu   %.1f ", stressReport.scenarios, stressReport.books, stressReport.elapsedMs);
+
+        //   ;  ImGui  IMGUI_TABLE_MAX_COLUMNS 
+        const int shown = static_cast<int>(std::min<size_t>(stressReport.scenarios, 256));
+        const auto& scenarios = stressScenarios.getScenarios();
+        if (ImGui::BeginTable("StressTable", shown + 2,
+                ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY,
+                ImVec2(0.0f, ImGui::GetContentRegionAvail().y))) {
+            ImGui::TableSetupScrollFreeze(1, 1);
+            ImGui::TableSetupColumn(u8"", ImGuiTableColumnFlags_WidthFixed, 160.0f);
+            ImGui::TableSetupColumn(u8"");
+            for (int s = 0; s < shown; ++s) {
+                ImGui::TableSetupColumn(s < static_cast<int>(scenarios.size()) ? scenarios[s].name.c_str() : "?");
+            }
+            ImGui::TableHeadersRow();
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(stressReport.books));
+            while (clipper.Step()) {
+                for (int b = clipper.DisplayStart; b < clipper.DisplayEnd; ++b) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", stressBooks[b].c_str());
+                    ImGui::TableSetColumnIndex(1); ImGui::Text("%.2f", stressReport.values[b]);
+                    for (int s = 0; s < shown; ++s) {
+                        const double pnl = stressReport.at(s, b);
+                        ImGui::TableSetColumnIndex(s + 2);
+                        ImGui::TextColored(pnl < 0.0 ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImVec4(0.4f, 1.0f, 0.4f, 1.0f),
+                            "%+.2f", pnl);
+                    }
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    //         ;        
+    void buildExposures() {
+        exposureBooks.clear();
+        exposureSymbols.clear();
+        exposureColumns.clear();
+        const FactorRegistry& factors = stressScenarios.getFactors();
+        if (factors.size() == 0) {
+            exposureStatus = u8"  .";
+            return;
+        }
+        exposureUniverse.clear();
+        const auto& assets = portfolio.getAssets();
+        for (const auto& asset : assets) {
+            exposureColumns.push_back(exposureUniverse.intern(asset.name));
+            exposureSymbols.push_back(asset.symbol);
+        }
+        const auto& positions = accountsBook.getPositions();
+        std::vector<SymbolId> columnOf(positions.size());
+        for (size_t p = 0; p < positions.size(); ++p) columnOf[p] = exposureUniverse.intern(positions[p].name);
+        std::vector<std::string_view> names(exposureUniverse.size());
+        for (SymbolId id = 0; id < exposureUniverse.size(); ++id) names[id] = exposureUniverse.name(id);
+        exposureLoadings.assign(factors, names);
+
+        const auto& accounts = accountsBook.getAccounts();
+        const size_t columns = names.size();
+        exposureWeights.assign((accounts.size() + 1) * columns, 0.0);
+        exposureBooks.push_back(portfolioPath.empty() ? u8"" : portfolioPath);
+        const FxTable& fx = portfolio.getFx();
+        double total = 0.0;
+        for (CurrencyId c = 0; c < fx.size(); ++c) total += portfolio.getCash(c) * fx.rate(c);
+        for (const auto& asset : assets) total += baseValue(asset, fx);
+        for (size_t i = 0; i < assets.size() && total > 0.0; ++i) {
+            exposureWeights[exposureColumns[i]] += baseValue(assets[i], fx) / total;
+        }
+        for (const auto& account : accounts) exposureBooks.push_back(account.name);
+        for (size_t p = 0; p < positions.size(); ++p) {
+            for (auto it = accountsBook.breakdownBegin(p); it != accountsBook.breakdownEnd(p); ++it) {
+                const double value = accounts[it->account].value;
+                if (value <= 0.0) continue;
+                exposureWeights[(1 + it->account) * columns + columnOf[p]] +=
+                    static_cast<double>(it->quantity) * it->price / value;
+            }
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        exposureValues.assign(exposureBooks.size() * factors.size(), 0.0);
+        computeExposures(exposureLoadings, exposureWeights.data(), exposureBooks.size(), exposureValues.data(),
+            ThreadPool::shared());
+        exposureMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+        std::vector<double> targets(columns, 0.0);
+        const auto& allocation = portfolio.getTargets();
+        exposureAssetTargets.assign(assets.size(), 0.0);
+        for (size_t i = 0; i < std::min(allocation.size(), assets.size()); ++i) {
+            exposureAssetTargets[i] = allocation[i].targetPercent / 100.0;
+            targets[exposureColumns[i]] += exposureAssetTargets[i];
+        }
+        exposureTargets.reset(exposureLoadings, std::move(targets));
+        exposureStatus.clear();
+    }
+
+    void drawExposurePanel() {
+        if (ImGui::Button(u8" ")) openStressScenarios();
+        ImGui::SameLine();
+        if (ImGui::Button(u8" ")) buildExposures();
+        if (!exposureStatus.empty()) ImGui::TextWrapped("%s", exposureStatus.c_str());
+        const FactorRegistry& factors = stressScenarios.getFactors();
+        if (exposureBooks.empty() || exposureLoadings.factorCount() != factors.size()) return;
+        if (!sameAssets(exposureSymbols)) {
+            ImGui::TextWrapped(u8"     .");
+            return;
+        }
+        //         ,     
+        const auto& allocation = portfolio.getTargets();
+        for (size_t i = 0; i < std::min(allocation.size(), exposureSymbols.size()); ++i) {
+            const double weight = allocation[i].targetPercent / 100.0;
+            if (weight == exposureAssetTargets[i]) continue;
+            const SymbolId column = exposureColumns[i];
+            exposureTargets.setWeight(exposureLoadings, column,
+                exposureTargets.getWeights()[column] + weight - exposureAssetTargets[i]);
+            exposureAssetTargets[i] = weight;
+        }
+        ImGui::Text(u8"%zu , %zu , %zu   %.2f ", exposureBooks.size(),
+            exposureLoadings.assetCount(), exposureLoadings.factorCount(), exposureMs);
+
+        const int shown = static_cast<int>(std::min<size_t>(factors.size(), 256));
+        if (ImGui::BeginTable("ExposureTable", shown + 1,
+                ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY,
+                ImVec2(0.0f, ImGui::GetContentRegionAvail().y))) {
+            ImGui::TableSetupScrollFreeze(1, 2);
+            ImGui::TableSetupColumn(u8"", ImGuiTableColumnFlags_WidthFixed, 160.0f);
+            for (int f = 0; f < shown; ++f) ImGui::TableSetupColumn(factors.name(static_cast<SymbolId>(f)).data());
+            ImGui::TableHeadersRow();
+            auto row = [shown](const char* name, const double* exposures) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0); ImGui::Text("%s", name);
+                for (int f = 0; f < shown; ++f) {
+                    ImGui::TableSetColumnIndex(f + 1);
+                    ImGui::Text("%+.3f", exposures[f]);
+                }
+            };
+            row(u8"", exposureTargets.getExposures().data());
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(exposureBooks.size()));
+            while (clipper.Step()) {
+                for (int b = clipper.DisplayStart; b < clipper.DisplayEnd; ++b) {
+                    row(exposureBooks[b].c_str(), &exposureValues[b * factors.size()]);
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    //         ;      
+    void runBacktestSweep() {
+        backtestResults.clear();
+        backtestSelected = -1;
+        if (std::abs(portfolio.getTotalTargetPercent() - 100.0f) > 0.01f) {
+            backtestStatus = u8"    100%.";
+            return;
+        }
+        std::vector<PriceHistory::SeriesId> series;
+        for (const auto& asset : portfolio.getAssets()) series.push_back(historySeriesFor(asset.symbol));
+        const std::int64_t barMs = backtestBarSeconds * 1000LL;
+        std::int64_t first = 0, last = 0;
+        if (!historySpan(priceHistory, series, first, last)) {
+            backtestStatus = u8"   .";
+            return;
+        }
+        const size_t bars = static_cast<size_t>(std::min<std::int64_t>((last - first) / barMs + 1, 100000));
+        BacktestInput input;
+        prepareBacktest(portfolio, priceHistory, series, first, barMs, bars, input);
+        input.contribution = backtestContribution;
+        input.contributionBars = static_cast<std::uint32_t>(std::max(backtestContributionBars, 1));
+
+        backtestStrategies.clear();
+        BacktestStrategy strategy;
+        strategy.costBps = backtestCostBps;
+        strategy.policy = RebalancePolicy::Calendar;
+        for (std::uint32_t period : { 1u, 5u, 21u, 63u, 252u }) {
+            strategy.periodBars = period;
+            backtestStrategies.push_back(strategy);
+        }
+        strategy.policy = RebalancePolicy::Threshold;
+        for (float threshold : { 1.0f, 2.0f, 5.0f, 10.0f }) {
+            strategy.thresholdPercent = threshold;
+            backtestStrategies.push_back(strategy);
+        }
+        strategy.policy = RebalancePolicy::CashFlow;
+        backtestStrategies.push_back(strategy);
+
+        double start = ImGui::GetTime();
+        backtestResults = runBacktests(input, backtestStrategies, ThreadPool::shared());
+        backtestMs = (ImGui::GetTime() - start) * 1000.0;
+        backtestStatus.clear();
+    }
+
+    void drawBacktestPanel() {
+        ImGui::InputInt(u8" , ", &backtestBarSeconds, 3600);
+        if (backtestBarSeconds < 1) backtestBarSeconds = 1;
+        ImGui::InputFloat(u8", ..", &backtestCostBps, 1.0f, 10.0f, "%.1f");
+        ImGui::InputFloat(u8"", &backtestContribution, 100.0f, 1000.0f, "%.2f");
+        ImGui::InputInt(u8"  ", &backtestContributionBars);
+        if (ImGui::Button(u8" ")) runBacktestSweep();
+        if (!backtestStatus.empty()) ImGui::TextWrapped("%s", backtestStatus.c_str());
+        if (backtestResults.empty()) return;
+        ImGui::Text(u8"%zu , %zu   %.1f ", backtestResults.size(), backtestResults[0].nav.size(), backtestMs);
+        if (ImGui::BeginTable("BacktestTable", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"  ");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableHeadersRow();
+            for (size_t k = 0; k < backtestResults.size(); ++k) {
+                const BacktestStrategy& strategy = backtestStrategies[k];
+                const BacktestResult& result = backtestResults[k];
+                char label[64];
+                if (strategy.policy == RebalancePolicy::Calendar) {
+                    std::snprintf(label, sizeof(label), u8"  %u ", strategy.periodBars);
+                } else if (strategy.policy == RebalancePolicy::Threshold) {
+                    std::snprintf(label, sizeof(label), u8" %.0f%%", strategy.thresholdPercent);
+                } else {
+                    std::snprintf(label, sizeof(label), u8"");
                 }
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                if (ImGui::Selectable(label, backtestSelected == static_cast<int>(k), ImGuiSelectableFlags_SpanAllColumns)) {
+                    backtestSelected = static_cast<int>(k);
+                }
+                ImGui::TableSetColumnIndex(1); ImGui::Text("%.2f", result.nav.empty() ? 0.0f : result.nav.back());
+                ImGui::TableSetColumnIndex(2); ImGui::Text("%.1f%%", result.maxDrawdown * 100.0);
+                ImGui::TableSetColumnIndex(3); ImGui::Text("%.2f", result.turnover);
+                ImGui::TableSetColumnIndex(4); ImGui::Text("%.2f", result.costs);
+                ImGui::TableSetColumnIndex(5); ImGui::Text("%u", result.rebalances);
             }
+            ImGui::EndTable();
+        }
+        if (backtestSelected >= 0) {
+            const auto& nav = backtestResults[backtestSelected].nav;
+            ImGui::PlotLines("##backtest", nav.data(), static_cast<int>(nav.size()), 0, nullptr,
+                FLT_MAX, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y));
+        }
+    }
+
+    //     ,      
+    void pollPriceFeed() {
+        if (!priceFeed.isLoaded()) return;
+        if (feedBoundSymbols != portfolio.getSymbols().size()) rebindPriceFeed();
+        //          
+        size_t ticks = priceFeed.drain(conflator);
+        size_t changed = conflator.consume([&](const PriceTick& tick) {
+            portfolio.setSymbolPrice(tick.symbol, tick.price);
+            pnl.setPrice(tick.symbol, tick.price);
+            priceHistory.append(historySeriesFor(tick.symbol), tick.timestamp, tick.price);
+            lastTickTime = std::max(lastTickTime, tick.timestamp);
+        });
+        if (ticks > 0) {
+            advanceRisk();
+            if (rolling.getBarEnd() != 0) rolling.advance(priceHistory, lastTickTime);
+        }
+        if (feedActive && !priceFeed.isRunning() && ticks == 0) feedActive = false;
+        feedTicksInWindow += ticks;
+        double now = ImGui::GetTime();
+        if (now - feedWindowStart >= 1.0) {
+            feedTickRate = static_cast<float>(feedTicksInWindow / (now - feedWindowStart));
+            feedTicksInWindow = 0;
+            feedWindowStart = now;
         }
+        if (changed > 0 && !actions.empty()) calculateRebalance();
+    }
+
+    void drawAccountsPanel() {
+        ImGui::Text(u8": %zu (: %zu), : %zu, : %zu",
+            ingestStats.files, ingestStats.failed, ingestStats.rows, ingestStats.symbols);
+        ImGui::Text(u8": %.1f , : %.1f , : %zu",
+            ingestStats.parseMs, ingestStats.mergeMs, ingestStats.threads);
+
+        const auto& accounts = accountsBook.getAccounts();
+        if (ImGui::BeginTable("AccountsTable", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                ImVec2(0.0f, 150.0f))) {
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableHeadersRow();
+            for (const auto& account : accounts) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0); ImGui::Text("%s", account.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                if (account.loaded) ImGui::Text("%zu", account.positions);
+                else ImGui::TextColored(ImVec4(1, 0, 0, 1), u8"");
+                ImGui::TableSetColumnIndex(2); ImGui::Text("%.2f", account.value);
+            }
+            ImGui::EndTable();
+        }
+
+        //      
+        const auto& positions = accountsBook.getPositions();
+        const char* preview = selectedPosition >= 0 ? positions[selectedPosition].name.data() : "";
+        if (ImGui::BeginCombo(u8"", preview)) {
+            for (int i = 0; i < static_cast<int>(positions.size()); ++i) {
+                if (ImGui::Selectable(positions[i].name.data(), i == selectedPosition)) selectedPosition = i;
+            }
+            ImGui::EndCombo();
+        }
+        if (selectedPosition >= 0 && ImGui::BeginTable("BreakdownTable", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableHeadersRow();
+            for (auto it = accountsBook.breakdownBegin(selectedPosition); it != accountsBook.breakdownEnd(selectedPosition); ++it) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0); ImGui::Text("%s", accounts[it->account].name.c_str());
+                ImGui::TableSetColumnIndex(1); ImGui::Text("%d", it->quantity);
+                ImGui::TableSetColumnIndex(2); ImGui::Text("%.2f", it->quantity * it->price);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    //      ,      
+    void drawPnlTotals() {
+        if (ImGui::RadioButton(u8" ", !pnlFifo)) pnlFifo = false;
+        ImGui::SameLine();
+        if (ImGui::RadioButton("FIFO", pnlFifo)) pnlFifo = true;
+        const FxTable& fx = portfolio.getFx();
+        const auto& totals = pnl.getTotals();
+        double unrealized = 0.0, realized = 0.0, income = 0.0;
+        for (SymbolId c = 0; c < totals.size(); ++c) {
+            CurrencyId currency = fx.find(ledger.getCurrencies().name(c));
+            double rate = currency == kInvalidCurrency ? 0.0 : fx.rate(currency);
+            unrealized += (pnlFifo ? totals[c].unrealizedFifo : totals[c].unrealizedAverage) * rate;
+            realized += (pnlFifo ? totals[c].realizedFifo : totals[c].realizedAverage) * rate;
+            income += totals[c].income * rate;
+        }
+        ImGui::SameLine();
+        ImGui::Text(u8": %+.2f, : %+.2f, : %.2f %s",
+            unrealized, realized, income, fx.baseCode().c_str());
+    }
+
+    //         
+    void drawLedgerPanel() {
+        ImGui::Text(u8": %zu, : %s", ledger.size(),
+            ledger.getPath().empty() ? u8"  " : ledger.getPath().c_str());
+        if (!ledgerError.empty()) ImGui::TextUnformatted(ledgerError.c_str());
+        ImGui::SetNextItemWidth(120.0f);
+        ImGui::InputTextWithHint(u8" ", u8"--", ledgerDate, IM_ARRAYSIZE(ledgerDate));
+        const LedgerState* state = &ledger.current();
+        std::int64_t day = 0;
+        if (ledgerDate[0] && parseIsoDate(ledgerDate, day)) {
+            ledger.positionsAsOf((day + 1) * kSecondsPerDay - 1, ledgerView);
+            state = &ledgerView;
+        }
+
+        const SymbolTable& symbols = ledger.getSymbols();
+        const SymbolTable& currencies = ledger.getCurrencies();
+        if (ImGui::BeginTable("LedgerTable", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                ImVec2(0.0f, 200.0f))) {
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8"");
+            ImGui::TableSetupColumn(u8" ");
+            ImGui::TableHeadersRow();
+            for (SymbolId symbol = 0; symbol < state->positions.size(); ++symbol) {
+                const LedgerPosition& position = state->positions[symbol];
+                if (position.quantity == 0) continue;
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0); ImGui::Text("%s", symbols.name(symbol).data());
+                ImGui::TableSetColumnIndex(1); ImGui::Text("%lld", static_cast<long long>(position.quantity));
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.2f %s", position.cost / static_cast<double>(position.quantity),
+                    currencies.name(position.currency).data());
+            }
+            ImGui::EndTable();
+        }
+        for (SymbolId c = 0; c < state->cash.size(); ++c) {
+            if (std::fabs(state->cash[c]) >= 0.005) {
+                ImGui::Text(u8": %.2f %s", state->cash[c], currencies.name(c).data());
+            }
+        }
+        if (ImGui::CollapsingHeader(u8"")) drawPerformance();
+    }
+
+    //      ; MWR   ,     
+    void advancePerformance() {
+        const size_t before = performance.getDays().size();
+        const std::int64_t close = performance.lastClose();
+        performance.advance(ledger, portfolio, priceHistory, std::time(nullptr));
+        const auto& days = performance.getDays();
+        if (days.size() == before && performance.lastClose() == close) return;
+        performanceGrowth.resize(days.size());
+        for (size_t d = 0; d < days.size(); ++d) performanceGrowth[d] = static_cast<float>(days[d].growth);
+        const auto& flows = performance.getFlows();
+        moneyWeighted = days.empty() ? MoneyWeightedReturn()
+            : moneyWeightedReturn(flows.data(), flows.size(), performance.lastClose(), days.back().value);
+    }
+
+    void drawPerformance() {
+        const auto& days = performance.getDays();
+        if (ImGui::SliderInt(u8" ,  UTC", &performanceCloseHour, 1, 24)) {
+            performance.setCloseOffset(performanceCloseHour * 3600LL - 1);
+            advancePerformance();
+        }
+        if (days.empty()) {
+            ImGui::TextUnformatted(u8"     .");
+            return;
+        }
+        ImGui::Text(u8": %zu, : %+.2f%%", days.size(), days.back().dailyReturn * 100.0);
+        ImGui::Text(u8"TWR: %+.2f%%  , %+.2f%% ", performance.cumulative() * 100.0,
+            performance.annualized() * 100.0);
+        if (moneyWeighted.solved) {
+            ImGui::Text(u8"MWR: %+.2f%% %s", moneyWeighted.rate * 100.0,
+                moneyWeighted.bracketed ? u8" ( )" : "");
+        } else {
+            ImGui::TextUnformatted(u8"MWR:  ");
+        }
+        ImGui::PlotLines("##growth", performanceGrowth.data(), static_cast<int>(performanceGrowth.size()), 0, nullptr,
+            FLT_MAX, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, 80.0f));
+    }
+
+    //    ,         
+    void assignMissingColors() {
+        for (size_t i = 0; i < portfolio.getAssets().size(); ++i) {
+            if (portfolio.getAssets()[i].color == 0) portfolio.setColor(i, generateRandomColor());
+        }
+    }
+
+    //        
+    void pollPortfolioFile() {
+        if (!watcher.poll()) return;
+        Portfolio incoming;
+        if (!loadPortfolioFile(portfolioPath, incoming)) return; //   
+        lastReload = portfolio.applyUpdate(incoming, std::time(nullptr));
+        //     :    
+        ledger.recordAdjustments(portfolio, ledgerTime());
+        applyLedger();
+        reloaded = true;
+        if (!actions.empty()) calculateRebalance();
     }
 
 public:
+    ~PortfolioApp() {
+        if (saveThread.joinable()) saveThread.join();
+        monteCarloCancel = true;
+        if (monteCarloThread.joinable()) monteCarloThread.join();
+    }
+
     void run() {
         if (!glfwInit()) return;
 
@@ -182,6 +1427,10 @@ public:
 
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
+            pollPortfolioFile();
+            pnl.sync(ledger, portfolio);
+            pollPriceFeed();
+            advancePerformance();
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
@@ -221,7 +1470,16 @@ public:
                 ImGui::DockBuilderDockWindow(u8" ", dock_left_up_id);
                 ImGui::DockBuilderDockWindow(u8" ", dock_left_down_id);
                 ImGui::DockBuilderDockWindow(u8" ", dock_right_up_id);
+                ImGui::DockBuilderDockWindow(u8"", dock_right_up_id);
+                ImGui::DockBuilderDockWindow(u8" ", dock_right_up_id);
+                ImGui::DockBuilderDockWindow(u8"", dock_right_up_id);
+                ImGui::DockBuilderDockWindow(u8" ", dock_right_up_id);
+                ImGui::DockBuilderDockWindow(u8"", dock_right_up_id);
                 ImGui::DockBuilderDockWindow(u8" ", dock_right_down_id);
+                ImGui::DockBuilderDockWindow(u8"", dock_right_down_id);
+                ImGui::DockBuilderDockWindow(u8"", dock_right_down_id);
+                ImGui::DockBuilderDockWindow(u8"", dock_right_down_id);
+                ImGui::DockBuilderDockWindow(u8"-", dock_right_down_id);
 
                 ImGui::DockBuilderFinish(dockspace_id);
             }
@@ -234,41 +1492,118 @@ public:
             ImGui::InputText(u8"", nameBuffer, IM_ARRAYSIZE(nameBuffer));
             ImGui::InputInt(u8"", &quantity);
             ImGui::InputFloat(u8"", &price, 0.1f, 1.0f, "%.2f");
+            ImGui::InputTextWithHint(u8"", portfolio.getFx().baseCode().c_str(), currencyBuffer, IM_ARRAYSIZE(currencyBuffer));
             if (ImGui::Button(u8" ") && nameBuffer[0] && quantity > 0 && price > 0) {
-                assets.push_back({ nameBuffer, quantity, price, generateRandomColor() });
-                targets.push_back({ nameBuffer, 0.0f });
+                CurrencyId currency = currencyBuffer[0] ? portfolio.currency(currencyBuffer) : kBaseCurrency;
+                size_t index = portfolio.addAsset(nameBuffer, quantity, price, generateRandomColor(), currency);
+                portfolio.addLot(portfolio.getAssets()[index].symbol, quantity, price, std::time(nullptr));
+                //  ,   ,   :   
+                ledger.recordAdjustment(ledgerTime(), nameBuffer, quantity, price, portfolio.getFx().code(currency));
+                applyLedger();
                 nameBuffer[0] = '\0';
                 quantity = 0;
                 price = 0.0f;
             }
             ImGui::SameLine();
             if (ImGui::Button(u8" ")) loadPortfolio();
+            ImGui::SameLine();
+            if (ImGui::Button(u8"  ")) loadPortfolioFolder();
+            ImGui::SameLine();
+            if (ImGui::Button(u8" ")) openCorporateActions();
+            if (!actionsStatus.empty()) ImGui::TextUnformatted(actionsStatus.c_str());
+            if (!portfolioPath.empty()) {
+                ImGui::SameLine();
+                if (ImGui::Checkbox(u8"  ", &watchFile)) {
+                    if (watchFile) watcher.start(portfolioPath);
+                    else watcher.stop();
+                }
+                if (reloaded) {
+                    ImGui::Text(u8"  : +%zu / -%zu /  %zu",
+                        lastReload.added, lastReload.removed, lastReload.changed);
+                }
+            }
+            if (ImGui::Button(u8"  ")) openPriceFeed();
+            if (!feedError.empty()) {
+                ImGui::SameLine();
+                ImGui::TextUnformatted(feedError.c_str());
+            }
+            if (priceFeed.isLoaded()) {
+                ImGui::SameLine();
+                if (ImGui::Button(feedActive ? u8"" : u8"")) {
+                    feedActive = !feedActive;
+                    if (feedActive) priceFeed.start(feedSpeed);
+                    else priceFeed.stop();
+                }
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(100.0f);
+                if (ImGui::InputFloat(u8" (0   )", &feedSpeed, 0.0f, 0.0f, "%.1f")) {
+                    if (feedSpeed < 0.0f) feedSpeed = 0.0f;
+                    if (feedActive) priceFeed.start(feedSpeed);
+                }
+                ImGui::Text(u8": %zu / %zu, %.0f  ;   : %zu",
+                    priceFeed.getPosition(), priceFeed.getTickCount(), feedTickRate, priceFeed.getUnboundSymbols());
+            }
+            drawFxRates();
+            for (CurrencyId c = 0; c < portfolio.getFx().size(); ++c) {
+                if (portfolio.getCash(c) != 0.0) {
+                    ImGui::Text(u8": %.2f %s", portfolio.getCash(c), portfolio.getFx().code(c).c_str());
+                }
+            }
 
             ImGui::Text(u8" ");
-            if (ImGui::BeginTable("AssetsTable", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            drawPnlTotals();
+            if (ImGui::BeginTable("AssetsTable", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
                 ImGui::TableSetupColumn(u8"");
                 ImGui::TableSetupColumn(u8"");
                 ImGui::TableSetupColumn(u8"");
+                ImGui::TableSetupColumn("P&L");
                 ImGui::TableSetupColumn(u8"");
                 ImGui::TableHeadersRow();
+                const auto& assets = portfolio.getAssets();
                 for (size_t i = 0; i < assets.size(); ++i) {
                     ImGui::TableNextRow();
-                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", assets[i].name.c_str());
+                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", assets[i].name.data());
                     ImGui::TableSetColumnIndex(1); ImGui::Text("%d", assets[i].quantity);
-                    ImGui::TableSetColumnIndex(2); ImGui::Text("%.2f", assets[i].value());
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%.2f %s", assets[i].value(), portfolio.getFx().code(assets[i].currency).c_str());
                     ImGui::TableSetColumnIndex(3);
-                    if (ImGui::Button(("Delete##" + assets[i].name).c_str())) {
-                        assets.erase(assets.begin() + i);
-                        targets.erase(targets.begin() + i);
+                    if (const PositionPnl* result = pnl.find(assets[i].symbol)) {
+                        double unrealized = pnlFifo ? result->unrealizedFifo() : result->unrealizedAverage();
+                        double realized = pnlFifo ? result->realizedFifo : result->realizedAverage;
+                        ImGui::TextColored(unrealized >= 0.0 ? ImVec4(0.4f, 1.0f, 0.4f, 1.0f) : ImVec4(1.0f, 0.4f, 0.4f, 1.0f),
+                            "%+.2f", unrealized);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::SetTooltip(u8": %+.2f, : %.2f", realized, result->income);
+                        }
+                    }
+                    ImGui::TableSetColumnIndex(4);
+                    ImGui::PushID(static_cast<int>(i));
+                    if (ImGui::Button("Delete")) {
+                        //     ,   
+                        ledger.recordAdjustment(ledgerTime(), assets[i].name, -assets[i].quantity, assets[i].price,
+                            portfolio.getFx().code(assets[i].currency));
+                        portfolio.removeAsset(i);
+                        applyLedger();
                         --i;
                     }
+                    ImGui::PopID();
                 }
                 ImGui::EndTable();
             }
             if (ImGui::Button(u8" ")) savePortfolio();
+            if (saving) {
+                ImGui::SameLine();
+                ImGui::TextUnformatted(u8"...");
+            }
+            else if (saveFailed) {
+                ImGui::SameLine();
+                ImGui::TextUnformatted(u8"   ");
+            }
             ImGui::End();
 
-            //  2: Portfolio Breakdown
+            //  2: Portfolio Breakdown   ,      
+            publishSnapshot();
+            auto view = snapshots.read();
             ImGui::Begin(u8" ");
             ImGui::Text(u8" :");
             if (ImGui::BeginTable("SharesTable", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
@@ -276,32 +1611,70 @@ public:
                 ImGui::TableSetupColumn(u8"");
                 ImGui::TableSetupColumn(u8"");
                 ImGui::TableHeadersRow();
-                float total_value = getTotalValue();
+                const auto& assets = view->getAssets();
+                const FxTable& fx = view->getFx();
+                float total_value = view->getTotalValue();
                 for (int i = 0; i < assets.size(); ++i) {
+                    float value = baseValue(assets[i], fx);
                     ImGui::TableNextRow();
                     ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, i % 2 == 0 ? IM_COL32(30, 30, 30, 255) : IM_COL32(40, 40, 40, 255));
-                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", assets[i].name.c_str());
-                    ImGui::TableSetColumnIndex(1); ImGui::Text("%.2f%%", total_value > 0 ? (assets[i].value() / total_value) * 100.0f : 0.0f);
-                    ImGui::TableSetColumnIndex(2); ImGui::Text("%.2f", assets[i].value());
+                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", assets[i].name.data());
+                    ImGui::TableSetColumnIndex(1); ImGui::Text("%.2f%%", total_value > 0 ? (value / total_value) * 100.0f : 0.0f);
+                    ImGui::TableSetColumnIndex(2); ImGui::Text("%.2f %s", value, fx.baseCode().c_str());
                 }
                 ImGui::EndTable();
             }
-            drawBarChart();
+            drawBarChart(*view);
+            ImGui::End();
+
+            //  2: Price History
+            ImGui::Begin(u8" ");
+            drawHistoryPanel();
+            ImGui::End();
+
+            //  2: Monte Carlo
+            ImGui::Begin(u8"");
+            drawMonteCarloPanel();
+            ImGui::End();
+
+            //  2: Risk
+            ImGui::Begin(u8"");
+            drawRiskPanel();
+            ImGui::End();
+
+            ImGui::Begin(u8" ");
+            drawRollingPanel();
+            ImGui::End();
+
+            ImGui::Begin(u8"");
+            drawExposurePanel();
             ImGui::End();
 
             //  3: Target Allocations
             ImGui::Begin(u8" ");
             
-            for (auto& target : targets) {
-                ImGui::InputFloat(target.name.c_str(), &target.targetPercent, 0.1f, 1.0f, "%.2f");
+            float& default_tolerance = portfolio.getSettings().defaultTolerancePercent;
+            if (ImGui::InputFloat(u8"  , %", &default_tolerance, 0.1f, 1.0f, "%.2f")) snapshotStale = true;
+            if (default_tolerance < 0.0f) default_tolerance = 0.0f;
+
+            auto& targets = portfolio.getTargets();
+            for (size_t i = 0; i < targets.size(); ++i) {
+                auto& target = targets[i];
+                ImGui::PushID(static_cast<int>(i));
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.45f);
+                if (ImGui::InputFloat(target.name.data(), &target.targetPercent, 0.1f, 1.0f, "%.2f")) snapshotStale = true;
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
+                if (ImGui::InputFloat(u8" ", &target.tolerancePercent, 0.1f, 1.0f, "%.2f")) snapshotStale = true;
+                ImGui::PopID();
                 if (target.targetPercent < 0.0f) target.targetPercent = 0.0f;
+                if (target.tolerancePercent < 0.0f) target.tolerancePercent = 0.0f;
             }
             if (ImGui::Button(u8"")) {
                 calculateRebalance();
             }
             
-            float total_target_percent = std::accumulate(targets.begin(), targets.end(), 0.0f,
-                [](float sum, const TargetAllocation& t) { return sum + t.targetPercent; });
+            float total_target_percent = portfolio.getTotalTargetPercent();
             if (total_target_percent < 100.0f) {
                 ImGui::Text(u8"  100%%: %.2f%%", 100.0f - total_target_percent);
             }
@@ -311,6 +1684,9 @@ public:
             else {
                 ImGui::Text(u8": 100%%");
             }
+
+            if (ImGui::CollapsingHeader(u8" ")) drawFrontier();
+            if (ImGui::CollapsingHeader(u8" ")) drawRiskParity();
             
             
             ImGui::End();
@@ -326,7 +1702,7 @@ public:
                 for (const auto& action : actions) {
                     ImGui::TableNextRow();
                     ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0, 0, 0, 1));
-                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", action.name.c_str());
+                    ImGui::TableSetColumnIndex(0); ImGui::Text("%s", action.name.data());
                     ImGui::TableSetColumnIndex(1); ImGui::Text("%.2f", action.diffValue);
                     ImGui::TableSetColumnIndex(2); ImGui::Text("%d", std::abs(action.unitsToBuyOrSell));
                     ImGui::TableSetColumnIndex(3);
@@ -348,23 +1724,56 @@ public:
             }
             ImGui::Text(u8" : %.2f", extraCapital);
             if (ImGui::Button(u8" ")) {
-                previousAssets = assets;
-                for (const auto& action : actions) {
-                    auto it = std::find_if(assets.begin(), assets.end(),
-                        [&](const Asset& a) { return a.name == action.name; });
-                    if (it != assets.end()) {
-                        it->quantity += action.unitsToBuyOrSell;
-                        if (it->quantity < 0) it->quantity = 0;
-                    }
+                previousAssets = portfolio.getAssets();
+                previousLots = portfolio.getLots();
+                const std::int64_t time = ledgerTime();
+                portfolio.applyRebalance(actions, time);
+                //    ,      
+                rebalanceBegin = ledger.size();
+                const auto& assets = portfolio.getAssets();
+                for (size_t i = 0; i < assets.size(); ++i) {
+                    ledger.recordTrade(time, assets[i].name, assets[i].quantity - previousAssets[i].quantity,
+                        assets[i].price, portfolio.getFx().code(assets[i].currency));
                 }
+                rebalanceEnd = ledger.size();
+                applyLedger();
                 actions.clear();
             }
             ImGui::SameLine();
             if (ImGui::Button(u8" ") && !previousAssets.empty()) {
-                assets = previousAssets; //  
+                portfolio.restoreAssets(previousAssets, previousLots); //  
+                //         ,   
+                const std::int64_t time = ledgerTime();
+                for (size_t k = rebalanceBegin; k < rebalanceEnd; ++k) {
+                    const LedgerEntry trade = ledger.entry(k);
+                    ledger.recordTrade(time, ledger.getSymbols().name(trade.symbol), -trade.quantity, trade.value,
+                        ledger.getCurrencies().name(trade.currency));
+                }
+                rebalanceBegin = rebalanceEnd;
+                applyLedger();
             }
             ImGui::End();
 
+            //  5: Accounts
+            if (!accountsBook.getAccounts().empty()) {
+                ImGui::Begin(u8"");
+                drawAccountsPanel();
+                ImGui::End();
+            }
+
+            //  6: Ledger
+            ImGui::Begin(u8"");
+            drawLedgerPanel();
+            ImGui::End();
+
+            ImGui::Begin(u8"");
+            drawBacktestPanel();
+            ImGui::End();
+
+            ImGui::Begin(u8"-");
+            drawStressPanel();
+            ImGui::End();
+
             ImGui::Render();
             int display_w, display_h;
             glfwGetFramebufferSize(window, &display_w, &display_h);
@@ -383,13 +1792,32 @@ public:
     }
 };
 
+#ifdef _WIN32
 int WINAPI WinMain(
     HINSTANCE hInstance,
     HINSTANCE hPrevInstance,
     LPSTR     lpCmdLine,
     int       nCmdShow
 ) {
+    if (isCommandLineMode(__argc, __argv)) {
+        //  WIN32-   :    
+        if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+            freopen("CONOUT$", "w", stdout);
+            freopen("CONOUT$", "w", stderr);
+        }
+        return runCommandLine(__argc, __argv);
+    }
+    PortfolioApp app;
+    app.run();
+    return 0;
+}
+#else
+int main(int argc, char** argv) {
+    if (isCommandLineMode(argc, argv)) {
+        return runCommandLine(argc, argv);
+    }
     PortfolioApp app;
     app.run();
     return 0;
-}
\ No newline at end of file
+}
+#endif
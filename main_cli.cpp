@@ -0,0 +1,6 @@
+#include "CommandLine.h"
+
+// Точка входа сборки без графического интерфейса (PORTFOLIO_BUILD_GUI=OFF)
+int main(int argc, char** argv) {
+    return runCommandLine(argc, argv);
+}